@@ -0,0 +1,17 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <QString>
+
+int benchmarkCues();
+int benchmarkTimecode();
+int benchmarkMidi(int notesPerSecond);
+int testMtc(int seconds, double fps);
+int testDmx(int seconds, const QString& protocolName);
+int benchmarkDmx(int universes);
+int testDmxCapture(int seconds, const QString& protocolName);
+int testOsc(int seconds);
+int captureOsc(const QString& fileName);
+int benchmarkOsc(const QString& fileName);
+
+#endif // BENCH_H
@@ -0,0 +1,77 @@
+#-------------------------------------------------
+#
+# Test and benchmark harnesses of Cute Caspar, a console tool
+# built from the same sources as the application
+#
+#-------------------------------------------------
+
+QT       -= gui
+QT       += network sql concurrent
+
+TARGET = CuteCasparBench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+# The following define makes your compiler emit warnings if you use
+# any feature of Qt which has been marked as deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+        CueBench.cpp \
+        DmxBench.cpp \
+        Main.cpp \
+        MidiBench.cpp \
+        MtcBench.cpp \
+        OscBench.cpp \
+        TimecodeBench.cpp \
+        ../CuteCaspar/CueDispatcher.cpp \
+        ../CuteCaspar/CueFile.cpp \
+        ../CuteCaspar/CueTrack.cpp \
+        ../CuteCaspar/DmxCapture.cpp \
+        ../CuteCaspar/DmxCompositor.cpp \
+        ../CuteCaspar/DmxOutput.cpp \
+        ../CuteCaspar/MtcGenerator.cpp \
+        ../CuteCaspar/osc/OscOutboundPacketStream.cpp \
+        ../CuteCaspar/osc/OscReceivedElements.cpp \
+        ../CuteCaspar/osc/OscTypes.cpp \
+        ../CuteCaspar/OscRouter.cpp \
+        ../CuteCaspar/OscSender.cpp \
+        ../CuteCaspar/PlayheadClock.cpp \
+        ../CuteCaspar/SmfFile.cpp
+
+HEADERS += \
+        Bench.h \
+        ../CuteCaspar/CueDispatcher.h \
+        ../CuteCaspar/CueFile.h \
+        ../CuteCaspar/CueTrack.h \
+        ../CuteCaspar/DmxCapture.h \
+        ../CuteCaspar/DmxCompositor.h \
+        ../CuteCaspar/DmxOutput.h \
+        ../CuteCaspar/MtcGenerator.h \
+        ../CuteCaspar/OscRouter.h \
+        ../CuteCaspar/OscSender.h \
+        ../CuteCaspar/PlayheadClock.h \
+        ../CuteCaspar/SmfFile.h
+
+# The harnesses use the classes of the application from its source folder
+INCLUDEPATH += $$PWD/../CuteCaspar
+DEPENDPATH += $$PWD/../CuteCaspar
+
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../Common/release/ -lCommon
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../Common/debug/ -lCommon
+else:unix: LIBS += -L$$OUT_PWD/../Common/ -lCommon
+
+INCLUDEPATH += $$OUT_PWD/../Common $$PWD/../Common
+DEPENDPATH += $$OUT_PWD/../Common $$PWD/../Common
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../QMidi/release/ -lQMidi
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../QMidi/debug/ -lQMidi
+else:unix: LIBS += -L$$OUT_PWD/../QMidi/ -lQMidi
+
+INCLUDEPATH += $$PWD/../QMidi
+DEPENDPATH += $$PWD/../QMidi
@@ -0,0 +1,109 @@
+#include "Bench.h"
+
+#include "CueDispatcher.h"
+#include "CueTrack.h"
+#include "Timecode.h"
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QString>
+
+// A cue the way the player kept it before there were cue tracks, keyed by its timecode
+struct legacyCue {
+    QString timeCode;
+    QString type;
+    unsigned int pitch;
+};
+
+// The timecode of the playhead the way the player used to format it
+static QString legacyTimecode(double time, double fps)
+{
+    int hour = (int)(time / 3600);
+    int minutes = (int)((time - hour * 3600) / 60);
+    int seconds = (int)(time - hour * 3600 - minutes * 60);
+    int frames = (int)((time - hour * 3600 - minutes * 60 - seconds) * fps);
+    return QString("%1:%2:%3%4%5").arg(hour, 2, 10, QChar('0'))
+                                  .arg(minutes, 2, 10, QChar('0'))
+                                  .arg(seconds, 2, 10, QChar('0'))
+                                  .arg(":")
+                                  .arg(frames, 2, 10, QChar('0'));
+}
+
+/**
+ * @brief benchmarkCues
+ * Follows the playhead of a ten minute 25 fps clip, reported twice a frame like a 50 Hz
+ * channel does, through its cues: the way the player used to, with the playhead formatted
+ * by QString::arg calls and compared to the timecode strings of a QMap, and through a
+ * CueDispatcher on a frame-indexed CueTrack. Reports the cost of a time report either way
+ * and checks that both play the same cues.
+ */
+int benchmarkCues()
+{
+    const double fps = 25.0;
+    const int frames = 10 * 60 * 25;
+    const int reports = frames * 2;
+    const int passes = 20;
+
+    // A note on every fifth frame, the same cues in either form
+    QMap<QString, legacyCue> legacy;
+    CueTrack track(fps);
+    for (int frame = 0; frame < frames; frame += 5) {
+        legacyCue it;
+        it.timeCode = legacyTimecode(frame / fps, fps);
+        it.type = (frame % 10 == 0) ? "ON" : "OFF";
+        it.pitch = static_cast<unsigned int>(36 + frame % 48);
+        legacy.insert(it.timeCode, it);
+        track.append(Timecode::framesFromTimecode(it.timeCode, fps), it.type == "ON" ? CueType::NOTE_ON : CueType::NOTE_OFF, it.pitch);
+    }
+    track.sort();
+
+    QElapsedTimer timer;
+    quint64 legacyPlayed = 0;
+    qint64 legacyChecksum = 0;
+    timer.start();
+    for (int pass = 0; pass < passes; pass++) {
+        QMap<QString, legacyCue>::iterator iterator = legacy.begin();
+        for (int i = 0; i < reports; i++) {
+            QString timecode = legacyTimecode(i / (2 * fps), fps);
+            if (iterator != legacy.end() && iterator.key().length() > 0) {
+                if (iterator->timeCode <= timecode) {
+                    if (iterator->timeCode == timecode) {
+                        legacyPlayed++;
+                        legacyChecksum += legacy[iterator->timeCode].type == "ON" ? legacy[iterator->timeCode].pitch : 0;
+                    }
+                    iterator++;
+                }
+            }
+        }
+    }
+    qint64 legacyTime = timer.nsecsElapsed();
+
+    CueDispatcher dispatcher;
+    dispatcher.setTrack(track);
+    quint64 played = 0;
+    qint64 checksum = 0;
+    timer.restart();
+    for (int pass = 0; pass < passes; pass++) {
+        dispatcher.rewind();
+        for (int i = 0; i < reports; i++) {
+            int frame = dispatcher.frameAt(i / (2 * fps));
+            const cue* batch;
+            int size;
+            bool late;
+            while (dispatcher.takeBatch(frame, frame, batch, size, late)) {
+                for (int c = 0; c < size; c++) {
+                    played++;
+                    checksum += batch[c].type == CueType::NOTE_ON ? batch[c].pitch : 0;
+                }
+            }
+        }
+    }
+    qint64 trackTime = timer.nsecsElapsed();
+
+    bool same = legacyPlayed == played && legacyChecksum == checksum;
+    qInfo("Cue dispatch, %d cues over %d time reports, %d replays", track.count(), reports, passes);
+    qInfo("  cues played      %llu, %s", played / passes, same ? "match" : "DIFFER");
+    qInfo("  timecode strings %8.1f ns per report", static_cast<double>(legacyTime) / reports / passes);
+    qInfo("  cue track        %8.1f ns per report", static_cast<double>(trackTime) / reports / passes);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,264 @@
+#include "Bench.h"
+
+#include "CueFile.h"
+#include "DmxCapture.h"
+#include "DmxCompositor.h"
+#include "DmxOutput.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QUdpSocket>
+
+#include <cstring>
+
+/**
+ * @brief testDmx
+ * Sends four DMX universes with moving levels to a receiver on 127.0.0.1 in this process,
+ * then reports the refresh rate and send jitter of the output and what the receiver got.
+ * @param seconds - how long to send
+ * @param protocolName - "artnet" or "sacn"
+ */
+int testDmx(int seconds, const QString& protocolName)
+{
+    const int universes = 4;
+    const double rate = 44.0;
+    bool valid;
+    DmxProtocol protocol = DmxOutput::protocolFromName(protocolName, valid);
+    if (!valid) {
+        qWarning("Unknown DMX protocol %s", qPrintable(protocolName));
+        return 1;
+    }
+    QUdpSocket receiver;
+    quint16 port = (protocol == DmxProtocol::SACN) ? 5568 : 6454;
+    if (!receiver.bind(QHostAddress::LocalHost, port)) {
+        qWarning("Cannot listen on port %u: %s", port, qPrintable(receiver.errorString()));
+        return 1;
+    }
+
+    DmxOutput output;
+    int first = (protocol == DmxProtocol::SACN) ? 1 : 0;
+    if (!output.open(protocol, "127.0.0.1", first, universes, rate)) {
+        return 1;
+    }
+    QElapsedTimer clock;
+    clock.start();
+    char datagram[1024];
+    quint64 received = 0;
+    quint64 invalid = 0;
+    qint64 previous = -1;
+    qint64 intervalCount = 0;
+    qint64 deviationSum = 0;
+    qint64 deviationMax = 0;
+    const qint64 period = static_cast<qint64>(1e9 / rate);
+    const char* magic = (protocol == DmxProtocol::SACN) ? "ASC-E1.17" : "Art-Net";
+    const int magicOffset = (protocol == DmxProtocol::SACN) ? 4 : 0;
+    while (clock.elapsed() < seconds * 1000LL) {
+        unsigned int level = static_cast<unsigned int>(clock.elapsed() / 10) & 0xFF;
+        for (int i = 0; i < universes; i++) {
+            output.set(DmxSource::PLAYLIST, static_cast<unsigned int>(i * DmxOutput::UNIVERSE_SIZE), level);
+        }
+        receiver.waitForReadyRead(10);
+        while (receiver.hasPendingDatagrams()) {
+            qint64 size = receiver.readDatagram(datagram, sizeof(datagram));
+            qint64 now = clock.nsecsElapsed();
+            if (size < 18 || memcmp(datagram + magicOffset, magic, strlen(magic)) != 0) {
+                invalid++;
+                continue;
+            }
+            received++;
+            // The intervals of the first universe show the jitter as seen by a receiver
+            bool firstUniverse = (protocol == DmxProtocol::SACN)
+                    ? (size > 114 && static_cast<uchar>(datagram[113]) == (first >> 8) && static_cast<uchar>(datagram[114]) == (first & 0xFF))
+                    : (datagram[14] == 0 && datagram[15] == 0);
+            if (firstUniverse) {
+                if (previous >= 0) {
+                    qint64 deviation = qAbs(now - previous - period);
+                    deviationSum += deviation;
+                    deviationMax = qMax(deviationMax, deviation);
+                    intervalCount++;
+                }
+                previous = now;
+            }
+        }
+    }
+    dmxStatistics statistics = output.getStatistics();
+    output.close();
+
+    qInfo("%s, %d universes at %.0f Hz for %d s", protocol == DmxProtocol::SACN ? "sACN" : "Art-Net", universes, rate, seconds);
+    qInfo("  refreshes        %llu (%.2f Hz)", statistics.frames, statistics.frameRate);
+    qInfo("  packets sent     %llu, %llu errors", statistics.packets, statistics.errors);
+    qInfo("  mean jitter      %7.1f us", statistics.meanJitter / 1e3);
+    qInfo("  worst jitter     %7.1f us", statistics.maxJitter / 1e3);
+    qInfo("  packets received %llu, %llu invalid", received, invalid);
+    if (intervalCount > 0) {
+        qInfo("  receive jitter   %7.1f us mean, %7.1f us worst", deviationSum / 1e3 / intervalCount, deviationMax / 1e3);
+    }
+    return (statistics.errors == 0 && invalid == 0 && received > 0) ? 0 : 1;
+}
+
+/**
+ * @brief benchmarkDmx
+ * Runs the DMX compositor the way the output does at 44 Hz, one minute of refreshes: four
+ * sources at two priorities, a quarter of the channels LTP, level changes with and without
+ * fades on every refresh. Reports the cost of a refresh against the 22.7 ms it may take and
+ * checks that the vector merge gives the same universes as the scalar one.
+ * @param universes - number of universes
+ */
+int benchmarkDmx(int universes)
+{
+    const double rate = 44.0;
+    const int refreshes = 60 * 44;
+    const int changes = 64 * universes;
+    const qint64 period = static_cast<qint64>(1e9 / rate);
+    universes = qBound(1, universes, DmxOutput::MAX_UNIVERSES);
+    const int channels = universes * DmxCompositor::UNIVERSE_SIZE;
+
+    DmxCompositor compositor;
+    compositor.resize(universes);
+    compositor.setPriority(DmxSource::OVERLAY, 150);
+    for (int address = 0; address < channels; address += 4) {
+        compositor.setLtp(static_cast<unsigned int>(address), true);
+    }
+    QRandomGenerator random(22);
+    QVector<quint8> vector(channels);
+    QVector<quint8> scalar(channels);
+    qint64 evaluateTime = 0;
+    qint64 mergeTime = 0;
+    qint64 scalarTime = 0;
+    qint64 worst = 0;
+    int maxFades = 0;
+    int mismatches = 0;
+    QElapsedTimer timer;
+    for (int frame = 0; frame < refreshes; frame++) {
+        qint64 now = frame * period;
+        for (int i = 0; i < changes; i++) {
+            DmxSource source = static_cast<DmxSource>(random.bounded(DmxCompositor::SOURCES));
+            unsigned int address = random.bounded(static_cast<quint32>(channels));
+            quint8 value = static_cast<quint8>(random.bounded(256));
+            qint64 fade = (i & 1) ? random.bounded(2000) * 1000000LL : 0;
+            compositor.set(source, address, value, now, fade, static_cast<DmxCurve>(i & 3));
+        }
+        if (frame % 440 == 439) {
+            compositor.release(static_cast<DmxSource>((frame / 440) % DmxCompositor::SOURCES));
+        }
+        timer.start();
+        compositor.evaluate(now);
+        qint64 evaluated = timer.nsecsElapsed();
+        for (int i = 0; i < universes; i++) {
+            compositor.merge(i, vector.data() + i * DmxCompositor::UNIVERSE_SIZE);
+        }
+        qint64 merged = timer.nsecsElapsed();
+        evaluateTime += evaluated;
+        mergeTime += merged - evaluated;
+        worst = qMax(worst, merged);
+        maxFades = qMax(maxFades, compositor.getActiveFades());
+
+        timer.restart();
+        for (int i = 0; i < universes; i++) {
+            compositor.mergeScalar(i, scalar.data() + i * DmxCompositor::UNIVERSE_SIZE);
+        }
+        scalarTime += timer.nsecsElapsed();
+        if (vector != scalar) {
+            mismatches++;
+        }
+    }
+
+    qInfo("%d universes, %d refreshes at %.0f Hz, %d level changes per refresh", universes, refreshes, rate, changes);
+    qInfo("  fades running    up to %d", maxFades);
+    qInfo("  evaluate fades   %8.2f us per refresh", evaluateTime / 1e3 / refreshes);
+    qInfo("  merge            %8.2f us per refresh", mergeTime / 1e3 / refreshes);
+    qInfo("  merge (scalar)   %8.2f us per refresh", scalarTime / 1e3 / refreshes);
+    qInfo("  worst refresh    %8.2f us of %.0f us", worst / 1e3, period / 1e3);
+    qInfo("  mismatches       %d", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
+
+/**
+ * @brief testDmxCapture
+ * Sends two DMX universes with moving levels to 127.0.0.1 and captures them as a take of
+ * a 25 fps clip whose playhead follows the wall clock. The sidecar is written to a
+ * temporary folder and read back; replaying its DMX cues must end on the levels last sent.
+ * @param seconds - how long to send
+ * @param protocolName - "artnet" or "sacn"
+ */
+int testDmxCapture(int seconds, const QString& protocolName)
+{
+    const int universes = 2;
+    const double fps = 25.0;
+    const int channels = universes * DmxOutput::UNIVERSE_SIZE;
+    bool valid;
+    DmxProtocol protocol = DmxOutput::protocolFromName(protocolName, valid);
+    if (!valid) {
+        qWarning("Unknown DMX protocol %s", qPrintable(protocolName));
+        return 1;
+    }
+    QTemporaryDir folder;
+    if (!folder.isValid() || !QDir::setCurrent(folder.path())) {
+        qWarning("Cannot create a temporary folder");
+        return 1;
+    }
+    int first = (protocol == DmxProtocol::SACN) ? 1 : 0;
+    DmxCapture capture;
+    if (!capture.open(protocol, first, universes)) {
+        return 1;
+    }
+    DmxOutput output;
+    if (!output.open(protocol, "127.0.0.1", first, universes, 44.0)) {
+        return 1;
+    }
+
+    CueTrack track(fps);
+    QVector<quint8> sent(channels, 0);
+    capture.start("dmx-capture-test", track);
+    QElapsedTimer clock;
+    clock.start();
+    while (clock.elapsed() < seconds * 1000LL) {
+        // A few channels fade up and down, one snaps on and off every second
+        qint64 elapsed = clock.elapsed();
+        for (int i = 0; i < universes; i++) {
+            for (int c = 0; c < 8; c++) {
+                unsigned int address = static_cast<unsigned int>(i * DmxOutput::UNIVERSE_SIZE + c);
+                quint8 level = static_cast<quint8>((elapsed / 20 + c * 32) & 0xFF);
+                sent[static_cast<int>(address)] = level;
+                output.set(DmxSource::PLAYLIST, address, level);
+            }
+        }
+        quint8 snap = ((elapsed / 1000) & 1) ? 255 : 0;
+        sent[100] = snap;
+        output.set(DmxSource::PLAYLIST, 100, snap);
+        capture.timecode(elapsed / 1000.0);
+        QThread::msleep(10);
+    }
+    // Let the last levels go round, on a later frame
+    for (int i = 1; i <= 10; i++) {
+        QThread::msleep(20);
+        capture.timecode(clock.elapsed() / 1000.0);
+    }
+    CueTrack take = capture.finish(track);
+    captureStatistics statistics = capture.getStatistics();
+    output.close();
+    capture.close();
+
+    CueTrack saved = CueFile::readCsv(CueFile::sidecarName("dmx-capture-test"), fps);
+    QVector<quint8> replayed(channels, 0);
+    int cues = 0;
+    for (int i = 0; i < saved.count(); i++) {
+        const cue& it = saved.at(i);
+        if (it.type == CueType::DMX && dmxAddress(it) < static_cast<unsigned int>(channels)) {
+            replayed[static_cast<int>(dmxAddress(it))] = it.velocity;
+            cues++;
+        }
+    }
+    qint64 raw = static_cast<qint64>(statistics.frames) * channels;
+
+    qInfo("%s, %d universes captured for %d s at %.0f fps", protocol == DmxProtocol::SACN ? "sACN" : "Art-Net", universes, seconds, fps);
+    qInfo("  packets received %llu, %llu invalid", statistics.packets, statistics.invalid);
+    qInfo("  frames recorded  %llu", statistics.frames);
+    qInfo("  changes          %llu, %llu dropped", statistics.changes, statistics.dropped);
+    qInfo("  take size        %lld bytes, %lld bytes as whole universes per frame",
+          static_cast<qint64>(take.count() * sizeof(cue)), raw);
+    qInfo("  sidecar cues     %d, last levels %s", cues, replayed == sent ? "match" : "DIFFER");
+    return (statistics.invalid == 0 && statistics.dropped == 0 && cues == take.count() && replayed == sent) ? 0 : 1;
+}
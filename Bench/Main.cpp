@@ -0,0 +1,72 @@
+#include "Bench.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    application.setApplicationName("Cute Caspar Bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Test and benchmark harnesses of Cute Caspar.");
+    parser.addHelpOption();
+    QCommandLineOption benchmarkCuesOption("benchmark-cues", "Measure the cost of following the playhead through the cues of a clip.");
+    parser.addOption(benchmarkCuesOption);
+    QCommandLineOption benchmarkTimecodeOption("benchmark-timecode", "Measure the cost of formatting timecodes.");
+    parser.addOption(benchmarkTimecodeOption);
+    QCommandLineOption benchmarkMidiOption("benchmark-midi", "Send <notes> MIDI notes per second for ten seconds and report send time and memory growth.", "notes");
+    parser.addOption(benchmarkMidiOption);
+    QCommandLineOption testMtcOption("test-mtc", "Send MIDI timecode to the virtual port \"CuteCaspar MTC\" for <seconds> and report the jitter.", "seconds");
+    parser.addOption(testMtcOption);
+    QCommandLineOption fpsOption("fps", "Frame rate used by --test-mtc (default 25).", "fps", "25");
+    parser.addOption(fpsOption);
+    QCommandLineOption testDmxOption("test-dmx", "Send DMX to a local receiver for <seconds> and report the refresh rate and jitter.", "seconds");
+    parser.addOption(testDmxOption);
+    QCommandLineOption dmxProtocolOption("dmx-protocol", "Protocol used by --test-dmx and --test-dmx-capture: artnet or sacn (default artnet).", "protocol", "artnet");
+    parser.addOption(dmxProtocolOption);
+    QCommandLineOption benchmarkDmxOption("benchmark-dmx", "Merge <universes> DMX universes (at least 16 for a show) for a minute at 44 Hz and report the cost of a refresh.", "universes");
+    parser.addOption(benchmarkDmxOption);
+    QCommandLineOption testDmxCaptureOption("test-dmx-capture", "Capture DMX sent to this machine as a take for <seconds> and check the recorded cues (--dmx-protocol applies).", "seconds");
+    parser.addOption(testDmxCaptureOption);
+    QCommandLineOption testOscOption("test-osc", "Send cues as timetagged OSC bundles to a local receiver for <seconds> and check what arrives.", "seconds");
+    parser.addOption(testOscOption);
+    QCommandLineOption captureOscOption("capture-osc", "Record a minute of the OSC that CasparCG sends to the OSC port into <file>.", "file");
+    parser.addOption(captureOscOption);
+    QCommandLineOption benchmarkOscOption("benchmark-osc", "Replay the OSC captured in <file> (a synthetic stream when there is none) and report the cost of routing a message.", "file");
+    parser.addOption(benchmarkOscOption);
+    parser.process(application);
+
+    if (parser.isSet(benchmarkCuesOption)) {
+        return benchmarkCues();
+    }
+    if (parser.isSet(benchmarkTimecodeOption)) {
+        return benchmarkTimecode();
+    }
+    if (parser.isSet(benchmarkMidiOption)) {
+        return benchmarkMidi(parser.value(benchmarkMidiOption).toInt());
+    }
+    if (parser.isSet(testMtcOption)) {
+        return testMtc(parser.value(testMtcOption).toInt(), parser.value(fpsOption).toDouble());
+    }
+    if (parser.isSet(testDmxOption)) {
+        return testDmx(parser.value(testDmxOption).toInt(), parser.value(dmxProtocolOption));
+    }
+    if (parser.isSet(benchmarkDmxOption)) {
+        return benchmarkDmx(parser.value(benchmarkDmxOption).toInt());
+    }
+    if (parser.isSet(testDmxCaptureOption)) {
+        return testDmxCapture(parser.value(testDmxCaptureOption).toInt(), parser.value(dmxProtocolOption));
+    }
+    if (parser.isSet(testOscOption)) {
+        return testOsc(parser.value(testOscOption).toInt());
+    }
+    if (parser.isSet(captureOscOption)) {
+        return captureOsc(parser.value(captureOscOption));
+    }
+    if (parser.isSet(benchmarkOscOption)) {
+        return benchmarkOsc(parser.value(benchmarkOscOption));
+    }
+
+    parser.showHelp(1);
+}
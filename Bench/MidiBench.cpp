@@ -0,0 +1,95 @@
+#include "Bench.h"
+
+#include "qmidiout.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+/**
+ * @brief residentMemory
+ * @return resident memory of the process in bytes, -1 when it cannot be read
+ */
+static qint64 residentMemory()
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+        }
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief benchmarkMidi
+ * Sends notes to the first MIDI output, or to a virtual port when there is none, at a
+ * number of notes per second for ten seconds. The notes of a frame (25 fps) go out as
+ * one batch. Reports the time spent sending and the growth of the resident memory.
+ * @param notesPerSecond - note ons per second, each one is followed by its note off
+ */
+int benchmarkMidi(int notesPerSecond)
+{
+    const int fps = 25;
+    const int seconds = 10;
+    const int perFrame = qBound(1, notesPerSecond / fps, 256);
+
+    QMidiOut output;
+    if (output.getPorts().isEmpty()) {
+        output.openVirtualPort("CuteCaspar benchmark");
+    } else {
+        output.openPort(0);
+    }
+    if (!output.isPortOpen()) {
+        qCritical("No MIDI output available");
+        return 1;
+    }
+
+    QMidiShortMessage batch[512];
+    QElapsedTimer clock;
+    QElapsedTimer timer;
+    qint64 sendTime = 0;
+    qint64 worstBatch = 0;
+    qint64 memoryBefore = 0;
+    clock.start();
+    for (int frame = 0; frame < fps * seconds; frame++) {
+        int count = 0;
+        for (int i = 0; i < perFrame; i++) {
+            unsigned char pitch = static_cast<unsigned char>(36 + (frame * perFrame + i) % 48);
+            batch[count++] = {static_cast<unsigned char>(MIDI_NOTE_OFF), static_cast<unsigned char>(pitch == 36 ? 83 : pitch - 1), 0};
+            batch[count++] = {static_cast<unsigned char>(MIDI_NOTE_ON), pitch, 60};
+        }
+        timer.start();
+        output.sendBatch(batch, count);
+        qint64 elapsed = timer.nsecsElapsed();
+        sendTime += elapsed;
+        worstBatch = qMax(worstBatch, elapsed);
+        if (frame == 0) {
+            // Measure after the first batch, drivers allocate their buffers on first use
+            memoryBefore = residentMemory();
+        }
+        qint64 wait = (frame + 1) * 1000 / fps - clock.elapsed();
+        if (wait > 0) {
+            QThread::msleep(static_cast<unsigned long>(wait));
+        }
+    }
+    qint64 memoryAfter = residentMemory();
+    output.closePort();
+
+    int messages = fps * seconds * perFrame * 2;
+    qInfo("MIDI output, %d notes per second for %d s, %d messages in batches of %d%s",
+          perFrame * fps, seconds, messages, perFrame * 2, output.isRunningStatus() ? " with running status" : "");
+    qInfo("  send time        %7.1f ns/message", double(sendTime) / messages);
+    qInfo("  worst batch      %7.1f us", worstBatch / 1e3);
+    if (memoryBefore >= 0 && memoryAfter >= 0) {
+        qInfo("  memory growth    %lld bytes", memoryAfter - memoryBefore);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include "Bench.h"
+
+#include "MtcGenerator.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+/**
+ * @brief testMtc
+ * Sends MIDI timecode to a virtual port "CuteCaspar MTC", for a playhead that starts at
+ * one hour and is reported every frame like a CasparCG layer, then reports the jitter.
+ * Any MTC reader can be connected to the port, e.g. aseqdump on ALSA.
+ * @param seconds - how long to send
+ * @param fps - frame rate of the clip
+ */
+int testMtc(int seconds, double fps)
+{
+    MtcGenerator generator;
+    if (!generator.open("virtual")) {
+        return 1;
+    }
+    generator.follow(1, fps);
+    QElapsedTimer clock;
+    clock.start();
+    int frames = 0;
+    while (clock.elapsed() < seconds * 1000LL) {
+        generator.timecode(1, 3600.0 + clock.nsecsElapsed() / 1e9);
+        frames++;
+        qint64 wait = static_cast<qint64>(frames * 1000 / fps) - clock.elapsed();
+        if (wait > 0) {
+            QThread::msleep(static_cast<unsigned long>(wait));
+        }
+    }
+    // Let the generator see the playhead stop and send its last full frame
+    generator.timecode(1, 3600.0 + clock.nsecsElapsed() / 1e9);
+    generator.timecode(1, 3600.0);
+    QThread::msleep(100);
+
+    mtcStatistics statistics = generator.getStatistics();
+    qInfo("MIDI timecode at %.2f fps for %d s", MtcGenerator::mtcFps(fps), seconds);
+    qInfo("  quarter frames   %llu", statistics.quarterFrames);
+    qInfo("  full frames      %llu", statistics.fullFrames);
+    qInfo("  mean jitter      %7.1f us", statistics.meanJitter / 1e3);
+    qInfo("  worst jitter     %7.1f us", statistics.maxJitter / 1e3);
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include "Bench.h"
+
+#include "OscRouter.h"
+#include "OscSender.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStringList>
+#include <QThread>
+#include <QUdpSocket>
+
+#include <osc/OscOutboundPacketStream.h>
+#include <osc/OscReceivedElements.h>
+
+/**
+ * @brief testOsc
+ * Sends 25 frames per second of cues as OSC bundles to a receiver on 127.0.0.1 in this
+ * process, timetagged 40 ms ahead, and reports how far ahead of their arrival the
+ * timetags were and whether every message arrived intact.
+ * @param seconds - how long to send
+ */
+int testOsc(int seconds)
+{
+    const int frames = seconds * 25;
+    const qint64 delay = 40000000;
+    QUdpSocket receiver;
+    if (!receiver.bind(QHostAddress::LocalHost, 0)) {
+        qWarning("Cannot listen: %s", qPrintable(receiver.errorString()));
+        return 1;
+    }
+    oscTarget target;
+    target.name = "test";
+    target.address = QHostAddress::LocalHost;
+    target.port = receiver.localPort();
+    OscSender sender({target});
+
+    char datagram[OscSender::BUFFER_SIZE];
+    quint64 bundles = 0;
+    qint64 messages = 0;
+    quint64 invalid = 0;
+    qint64 aheadSum = 0;
+    qint64 aheadMin = delay;
+    auto receive = [&](int msecs) {
+        while (receiver.hasPendingDatagrams() || receiver.waitForReadyRead(msecs)) {
+            qint64 size = receiver.readDatagram(datagram, sizeof(datagram));
+            quint64 now = OscSender::timeTag(0);
+            try {
+                osc::ReceivedPacket packet(datagram, static_cast<std::size_t>(qMax<qint64>(0, size)));
+                if (!packet.IsBundle()) {
+                    invalid++;
+                    continue;
+                }
+                osc::ReceivedBundle bundle(packet);
+                // NTP fractions of a second to nanoseconds
+                qint64 ahead = static_cast<qint64>(bundle.TimeTag() - now) * 1000000000 / 4294967296LL;
+                aheadSum += ahead;
+                aheadMin = qMin(aheadMin, ahead);
+                bundles++;
+                for (osc::ReceivedBundle::const_iterator it = bundle.ElementsBegin(); it != bundle.ElementsEnd(); ++it) {
+                    osc::ReceivedMessage message(*it);
+                    if (message.ArgumentCount() > 0) {
+                        messages--;
+                    } else {
+                        invalid++;
+                    }
+                }
+            } catch (osc::Exception& e) {
+                qWarning("Malformed OSC: %s", e.what());
+                invalid++;
+            }
+        }
+    };
+
+    QElapsedTimer clock;
+    clock.start();
+    for (int frame = 0; frame < frames; frame++) {
+        // A chord, an action and a few DMX levels per frame; every 25th frame overflows a bundle
+        sender.begin(delay);
+        for (int i = 0; i < 3; i++) {
+            sender.note(0, static_cast<unsigned int>(60 + i), true, 100, 1);
+        }
+        sender.note(1, 129, (frame & 1) != 0, 0, 1);
+        int levels = (frame % 25 == 0) ? 120 : 8;
+        for (int i = 0; i < levels; i++) {
+            sender.dmx(0, static_cast<unsigned int>(i), static_cast<unsigned int>(frame & 0xFF));
+        }
+        sender.send();
+        messages += 4 + levels;
+        receive(0);
+        QThread::usleep(static_cast<unsigned long>(qMax<qint64>(0, (frame + 1) * 40000LL - clock.nsecsElapsed() / 1000)));
+    }
+    receive(100);
+    oscStatistics statistics = sender.getStatistics();
+
+    qInfo("OSC, %d frames at 25 fps, timetags %lld ms ahead", frames, delay / 1000000);
+    qInfo("  bundles sent     %llu, %llu errors", statistics.bundles, statistics.errors);
+    qInfo("  bundles received %llu, %llu invalid", bundles, invalid);
+    qInfo("  messages missing %lld", messages);
+    if (bundles > 0) {
+        qInfo("  timetag ahead    %7.2f ms mean, %7.2f ms least", aheadSum / 1e6 / bundles, aheadMin / 1e6);
+    }
+    return (statistics.errors == 0 && invalid == 0 && messages == 0 && bundles == statistics.bundles) ? 0 : 1;
+}
+
+/**
+ * @brief captureOsc
+ * Records the OSC datagrams that arrive on the OSC port (osc_port) for a minute, to be
+ * replayed by --benchmark-osc. Run it while CasparCG plays and Cute Caspar itself is closed.
+ * @param fileName - file to write, every datagram with its length in front
+ */
+int captureOsc(const QString& fileName)
+{
+    QSettings settings("VRT", "CasparCGClient");
+    settings.beginGroup("Configuration");
+    quint16 port = static_cast<quint16>(settings.value("osc_port", 6250).toInt());
+    settings.endGroup();
+
+    QUdpSocket socket;
+    if (!socket.bind(QHostAddress::AnyIPv4, port)) {
+        qWarning("Cannot listen on port %u: %s", port, qPrintable(socket.errorString()));
+        return 1;
+    }
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot write %s", qPrintable(fileName));
+        return 1;
+    }
+    QDataStream stream(&file);
+    quint64 datagrams = 0;
+    QElapsedTimer clock;
+    clock.start();
+    while (clock.elapsed() < 60000) {
+        if (!socket.waitForReadyRead(100)) {
+            continue;
+        }
+        while (socket.hasPendingDatagrams()) {
+            QByteArray datagram(static_cast<int>(qMax<qint64>(0, socket.pendingDatagramSize())), Qt::Uninitialized);
+            socket.readDatagram(datagram.data(), datagram.size());
+            stream << datagram;
+            datagrams++;
+        }
+    }
+    qInfo("Captured %llu OSC datagrams from port %u into %s", datagrams, port, qPrintable(fileName));
+    return datagrams > 0 ? 0 : 1;
+}
+
+/**
+ * @brief synthesizeOsc
+ * A minute of what CasparCG reports at 50 fps on two channels, when there is no capture:
+ * the file of the playlist layer (2) the way 2.0 reports it, that of the soundscape layer
+ * (1) the way 2.3 does, and the mixer, output and profiler reports around them.
+ * @return one bundle per channel and frame
+ */
+static QVector<QByteArray> synthesizeOsc()
+{
+    QVector<QByteArray> datagrams;
+    char buffer[4096];
+    char address[64];
+    for (int frame = 0; frame < 50 * 60; frame++) {
+        for (int channel = 1; channel <= 2; channel++) {
+            osc::OutboundPacketStream stream(buffer, sizeof(buffer));
+            stream << osc::BeginBundleImmediate;
+            qsnprintf(address, sizeof(address), "/channel/%d/framerate", channel);
+            stream << osc::BeginMessage(address) << osc::int64(50) << osc::int64(1) << osc::EndMessage;
+            for (int i = 1; i <= 8; i++) {
+                qsnprintf(address, sizeof(address), "/channel/%d/mixer/audio/%d/dBFS", channel, i);
+                stream << osc::BeginMessage(address) << -20.0f - i << osc::EndMessage;
+            }
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/2/file/frame", channel);
+            stream << osc::BeginMessage(address) << osc::int64(frame) << osc::int64(50 * 60) << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/2/file/time", channel);
+            stream << osc::BeginMessage(address) << frame / 50.0f << 60.0f << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/2/file/fps", channel);
+            stream << osc::BeginMessage(address) << 50.0f << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/2/file/path", channel);
+            stream << osc::BeginMessage(address) << "SCARES/GHOST" << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/1/foreground/file/time", channel);
+            stream << osc::BeginMessage(address) << (frame % 1500) / 50.0f << 30.0f << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/1/foreground/file/path", channel);
+            stream << osc::BeginMessage(address) << "SOUNDSCAPE/WIND" << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/1/foreground/paused", channel);
+            stream << osc::BeginMessage(address) << false << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/stage/layer/1/foreground/producer", channel);
+            stream << osc::BeginMessage(address) << "ffmpeg" << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/output/port/1/frame", channel);
+            stream << osc::BeginMessage(address) << osc::int64(frame) << osc::int64(-1) << osc::EndMessage;
+            qsnprintf(address, sizeof(address), "/channel/%d/profiler/time", channel);
+            stream << osc::BeginMessage(address) << 0.004f << 0.02f << osc::EndMessage;
+            stream << osc::EndBundle;
+            datagrams.append(QByteArray(stream.Data(), static_cast<int>(stream.Size())));
+        }
+    }
+    return datagrams;
+}
+
+struct oscReport {
+    quint64 messages = 0;
+    quint64 frames = 0;
+    quint64 times = 0;
+    quint64 wideLayers = 0;
+    qint64 checksum = 0;
+};
+
+template<typename Handle>
+static void replayBundle(const osc::ReceivedBundle& bundle, Handle& handle)
+{
+    for (osc::ReceivedBundle::const_iterator it = bundle.ElementsBegin(); it != bundle.ElementsEnd(); ++it) {
+        if (it->IsBundle()) {
+            replayBundle(osc::ReceivedBundle(*it), handle);
+        } else {
+            handle(osc::ReceivedMessage(*it));
+        }
+    }
+}
+
+template<typename Handle>
+static void replayOsc(const QVector<QByteArray>& datagrams, Handle& handle)
+{
+    for (const QByteArray& datagram : datagrams) {
+        try {
+            osc::ReceivedPacket packet(datagram.constData(), static_cast<std::size_t>(datagram.size()));
+            if (packet.IsBundle()) {
+                replayBundle(osc::ReceivedBundle(packet), handle);
+            } else {
+                handle(osc::ReceivedMessage(packet));
+            }
+        } catch (osc::Exception&) {
+        }
+    }
+}
+
+/**
+ * @brief benchmarkOsc
+ * Replays a captured CasparCG OSC stream, or a synthetic one when there is no capture,
+ * through the router of the OSC listener and through the way messages were handled before
+ * it: the address split into a string list, the arguments turned into strings, the list
+ * joined again and matched by regular expressions built per message. Reports the cost of
+ * a message either way and checks that both find the same reports. Time reports of layers
+ * above 9, which the regular expressions did not match, are counted apart.
+ * @param fileName - capture written by --capture-osc
+ */
+int benchmarkOsc(const QString& fileName)
+{
+    QVector<QByteArray> datagrams;
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&file);
+        while (!stream.atEnd()) {
+            QByteArray datagram;
+            stream >> datagram;
+            if (stream.status() != QDataStream::Ok) {
+                break;
+            }
+            datagrams.append(datagram);
+        }
+        qInfo("Replaying %d OSC datagrams from %s", datagrams.size(), qPrintable(fileName));
+    } else {
+        datagrams = synthesizeOsc();
+        qInfo("No capture in %s, replaying a minute of synthetic CasparCG OSC", qPrintable(fileName));
+    }
+
+    oscReport counted;
+    auto count = [&counted](const osc::ReceivedMessage&) { counted.messages++; };
+    replayOsc(datagrams, count);
+    if (counted.messages == 0) {
+        qWarning("No OSC messages to replay");
+        return 1;
+    }
+    const int passes = static_cast<int>(qMax<quint64>(1, 1000000 / counted.messages));
+
+    oscReport legacy;
+    auto processLegacy = [&legacy](const osc::ReceivedMessage& m) {
+        legacy.messages++;
+        QStringList address = QString(m.AddressPattern() + 1).split("/");
+        if (address.size() > 2 && address[2] == "mixer") {
+            return;
+        }
+        QStringList values;
+        osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+        for (int i = 0; i < static_cast<int>(m.ArgumentCount()); i++) {
+            QString types = m.TypeTags();
+            if (types[i] == 'f')
+                values.append(QString::number(static_cast<double>((arg++)->AsFloat())));
+            else if (types[i] == 'h')
+                values.append(QString::number((arg++)->AsInt64()));
+            else if (types[i] == 's')
+                values.append((arg++)->AsString());
+            else
+                arg++;
+        }
+        QString adr = address.join("/");
+        if (adr == "channel/1/stage/layer/2/file/frame") {
+            legacy.frames++;
+            legacy.checksum += values[0].toInt();
+        } else if (QRegularExpression("channel/1/stage/layer/./file/time").match(adr).hasMatch()) {
+            legacy.times++;
+            legacy.checksum += address[4].toInt();
+        } else if (QRegularExpression("channel/1/stage/layer/./foreground/file/time").match(adr).hasMatch()) {
+            legacy.times++;
+            legacy.checksum += address[4].toInt();
+        }
+    };
+
+    oscReport routed;
+    OscRouter router;
+    router.add("/channel/1/stage/layer/2/file/frame", [&routed](const int*, const osc::ReceivedMessage& message) {
+        routed.frames++;
+        routed.checksum += static_cast<int>(OscRouter::number(message, 0));
+    });
+    // The regular expressions only matched layers 0 to 9, the router matches any layer
+    auto routeTime = [&routed](const int* numbers, const osc::ReceivedMessage&) {
+        if (numbers[0] > 9) {
+            routed.wideLayers++;
+            return;
+        }
+        routed.times++;
+        routed.checksum += numbers[0];
+    };
+    router.add("/channel/1/stage/layer/#/file/time", routeTime);
+    router.add("/channel/1/stage/layer/#/foreground/file/time", routeTime);
+    auto processRouted = [&routed, &router](const osc::ReceivedMessage& m) {
+        routed.messages++;
+        router.dispatch(m);
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < passes; i++) {
+        replayOsc(datagrams, processLegacy);
+    }
+    qint64 legacyTime = timer.nsecsElapsed();
+    timer.restart();
+    for (int i = 0; i < passes; i++) {
+        replayOsc(datagrams, processRouted);
+    }
+    qint64 routedTime = timer.nsecsElapsed();
+
+    bool same = legacy.frames == routed.frames && legacy.times == routed.times && legacy.checksum == routed.checksum;
+    qInfo("%llu messages per replay, %d replays", counted.messages, passes);
+    qInfo("  reports          %llu frame, %llu time, %s", routed.frames / passes, routed.times / passes, same ? "match" : "DIFFER");
+    qInfo("  layers above 9   %llu time reports, routed only", routed.wideLayers / passes);
+    qInfo("  regex            %8.1f ns per message", static_cast<double>(legacyTime) / legacy.messages);
+    qInfo("  router           %8.1f ns per message", static_cast<double>(routedTime) / routed.messages);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "Bench.h"
+
+#include "Timecode.h"
+
+#include <QElapsedTimer>
+#include <QString>
+
+/**
+ * @brief benchmarkTimecode
+ * Compares the cost per call of formatting a timecode the way it used to be done,
+ * with chained QString::arg calls, to Timecode::fromTime() and Timecode::format().
+ */
+int benchmarkTimecode()
+{
+    const int calls = 1000000;
+    const double fps = 25.0;
+    QElapsedTimer timer;
+    int checksum = 0;
+
+    timer.start();
+    for (int i = 0; i < calls; i++) {
+        double time = i / fps;
+        int hour = (int)(time / 3600);
+        int minutes = (int)((time - hour * 3600) / 60);
+        int seconds = (int)(time - hour * 3600 - minutes * 60);
+        int frames = (int)((time - hour * 3600 - minutes * 60 - seconds) * fps);
+        QString timecode = QString("%1:%2:%3%4%5").arg(hour, 2, 10, QChar('0'))
+                                                  .arg(minutes, 2, 10, QChar('0'))
+                                                  .arg(seconds, 2, 10, QChar('0'))
+                                                  .arg(":")
+                                                  .arg(frames, 2, 10, QChar('0'));
+        checksum += timecode.length();
+    }
+    qint64 legacy = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < calls; i++) {
+        checksum += Timecode::fromTime(i / fps, fps, false).length();
+    }
+    qint64 string = timer.nsecsElapsed();
+
+    timer.restart();
+    char buffer[Timecode::BUFFER_SIZE];
+    for (int i = 0; i < calls; i++) {
+        checksum += Timecode::format(buffer, i / fps, fps, false);
+    }
+    qint64 buffered = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < calls; i++) {
+        checksum += Timecode::format(buffer, i / 29.97, 29.97, true);
+    }
+    qint64 dropFrame = timer.nsecsElapsed();
+
+    qInfo("Timecode formatting, %d calls (checksum %d)", calls, checksum);
+    qInfo("  QString::arg chain     %7.1f ns/call", double(legacy) / calls);
+    qInfo("  Timecode::fromTime     %7.1f ns/call", double(string) / calls);
+    qInfo("  Timecode::format       %7.1f ns/call", double(buffered) / calls);
+    qInfo("  drop-frame at 29.97    %7.1f ns/call", double(dropFrame) / calls);
+
+    return 0;
+}
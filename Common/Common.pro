@@ -23,11 +23,14 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-        Timecode.cpp
+        Timecode.cpp \
+        TimerWheel.cpp
 
 HEADERS += \
         Share.h \
-        Timecode.h
+        SpscQueue.h \
+        Timecode.h \
+        TimerWheel.h
 
 unix {
     target.path = /usr/lib
@@ -0,0 +1,64 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+
+/**
+ * @brief The SpscQueue class
+ * Bounded lock-free queue between exactly one producer thread and one consumer thread.
+ * Neither side ever waits for the other: push() fails when the queue is full and pop()
+ * fails when it is empty. The capacity must be a power of two.
+ */
+template <typename T, unsigned int N>
+class SpscQueue
+{
+    static_assert(N > 1 && (N & (N - 1)) == 0, "capacity of SpscQueue must be a power of two");
+
+public:
+    SpscQueue() {}
+
+    /**
+     * @brief push - producer side
+     * @param item - item to be copied into the queue
+     * @return false when the queue is full, the item is not queued
+     */
+    bool push(const T& item)
+    {
+        unsigned int tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        m_items[tail & (N - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief pop - consumer side
+     * @param item - receives the oldest item
+     * @return false when the queue is empty
+     */
+    bool pop(T& item)
+    {
+        unsigned int head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = m_items[head & (N - 1)];
+        m_items[head & (N - 1)] = T();
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T m_items[N];
+    alignas(64) std::atomic<unsigned int> m_head{0};
+    alignas(64) std::atomic<unsigned int> m_tail{0};
+};
+
+#endif // SPSCQUEUE_H
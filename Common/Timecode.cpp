@@ -13,31 +13,266 @@ QString Timecode::fromTime(const QTime& time, bool useDropFrameNotation)
     return result.append(QString("%1").arg(msec));
 }
 
+/**
+ * @brief Timecode::fromTime
+ * Formats a time as "hh:mm:ss:ff", see format()
+ * @param time - time in seconds
+ * @param fps - frame rate of the clip
+ * @param useDropFrameNotation - count drop-frame labels at 29.97 and 59.94 fps, separate the frames with a dot
+ * @return timecode string
+ */
 QString Timecode::fromTime(double time, double fps, bool useDropFrameNotation)
 {
-    int hour;
-    int minutes;
-    int seconds;
-    int frames;
+    char buffer[BUFFER_SIZE];
+    int length = format(buffer, time, fps, useDropFrameNotation);
 
-    hour = (int)(time / 3600);
-    minutes = (int)((time - hour * 3600) / 60);
-    seconds = (int)(time - hour * 3600 - minutes * 60);
-    frames = (int)((time - hour * 3600 - minutes * 60 - seconds) * fps);
+    return QString::fromLatin1(buffer, length);
+}
+
+/**
+ * @brief Timecode::format
+ * Writes the timecode of a time into a buffer of the caller without allocating anything.
+ * Without drop-frame notation the frame number is the one of framesFromTime(), so the
+ * strings order exactly like the frames of a cue track.
+ * @param buffer - receives the zero-terminated timecode, at least BUFFER_SIZE characters
+ * @param time - time in seconds
+ * @param fps - frame rate of the clip
+ * @param useDropFrameNotation - count drop-frame labels at 29.97 and 59.94 fps, separate the frames with a dot
+ * @return length of the timecode
+ */
+int Timecode::format(char* buffer, double time, double fps, bool useDropFrameNotation)
+{
+    if (time < 0.0)
+        time = 0.0;
+
+    if (useDropFrameNotation) {
+        int label = isDropFrame(fps) ? labelFromRealFrames(realFramesFromTime(time, fps), fps)
+                                     : framesFromTime(time, fps);
+        return formatFrames(buffer, label, fps, '.');
+    }
+
+    return formatFrames(buffer, framesFromTime(time, fps), fps);
+}
+
+static char* writeNumber(char* it, int value)
+{
+    if (value >= 100) {
+        *it++ = static_cast<char>('0' + value / 100);
+        value %= 100;
+    }
+    *it++ = static_cast<char>('0' + value / 10);
+    *it++ = static_cast<char>('0' + value % 10);
+
+    return it;
+}
+
+/**
+ * @brief Timecode::formatFrames
+ * Writes a frame number as returned by framesFromTimecode() as "hh:mm:ss:ff" into a buffer
+ * of the caller. The common frame rates divide by constants.
+ * @param buffer - receives the zero-terminated timecode, at least BUFFER_SIZE characters
+ * @param frames - frame number
+ * @param fps - frame rate of the clip
+ * @param separator - character in front of the frames
+ * @return length of the timecode
+ */
+int Timecode::formatFrames(char* buffer, int frames, double fps, char separator)
+{
+    int hours, minutes, seconds, rest;
+    switch (qRound(fps)) {
+    case 24:
+        Rate24::split(frames, hours, minutes, seconds, rest);
+        break;
+    case 25:
+        Rate25::split(frames, hours, minutes, seconds, rest);
+        break;
+    case 30:
+        Rate30::split(frames, hours, minutes, seconds, rest);
+        break;
+    case 50:
+        Rate50::split(frames, hours, minutes, seconds, rest);
+        break;
+    case 60:
+        Rate60::split(frames, hours, minutes, seconds, rest);
+        break;
+    default:
+    {
+        int nominal = qMax(1, qRound(fps));
+        int totalSeconds = frames / nominal;
+        rest = frames % nominal;
+        seconds = totalSeconds % 60;
+        minutes = (totalSeconds / 60) % 60;
+        hours = totalSeconds / 3600;
+        break;
+    }
+    }
+
+    // Hours beyond 999 do not fit the buffer and do not occur in clips
+    char* it = writeNumber(buffer, qMin(hours, 999));
+    *it++ = ':';
+    it = writeNumber(it, minutes);
+    *it++ = ':';
+    it = writeNumber(it, seconds);
+    *it++ = separator;
+    it = writeNumber(it, rest);
+    *it = '\0';
+
+    return static_cast<int>(it - buffer);
+}
+
+/**
+ * @brief Timecode::parse
+ * Reads the four fields of a "hh:mm:ss:ff" timecode without creating any intermediate strings
+ * @param timecode - timecode string
+ * @param fields - receives hours, minutes, seconds and frames
+ * @return false when the timecode is malformed
+ */
+bool Timecode::parse(const QString& timecode, int fields[4])
+{
+    if (timecode.length() < 11)
+        return false;
+
+    for (int field = 0; field < 4; field++) {
+        fields[field] = 0;
+        for (int i = field * 3; i < field * 3 + 2; i++) {
+            int digit = timecode.at(i).digitValue();
+            if (digit < 0)
+                return false;
+            fields[field] = fields[field] * 10 + digit;
+        }
+    }
+
+    return true;
+}
+
+double Timecode::toTime(const QString& timecode, double fps)
+{
+    int fields[4];
+    if (!parse(timecode, fields))
+        return 0.0;
+
+    return (fields[0] * 3600) + (fields[1] * 60) + (fields[2]) + (fields[3] / fps);
+}
+
+/**
+ * @brief Timecode::framesFromTime
+ * Converts a time to a frame number that orders exactly like the timecode string
+ * produced by fromTime(): whole seconds count at the nominal rate, the remainder
+ * is truncated at the real rate.
+ * @param time - time in seconds
+ * @param fps - frame rate of the clip
+ * @return frame number
+ */
+int Timecode::framesFromTime(double time, double fps)
+{
+    int seconds = static_cast<int>(time);
+    int frames = static_cast<int>((time - seconds) * fps);
+
+    return seconds * qRound(fps) + frames;
+}
+
+/**
+ * @brief Timecode::framesFromTimecode
+ * Parses a "hh:mm:ss:ff" timecode into the frame number used by framesFromTime()
+ * without creating any intermediate strings.
+ * @param timecode - timecode string
+ * @param fps - frame rate of the clip
+ * @return frame number, -1 when the timecode is malformed
+ */
+int Timecode::framesFromTimecode(const QString& timecode, double fps)
+{
+    int fields[4];
+    if (!parse(timecode, fields))
+        return -1;
+
+    return ((fields[0] * 3600) + (fields[1] * 60) + fields[2]) * qRound(fps) + fields[3];
+}
+
+/**
+ * @brief Timecode::fromFrames
+ * Formats a frame number as returned by framesFromTimecode() back into "hh:mm:ss:ff"
+ * @param frames - frame number
+ * @param fps - frame rate of the clip
+ * @return timecode string
+ */
+QString Timecode::fromFrames(int frames, double fps)
+{
+    char buffer[BUFFER_SIZE];
+    int length = formatFrames(buffer, frames, fps);
+
+    return QString::fromLatin1(buffer, length);
+}
+
+/**
+ * @brief Timecode::timeFromFrames
+ * Inverse of framesFromTime(): the earliest playhead position at which the given frame is reached
+ * @param frames - frame number
+ * @param fps - frame rate of the clip
+ * @return time in seconds
+ */
+double Timecode::timeFromFrames(int frames, double fps)
+{
+    int nominal = qRound(fps);
+
+    return (frames / nominal) + (frames % nominal) / fps;
+}
+
+/**
+ * @brief Timecode::isDropFrame
+ * @param fps - frame rate of the clip
+ * @return true for the NTSC rates 29.97 and 59.94, whose timecode skips labels
+ */
+bool Timecode::isDropFrame(double fps)
+{
+    int nominal = qRound(fps);
+
+    return nominal % 30 == 0 && nominal > 0 && qAbs(fps - nominal * 1000.0 / 1001.0) < 0.005;
+}
+
+/**
+ * @brief Timecode::realFramesFromTime
+ * @param time - time in seconds
+ * @param fps - frame rate of the clip
+ * @return number of frames shown since the start, at the real rate
+ */
+int Timecode::realFramesFromTime(double time, double fps)
+{
+    // A thousandth of a frame absorbs the rounding of times that sit right on a frame
+    return static_cast<int>(time * fps + 0.001);
+}
+
+double Timecode::timeFromRealFrames(int frames, double fps)
+{
+    return frames / fps;
+}
+
+/**
+ * @brief Timecode::labelFromRealFrames
+ * Converts a real frame count into the frame number of its timecode label, counted at the
+ * nominal rate like framesFromTimecode(). Only drop-frame rates differ from the real count.
+ * @param frames - number of frames since the start
+ * @param fps - frame rate of the clip
+ * @return frame number of the label
+ */
+int Timecode::labelFromRealFrames(int frames, double fps)
+{
+    if (!isDropFrame(fps))
+        return frames;
 
-    return QString("%1:%2:%3%4%5").arg(hour, 2, 10, QChar('0'))
-                                .arg(minutes, 2, 10, QChar('0'))
-                                .arg(seconds, 2, 10, QChar('0'))
-                                .arg(useDropFrameNotation ? "." : ":")
-                                .arg(frames, 2, 10, QChar('0'));
+    return qRound(fps) == 30 ? Rate2997::label(frames) : Rate5994::label(frames);
 }
 
-double Timecode::toTime(QString timecode, double fps)
+/**
+ * @brief Timecode::realFramesFromLabel
+ * Inverse of labelFromRealFrames()
+ * @param label - frame number of the label
+ * @param fps - frame rate of the clip
+ * @return number of frames since the start
+ */
+int Timecode::realFramesFromLabel(int label, double fps)
 {
-    int hour = timecode.mid(0, 2).toInt();
-    int minutes = timecode.mid(3, 2).toInt();
-    int seconds = timecode.mid(6, 2).toInt();
-    int frames = timecode.mid(9, 2).toInt();
+    if (!isDropFrame(fps))
+        return label;
 
-    return (hour * 3600) + (minutes * 60) + (seconds) + (frames / fps);
+    return qRound(fps) == 30 ? Rate2997::frames(label) : Rate5994::frames(label);
 }
@@ -6,15 +6,83 @@
 
 #include "Share.h"
 
+/**
+ * @brief The FrameRate struct
+ * Frame counting of one frame rate, fixed at compile time such that all divisions
+ * become multiplications. Drop-frame rates (29.97, 59.94) skip the first labels of
+ * every minute, except every tenth minute, to keep the timecode in line with the clock.
+ */
+template <int Nominal, bool DropFrame>
+struct FrameRate
+{
+    static constexpr int nominal = Nominal;
+    static constexpr int dropped = DropFrame ? Nominal / 15 : 0;
+    static constexpr int perMinute = Nominal * 60 - dropped;
+    static constexpr int perTenMinutes = Nominal * 600 - 9 * dropped;
+
+    // Real frame count to timecode label, counted at the nominal rate
+    static int label(int frames)
+    {
+        if (!DropFrame)
+            return frames;
+        int tens = frames / perTenMinutes;
+        int rest = frames % perTenMinutes;
+        int skipped = 9 * dropped * tens;
+        if (rest > dropped)
+            skipped += dropped * ((rest - dropped) / perMinute);
+        return frames + skipped;
+    }
+
+    // Timecode label to real frame count
+    static int frames(int label)
+    {
+        if (!DropFrame)
+            return label;
+        int minutes = label / (Nominal * 60);
+        return label - dropped * (minutes - minutes / 10);
+    }
+
+    static void split(int label, int& hours, int& minutes, int& seconds, int& frames)
+    {
+        int totalSeconds = label / Nominal;
+        frames = label % Nominal;
+        seconds = totalSeconds % 60;
+        minutes = (totalSeconds / 60) % 60;
+        hours = totalSeconds / 3600;
+    }
+};
+
+typedef FrameRate<24, false> Rate24;
+typedef FrameRate<25, false> Rate25;
+typedef FrameRate<30, false> Rate30;
+typedef FrameRate<30, true> Rate2997;
+typedef FrameRate<50, false> Rate50;
+typedef FrameRate<60, false> Rate60;
+typedef FrameRate<60, true> Rate5994;
 
 class COMMONSHARED_EXPORT Timecode
 {
     public:
+        // Room for "hhh:mm:ss:ff" and the terminating zero
+        static const int BUFFER_SIZE = 16;
+
         static QString fromTime(const QTime& time, bool useDropFrameNotation);
         static QString fromTime(double time, double fps, bool useDropFrameNotation);
-        static double toTime(QString timecode, double fps);
+        static int format(char* buffer, double time, double fps, bool useDropFrameNotation);
+        static int formatFrames(char* buffer, int frames, double fps, char separator = ':');
+        static double toTime(const QString& timecode, double fps);
+        static int framesFromTime(double time, double fps);
+        static int framesFromTimecode(const QString& timecode, double fps);
+        static QString fromFrames(int frames, double fps);
+        static double timeFromFrames(int frames, double fps);
+        static bool isDropFrame(double fps);
+        static int realFramesFromTime(double time, double fps);
+        static double timeFromRealFrames(int frames, double fps);
+        static int labelFromRealFrames(int frames, double fps);
+        static int realFramesFromLabel(int label, double fps);
 private:
         Timecode() {}
+        static bool parse(const QString& timecode, int fields[4]);
 };
 
 #endif // TIMECODE_H
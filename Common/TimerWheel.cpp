@@ -0,0 +1,170 @@
+#include "TimerWheel.h"
+
+// A handle holds the index of the timer in its low bits and the generation of the
+// timer above them, such that the handle of an expired timer cannot cancel its successor
+static const int INDEX_BITS = 16;
+static const int INDEX_MASK = (1 << INDEX_BITS) - 1;
+
+TimerWheel::TimerWheel(int capacity)
+{
+    for (int i = 0; i <= EXPIRED; i++) {
+        m_heads[i] = NIL;
+    }
+    m_timers.reserve(qMin(capacity, INDEX_MASK + 1));
+}
+
+/**
+ * @brief TimerWheel::start
+ * Start a one-shot timer
+ * @param ticks - number of ticks until the timer expires, at least one
+ * @param payload - handed back when the timer expires
+ * @return handle to cancel the timer, -1 when the wheel is full
+ */
+int TimerWheel::start(quint32 ticks, quint32 payload)
+{
+    int index = acquire();
+    if (index == NIL) {
+        return -1;
+    }
+    timer& it = m_timers[index];
+    // Longer delays do not fit the wheel
+    it.expires = m_now + qBound(1u, ticks, (1u << (BITS * LEVELS)) - 1);
+    it.payload = payload;
+    place(index);
+    m_count++;
+    return static_cast<int>(((it.generation & 0x7FFF) << INDEX_BITS) | static_cast<quint32>(index));
+}
+
+/**
+ * @brief TimerWheel::cancel
+ * @param handle - handle returned by start()
+ * @return false when the timer already expired or was cancelled
+ */
+bool TimerWheel::cancel(int handle)
+{
+    if (handle < 0) {
+        return false;
+    }
+    int index = handle & INDEX_MASK;
+    if (index >= m_timers.size() || m_timers[index].list == NIL ||
+            (m_timers[index].generation & 0x7FFF) != static_cast<quint32>(handle >> INDEX_BITS)) {
+        return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void TimerWheel::clear()
+{
+    for (int i = 0; i < m_timers.size(); i++) {
+        if (m_timers[i].list != NIL) {
+            unlink(i);
+            release(i);
+        }
+    }
+}
+
+/**
+ * @brief TimerWheel::tick
+ * Advance one tick. Whenever a level has gone round, the next slot of the level above
+ * is spread over the levels below; the timers of the current slot of the lowest level
+ * have then expired.
+ */
+void TimerWheel::tick()
+{
+    m_now++;
+    for (int level = 1; level < LEVELS; level++) {
+        if ((m_now & ((quint64(1) << (BITS * level)) - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+    int slot = static_cast<int>(m_now & (SLOTS - 1));
+    while (m_heads[slot] != NIL) {
+        int index = m_heads[slot];
+        unlink(index);
+        link(index, EXPIRED);
+    }
+}
+
+void TimerWheel::cascade(int level)
+{
+    int list = level * SLOTS + static_cast<int>((m_now >> (BITS * level)) & (SLOTS - 1));
+    while (m_heads[list] != NIL) {
+        int index = m_heads[list];
+        unlink(index);
+        place(index);
+    }
+}
+
+/**
+ * @brief TimerWheel::place
+ * Put a timer in the slot of the lowest level that reaches its expiry
+ */
+void TimerWheel::place(int index)
+{
+    quint64 expires = m_timers[index].expires;
+    quint64 delta = expires - m_now;
+    if (expires <= m_now) {
+        link(index, EXPIRED);
+        return;
+    }
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (quint64(1) << (BITS * (level + 1)))) {
+        level++;
+    }
+    link(index, level * SLOTS + static_cast<int>((expires >> (BITS * level)) & (SLOTS - 1)));
+}
+
+void TimerWheel::link(int index, int list)
+{
+    timer& it = m_timers[index];
+    it.list = list;
+    it.previous = NIL;
+    it.next = m_heads[list];
+    if (it.next != NIL) {
+        m_timers[it.next].previous = index;
+    }
+    m_heads[list] = index;
+}
+
+void TimerWheel::unlink(int index)
+{
+    timer& it = m_timers[index];
+    if (it.previous != NIL) {
+        m_timers[it.previous].next = it.next;
+    } else {
+        m_heads[it.list] = it.next;
+    }
+    if (it.next != NIL) {
+        m_timers[it.next].previous = it.previous;
+    }
+    it.list = NIL;
+    it.previous = NIL;
+    it.next = NIL;
+}
+
+int TimerWheel::acquire()
+{
+    if (m_free != NIL) {
+        int index = m_free;
+        m_free = m_timers[index].next;
+        m_timers[index].next = NIL;
+        return index;
+    }
+    if (m_timers.size() > INDEX_MASK) {
+        return NIL;
+    }
+    m_timers.append(timer());
+    return m_timers.size() - 1;
+}
+
+void TimerWheel::release(int index)
+{
+    timer& it = m_timers[index];
+    it.generation++;
+    it.next = m_free;
+    m_free = index;
+    m_count--;
+}
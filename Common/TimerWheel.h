@@ -0,0 +1,78 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QtCore/QVector>
+
+#include "Share.h"
+
+/**
+ * @brief The TimerWheel class
+ * Hierarchical timing wheel holding any number of one-shot timers. Starting and
+ * cancelling a timer and advancing the wheel by one tick all take constant time,
+ * whatever the number of running timers. Every timer carries a 32 bit payload that
+ * is handed back when it expires. Timers are stored in a pool that only grows,
+ * so a running wheel does not allocate.
+ */
+class COMMONSHARED_EXPORT TimerWheel
+{
+public:
+    explicit TimerWheel(int capacity = 256);
+    int start(quint32 ticks, quint32 payload);
+    bool cancel(int handle);
+    void clear();
+    bool isEmpty() const { return m_count == 0; }
+    int count() const { return m_count; }
+    quint64 getNow() const { return m_now; }
+
+    /**
+     * @brief advance
+     * Move the wheel forward and report every timer that expired on the way
+     * @param ticks - number of ticks to advance
+     * @param expired - called with the payload of every expired timer
+     */
+    template <typename Function>
+    void advance(quint64 ticks, Function expired)
+    {
+        while (ticks-- > 0) {
+            tick();
+            while (m_heads[EXPIRED] != NIL) {
+                int index = m_heads[EXPIRED];
+                quint32 payload = m_timers[index].payload;
+                unlink(index);
+                release(index);
+                expired(payload);
+            }
+        }
+    }
+
+private:
+    static const int LEVELS = 4;
+    static const int BITS = 6;
+    static const int SLOTS = 1 << BITS;
+    static const int NIL = -1;
+    static const int EXPIRED = LEVELS * SLOTS;
+
+    struct timer {
+        quint64 expires = 0;
+        quint32 payload = 0;
+        quint32 generation = 0;
+        int list = NIL;
+        int previous = NIL;
+        int next = NIL;
+    };
+
+    QVector<timer> m_timers;
+    int m_heads[LEVELS * SLOTS + 1];
+    int m_free = NIL;
+    int m_count = 0;
+    quint64 m_now = 0;
+    void tick();
+    void cascade(int level);
+    void place(int index);
+    void link(int index, int list);
+    void unlink(int index);
+    int acquire();
+    void release(int index);
+};
+
+#endif // TIMERWHEEL_H
@@ -28,6 +28,7 @@ SOURCES += \
     DeviceManager.cpp \
     Models/DeviceModel.cpp \
     Models/LibraryModel.cpp \
+    Models/OscOutputModel.cpp \
     Models/ClipInfo.cpp
 
 HEADERS += \
@@ -35,6 +36,7 @@ HEADERS += \
         DeviceManager.h \
         Models/DeviceModel.h \
         Models/LibraryModel.h \
+        Models/OscOutputModel.h \
         Models/ClipInfo.h \
         Shared.h
 
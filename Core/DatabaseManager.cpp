@@ -367,6 +367,27 @@ void DatabaseManager::deleteDevice(int id)
     QSqlDatabase::database().commit();
 }
 
+/**
+ * @brief DatabaseManager::getOscOutput
+ * Get a list of all OSC targets
+ * @return List of OscOutputModel class objects
+ */
+QList<OscOutputModel> DatabaseManager::getOscOutput()
+{
+    QMutexLocker locker(&mutex);
+
+    QSqlQuery sql;
+    if (!sql.exec("SELECT o.Id, o.Name, o.Address, o.Port, o.Description FROM OscOutput o ORDER BY o.Name"))
+        qCritical("Failed to execute sql query: %s, Error: %s", qPrintable(sql.lastQuery()), qPrintable(sql.lastError().text()));
+
+    QList<OscOutputModel> models;
+    while (sql.next())
+        models.push_back(OscOutputModel(sql.value(0).toInt(), sql.value(1).toString(), sql.value(2).toString(), sql.value(3).toInt(),
+                                        sql.value(4).toString()));
+
+    return models;
+}
+
 
 /*******************************************
  * Data functions for handling media clips *
@@ -6,6 +6,7 @@
 
 #include "Models/DeviceModel.h"
 #include "Models/LibraryModel.h"
+#include "Models/OscOutputModel.h"
 #include "Models/ClipInfo.h"
 
 
@@ -29,6 +30,9 @@ public:
     void updateDevice(const DeviceModel &model);
     void deleteDevice(int id);
 
+    // Targets the cues are sent to as OSC
+    QList<OscOutputModel> getOscOutput();
+
     // Data functions for handling media clips
     void updateLibraryMedia(const QList<LibraryModel>& insertModels);
     void copyClipsTo(QList<int> clipIds, QString tableName);
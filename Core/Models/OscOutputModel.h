@@ -0,0 +1,27 @@
+#ifndef OSCOUTPUTMODEL_H
+#define OSCOUTPUTMODEL_H
+
+#include "../Shared.h"
+
+#include <QtCore/QString>
+
+class CORESHARED_EXPORT OscOutputModel
+{
+    public:
+        explicit OscOutputModel(int id, const QString& name, const QString& address, int port, const QString& description);
+
+        int getId() const;
+        int getPort() const;
+        const QString& getName() const;
+        const QString& getAddress() const;
+        const QString& getDescription() const;
+
+    private:
+        int id;
+        int port;
+        QString name;
+        QString address;
+        QString description;
+};
+
+#endif // OSCOUTPUTMODEL_H
@@ -1,11 +1,13 @@
 TEMPLATE = subdirs
 
 SUBDIRS += \
+    Bench \
     Caspar \
     Common \
     Core \
     CuteCaspar \
     QMidi
 
+Bench.depends = Common QMidi
 Core.depends = Caspar Common
 CuteCaspar.depends = Caspar Common Core
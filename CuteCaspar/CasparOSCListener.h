@@ -8,14 +8,18 @@
 #include <osc/OscPacketListener.h>
 #include <ip/UdpSocket.h>
 
+#include "OscRouter.h"
+
 class CasparOscListener : public QObject, public osc::OscPacketListener
 {
     Q_OBJECT
-signals:
-    void messageAvailable(QStringList address, QStringList values);
+public:
+    OscRouter& getRouter() { return m_router; }
 protected:
     virtual void ProcessMessage( const osc::ReceivedMessage& m,
                                  const IpEndpointName& remoteEndpoint );
+private:
+    OscRouter m_router;
 };
 
 #endif // CASPAROSCLISTENER_H
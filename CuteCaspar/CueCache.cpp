@@ -0,0 +1,237 @@
+#include "CueCache.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QSettings>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+#include "CueFile.h"
+
+Q_GLOBAL_STATIC(CueCache, s_cueCache)
+
+CueCache::CueCache()
+{
+    // The watcher must live in the GUI thread, also when a worker thread creates the cache
+    if (QCoreApplication::instance()) {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, SIGNAL(fileChanged(QString)),
+            this, SLOT(fileChanged(QString)));
+
+    QSettings settings("VRT", "CasparCGClient");
+    settings.beginGroup("Configuration");
+    m_capacity = settings.value("cue_cache_bytes", 64 * 1024 * 1024).toLongLong();
+    settings.endGroup();
+}
+
+CueCache* CueCache::getInstance()
+{
+    return s_cueCache;
+}
+
+/**
+ * @brief CueCache::getTrack
+ * Return the cue track of a clip, from the cache when the sidecar has not changed since
+ * it was loaded. Can be called from any thread.
+ * @param clipName - name of the clip
+ * @param fps - frame rate of the clip
+ * @return the cue track, empty when the clip has no sidecar
+ */
+CueTrack CueCache::getTrack(QString clipName, double fps)
+{
+    QString key = QString("%1@%2").arg(clipName).arg(fps);
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            it->lastUsed = ++m_clock;
+            m_statistics.hits++;
+            return it->track;
+        }
+        m_statistics.misses++;
+    }
+
+    // Load outside the lock, such that a slow disk does not block other clips
+    QString source = CueFile::sourceName(clipName);
+    QFileInfo info(source);
+    if (!info.exists()) {
+        return CueTrack(fps);
+    }
+    cacheEntry entry;
+    entry.track = CueFile::open(clipName, fps);
+    entry.source = info.absoluteFilePath();
+    entry.size = info.size();
+    entry.modified = info.lastModified().toMSecsSinceEpoch();
+    entry.fileId = fileId(source);
+    entry.bytes = static_cast<qint64>(sizeof(cacheEntry)) + static_cast<qint64>(entry.track.count()) * static_cast<qint64>(sizeof(cue));
+
+    QMutexLocker locker(&m_mutex);
+    insert(key, entry);
+    return entry.track;
+}
+
+/**
+ * @brief CueCache::invalidate
+ * Drop all cached tracks of a clip
+ * @param clipName - name of the clip
+ */
+void CueCache::invalidate(QString clipName)
+{
+    // The clip may have switched between its CSV and its MIDI file
+    QString csv = QFileInfo(CueFile::sidecarName(clipName)).absoluteFilePath();
+    QString smf = QFileInfo(CueFile::smfName(clipName)).absoluteFilePath();
+
+    QMutexLocker locker(&m_mutex);
+    QStringList keys;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        if (it->source == csv || it->source == smf) {
+            keys.append(it.key());
+        }
+    }
+    for (const QString& key : keys) {
+        remove(key);
+    }
+}
+
+/**
+ * @brief CueCache::setCapacity
+ * @param bytes - maximum amount of memory used by the cached tracks
+ */
+void CueCache::setCapacity(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_capacity = bytes;
+    trim();
+}
+
+cacheStatistics CueCache::getStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    cacheStatistics statistics = m_statistics;
+    statistics.entries = m_entries.size();
+    return statistics;
+}
+
+/**
+ * @brief CueCache::fileChanged
+ * A watched sidecar was modified, replaced or removed. Tracks are only dropped when the
+ * identity of the file (size, modification time and inode) has really changed.
+ * @param path - path of the sidecar
+ */
+void CueCache::fileChanged(const QString& path)
+{
+    QFileInfo info(path);
+    qint64 size = info.exists() ? info.size() : -1;
+    qint64 modified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+    quint64 id = fileId(path);
+
+    QMutexLocker locker(&m_mutex);
+    QStringList keys;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        if (it->source == path && (it->size != size || it->modified != modified || it->fileId != id)) {
+            keys.append(it.key());
+        }
+    }
+    for (const QString& key : keys) {
+        remove(key);
+    }
+    if (!keys.isEmpty()) {
+        qDebug() << "Cue cache dropped" << path;
+    }
+}
+
+/**
+ * @brief CueCache::insert
+ * Add an entry and evict least recently used entries until the cache fits its capacity.
+ * Call with the mutex locked.
+ * @param key - cache key
+ * @param entry - the entry
+ */
+void CueCache::insert(const QString& key, const cacheEntry& entry)
+{
+    if (m_entries.contains(key)) {
+        remove(key);
+    }
+    cacheEntry newEntry = entry;
+    newEntry.lastUsed = ++m_clock;
+    m_entries.insert(key, newEntry);
+    m_statistics.bytes += newEntry.bytes;
+
+    // Watch from the thread the watcher lives in
+    QString source = entry.source;
+    QMetaObject::invokeMethod(this, [this, source]() {
+        if (!m_watcher->files().contains(source)) {
+            m_watcher->addPath(source);
+        }
+    });
+
+    trim();
+}
+
+/**
+ * @brief CueCache::trim
+ * Evict least recently used entries until the cache fits its capacity. Call with the mutex locked.
+ */
+void CueCache::trim()
+{
+    while (m_statistics.bytes > m_capacity && m_entries.size() > 1) {
+        auto oldest = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->lastUsed < oldest->lastUsed) {
+                oldest = it;
+            }
+        }
+        remove(oldest.key());
+        m_statistics.evictions++;
+    }
+}
+
+/**
+ * @brief CueCache::remove
+ * Remove an entry and stop watching its sidecar when no other entry uses it.
+ * Call with the mutex locked.
+ * @param key - cache key
+ */
+void CueCache::remove(const QString& key)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return;
+    }
+    QString source = it->source;
+    m_statistics.bytes -= it->bytes;
+    m_entries.erase(it);
+
+    for (auto other = m_entries.constBegin(); other != m_entries.constEnd(); ++other) {
+        if (other->source == source) {
+            return;
+        }
+    }
+    QMetaObject::invokeMethod(this, [this, source]() {
+        m_watcher->removePath(source);
+    });
+}
+
+/**
+ * @brief CueCache::fileId
+ * @param fileName - file name
+ * @return inode of the file where the platform has one, 0 otherwise
+ */
+quint64 CueCache::fileId(const QString& fileName)
+{
+#ifdef Q_OS_UNIX
+    struct stat buffer;
+    if (stat(QFile::encodeName(fileName).constData(), &buffer) == 0) {
+        return static_cast<quint64>(buffer.st_ino);
+    }
+#else
+    Q_UNUSED(fileName)
+#endif
+    return 0;
+}
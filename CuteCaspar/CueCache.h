@@ -0,0 +1,63 @@
+#ifndef CUECACHE_H
+#define CUECACHE_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+
+#include "CueTrack.h"
+
+struct cacheStatistics {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    qint64 bytes = 0;
+    int entries = 0;
+};
+
+/**
+ * @brief The CueCache class
+ * Process wide cache of loaded cue tracks, shared by the player, the editor and the
+ * library scan. The cache is bounded on the memory used by the tracks and drops the
+ * least recently used track first. Sidecars are watched, a changed sidecar is dropped
+ * from the cache immediately. Tracks are implicitly shared, so handing one out is cheap.
+ */
+class CueCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    CueCache();
+    static CueCache* getInstance();
+    CueTrack getTrack(QString clipName, double fps);
+    void invalidate(QString clipName);
+    void setCapacity(qint64 bytes);
+    cacheStatistics getStatistics() const;
+
+private slots:
+    void fileChanged(const QString& path);
+
+private:
+    struct cacheEntry {
+        CueTrack track;
+        QString source;
+        qint64 size;
+        qint64 modified;
+        quint64 fileId;
+        qint64 bytes;
+        quint64 lastUsed;
+    };
+    mutable QMutex m_mutex;
+    QHash<QString, cacheEntry> m_entries;
+    QFileSystemWatcher* m_watcher;
+    qint64 m_capacity;
+    quint64 m_clock = 0;
+    cacheStatistics m_statistics;
+    void insert(const QString& key, const cacheEntry& entry);
+    void trim();
+    void remove(const QString& key);
+    static quint64 fileId(const QString& fileName);
+};
+
+#endif // CUECACHE_H
@@ -0,0 +1,107 @@
+#include "CueDispatcher.h"
+
+#include <QDebug>
+
+CueDispatcher::CueDispatcher()
+{
+}
+
+/**
+ * @brief CueDispatcher::setTrack
+ * Load a new track and start at its first cue
+ * @param track - the cue track to be followed
+ */
+void CueDispatcher::setTrack(const CueTrack& track)
+{
+    m_track = track;
+    m_cursor = 0;
+}
+
+/**
+ * @brief CueDispatcher::setLatePolicy
+ * @param policy - what to do with cues that are handed out too late
+ * @param tolerance - number of frames a cue may be behind the playhead before it counts as late
+ */
+void CueDispatcher::setLatePolicy(LateCuePolicy policy, int tolerance)
+{
+    m_policy = policy;
+    m_tolerance = tolerance;
+}
+
+/**
+ * @brief CueDispatcher::takeBatch
+ * Hand out all cues of the next frame that is due at the given playhead frame. Call
+ * repeatedly until it returns false to catch up with everything that has passed since
+ * the previous tick.
+ * @param frame - last frame to hand out, ahead of the playhead by the lead of the outputs
+ * @param playhead - current playhead frame, cues are late against this one
+ * @param batch - receives a pointer to the first cue of the frame
+ * @param size - receives the number of cues on the frame
+ * @param late - set when the frame is behind the playhead by more than the tolerance
+ * @return true when a batch of cues has to be played
+ */
+bool CueDispatcher::takeBatch(int frame, int playhead, const cue*& batch, int& size, bool& late)
+{
+    while (m_cursor < m_track.count() && m_track.at(m_cursor).frame <= frame) {
+        int end = m_track.endOfFrame(m_cursor);
+        batch = m_track.data() + m_cursor;
+        size = end - m_cursor;
+        m_cursor = end;
+        late = (playhead - batch->frame > m_tolerance);
+        if (late) {
+            m_statistics.late += size;
+            if (m_policy == LateCuePolicy::SKIP) {
+                m_statistics.skipped += size;
+                continue;
+            }
+            if (m_policy == LateCuePolicy::FLAG) {
+                qWarning() << "Late cues at frame" << batch->frame << "played at frame" << playhead;
+            }
+        }
+        m_statistics.fired += size;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief CueDispatcher::nextFrame
+ * @return frame of the next cue to be played, -1 at the end of the track
+ */
+int CueDispatcher::nextFrame() const
+{
+    if (m_cursor < m_track.count()) {
+        return m_track.at(m_cursor).frame;
+    }
+    return -1;
+}
+
+/**
+ * @brief CueDispatcher::seek
+ * Reposition the cursor such that the cues at the given frame are the next to be played
+ * @param frame - new playhead frame
+ */
+void CueDispatcher::seek(int frame)
+{
+    m_cursor = m_track.indexOf(frame);
+}
+
+/**
+ * @brief CueDispatcher::skipTo
+ * Pass all cues up to and including the given frame without playing them
+ * @param frame - current playhead frame
+ */
+void CueDispatcher::skipTo(int frame)
+{
+    m_cursor = qMax(m_cursor, m_track.indexOf(frame + 1));
+}
+
+void CueDispatcher::rewind()
+{
+    m_cursor = 0;
+}
+
+void CueDispatcher::resetStatistics()
+{
+    m_statistics = dispatchStatistics();
+}
@@ -0,0 +1,58 @@
+#ifndef CUEDISPATCHER_H
+#define CUEDISPATCHER_H
+
+#include "CueTrack.h"
+
+enum class LateCuePolicy
+{
+    FIRE,
+    SKIP,
+    FLAG
+};
+
+// What happens to the outputs when the playhead jumps
+enum class SeekMode
+{
+    SILENT,     // only reposition the cursor
+    CHASE       // also play the cues that are in effect at the new position
+};
+
+struct dispatchStatistics {
+    quint64 fired = 0;
+    quint64 late = 0;
+    quint64 skipped = 0;
+};
+
+/**
+ * @brief The CueDispatcher class
+ * Follows the playhead of one video layer through a cue track. Every cue in
+ * the window (previous playhead, current playhead] is handed out, so cues are
+ * never lost when OSC time updates are dropped or delayed. Cues that share a
+ * frame are handed out together as one batch.
+ */
+class CueDispatcher
+{
+public:
+    CueDispatcher();
+    void setTrack(const CueTrack& track);
+    const CueTrack& getTrack() const { return m_track; }
+    bool isEmpty() const { return m_track.isEmpty(); }
+    int frameAt(double time) const { return m_track.frameAt(time); }
+    void setLatePolicy(LateCuePolicy policy, int tolerance);
+    bool takeBatch(int frame, int playhead, const cue*& batch, int& size, bool& late);
+    int nextFrame() const;
+    void seek(int frame);
+    void skipTo(int frame);
+    void rewind();
+    dispatchStatistics getStatistics() const { return m_statistics; }
+    void resetStatistics();
+
+private:
+    CueTrack m_track;
+    int m_cursor = 0;
+    LateCuePolicy m_policy = LateCuePolicy::FIRE;
+    int m_tolerance = 2;
+    dispatchStatistics m_statistics;
+};
+
+#endif // CUEDISPATCHER_H
@@ -0,0 +1,995 @@
+#include "CueEngine.h"
+
+#include <QDebug>
+#include <QSettings>
+
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "MidiConnection.h"
+#include "MidiNotes.h"
+#include "DmxOutput.h"
+#include "MtcGenerator.h"
+#include "OutputLatency.h"
+
+CueEngine* CueEngine::s_inst = nullptr;
+
+// OSC addresses of the layer time reports: PREFIX<layer>SUFFIX
+static const char TIME_PREFIX[] = "/channel/1/stage/layer/";
+static const char* TIME_SUFFIXES[] = {"/file/time", "/foreground/file/time"};
+
+// A forward step of the playhead larger than this (in seconds) is a jump, not playback
+static const double JUMP = 1.0;
+
+// Resolution of the timed notes in milliseconds
+static const int WHEEL_TICK = 5;
+
+CueEngine::CueEngine()
+{
+    // Load the policy for cues that are played too late
+    QSettings settings("VRT", "CasparCGClient");
+    settings.beginGroup("Configuration");
+    QString policyName = settings.value("late_cue_policy", "fire").toString();
+    int tolerance = settings.value("late_cue_tolerance", 2).toInt();
+    int lookAhead = settings.value("cue_look_ahead", 100).toInt();
+    if (settings.value("cue_seek_mode", "chase").toString() == "silent") {
+        m_seekMode = SeekMode::SILENT;
+    }
+    settings.endGroup();
+    LateCuePolicy policy = LateCuePolicy::FIRE;
+    if (policyName == "skip") {
+        policy = LateCuePolicy::SKIP;
+    } else if (policyName == "flag") {
+        policy = LateCuePolicy::FLAG;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        CueLayer layer = static_cast<CueLayer>(i);
+        m_layers[i].dispatcher.setLatePolicy(policy, tolerance);
+        m_layers[i].scheduler = new CueScheduler(m_layers[i].dispatcher, this);
+        m_layers[i].scheduler->setLookAhead(lookAhead);
+        connect(m_layers[i].scheduler, &CueScheduler::cuesDue, this, [this, layer](int frame) {
+            // The timer fires at the instant the frame is due, its cues are never late
+            playDueCues(layer, frame, frame);
+        });
+    }
+    m_layers[static_cast<int>(CueLayer::SOUNDSCAPE)].loop = true;
+    m_layers[static_cast<int>(CueLayer::SOUNDSCAPE)].dmxSource = DmxSource::SOUNDSCAPE;
+
+    // Durations and follow-up notes, copied such that the engine thread never looks them up
+    for (int i = 0; i < 256; i++) {
+        m_duration[i] = 0;
+        m_next[i] = 0;
+        m_chain[i] = -1;
+        m_dmxChannel[i] = -1;
+        m_dmxLevel[i] = 0;
+    }
+    for (const note& it : MidiNotes::getInstance()->getNotes()) {
+        if (it.pitch < 256) {
+            m_duration[it.pitch] = it.duration;
+            m_next[it.pitch] = it.next < 256 ? it.next : 0;
+            m_dmxChannel[it.pitch] = it.dmxChannel;
+            m_dmxLevel[it.pitch] = it.dmxLevel;
+        }
+    }
+    m_wheelTimer = new QTimer(this);
+    m_wheelTimer->setTimerType(Qt::PreciseTimer);
+    m_wheelTimer->setInterval(WHEEL_TICK);
+    connect(m_wheelTimer, SIGNAL(timeout()),
+            this, SLOT(advanceChains()));
+    m_wheelClock.start();
+
+    for (unsigned int i = 0; i < DATAGRAM_SLOTS; i++) {
+        m_freeDatagrams.push(static_cast<int>(i));
+    }
+
+    // Delayed MIDI batches go out from one timer, for the earliest batch that is due
+    m_delayTimer = new QTimer(this);
+    m_delayTimer->setTimerType(Qt::PreciseTimer);
+    m_delayTimer->setSingleShot(true);
+    connect(m_delayTimer, SIGNAL(timeout()),
+            this, SLOT(sendDelayedMidi()));
+
+    // Cues are handed out ahead of the video to make up for the latency of the outputs
+    connect(OutputLatency::getInstance(), SIGNAL(latencyChanged()),
+            this, SLOT(updateLatency()));
+    updateLatency();
+}
+
+CueEngine* CueEngine::getInstance()
+{
+    if (!s_inst) {
+        s_inst = new CueEngine();
+    }
+    return s_inst;
+}
+
+/**
+ * @brief CueEngine::start
+ * Move the engine to its own thread and start listening for OSC messages
+ * @param oscPort - UDP port the server sends its OSC messages to
+ */
+void CueEngine::start(quint16 oscPort)
+{
+    if (m_thread.isRunning()) {
+        return;
+    }
+    m_port = oscPort;
+    moveToThread(&m_thread);
+    connect(&m_thread, SIGNAL(started()),
+            this, SLOT(open()));
+    m_thread.start(QThread::TimeCriticalPriority);
+}
+
+void CueEngine::stop()
+{
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief CueEngine::open
+ * First thing to run in the engine thread
+ */
+void CueEngine::open()
+{
+    setRealtime();
+    m_socket = new QUdpSocket(this);
+    if (!m_socket->bind(QHostAddress::Any, m_port)) {
+        qWarning() << "Cue engine cannot listen on OSC port" << m_port << m_socket->errorString();
+    }
+    connect(m_socket, SIGNAL(readyRead()),
+            this, SLOT(readDatagrams()));
+}
+
+/**
+ * @brief CueEngine::setRealtime
+ * Optionally give the engine thread real-time priority and pin it to a CPU (Linux only)
+ */
+void CueEngine::setRealtime()
+{
+    QSettings settings("VRT", "CasparCGClient");
+    settings.beginGroup("Configuration");
+    bool realtime = settings.value("cue_engine_realtime", false).toBool();
+    int priority = settings.value("cue_engine_priority", 50).toInt();
+    int cpu = settings.value("cue_engine_cpu", -1).toInt();
+    settings.endGroup();
+
+#ifdef Q_OS_LINUX
+    if (realtime) {
+        sched_param param;
+        param.sched_priority = qBound(sched_get_priority_min(SCHED_FIFO), priority, sched_get_priority_max(SCHED_FIFO));
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            qWarning("Cue engine cannot use SCHED_FIFO: %s", strerror(error));
+        } else {
+            qDebug("Cue engine runs SCHED_FIFO at priority %d", param.sched_priority);
+        }
+    }
+    if (cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (error != 0) {
+            qWarning("Cue engine cannot be pinned to CPU %d: %s", cpu, strerror(error));
+        } else {
+            qDebug("Cue engine pinned to CPU %d", cpu);
+        }
+    }
+#else
+    Q_UNUSED(priority)
+    if (realtime || cpu >= 0) {
+        qDebug("Real-time priority and CPU affinity of the cue engine are only available on Linux");
+    }
+#endif
+}
+
+/**
+ * @brief CueEngine::readDatagrams
+ * Play the cues of every time report right away, then pass the datagram on to the GUI.
+ * Reading and parsing work in a fixed buffer, the GUI gets a copy in a slot of the pool;
+ * nothing is allocated per datagram. A datagram is dropped for the GUI when the pool has
+ * run out or when it does not fit in a slot.
+ */
+void CueEngine::readDatagrams()
+{
+    while (m_socket->hasPendingDatagrams()) {
+        qint64 size = m_socket->readDatagram(m_packet, PACKET_SIZE);
+        if (size < 0) {
+            break;
+        }
+        if (size < 5 || memcmp(m_packet, "raspi", 5) != 0) {
+            try {
+                ProcessPacket(m_packet, static_cast<int>(size), IpEndpointName());
+            } catch (osc::Exception& e) {
+                qDebug() << "error while parsing packet:" << e.what();
+            }
+        }
+        int slot;
+        if (size > oscDatagram::SIZE || !m_freeDatagrams.pop(slot)) {
+            m_droppedDatagrams++;
+            continue;
+        }
+        memcpy(m_datagramPool[slot].data, m_packet, static_cast<size_t>(size));
+        m_datagramPool[slot].size = static_cast<int>(size);
+        // Cannot fail, the ring holds the whole pool
+        m_datagrams.push(slot);
+    }
+    if (m_datagramsNotified.testAndSetOrdered(0, 1)) {
+        emit datagramsPending();
+    }
+}
+
+/**
+ * @brief CueEngine::ProcessMessage
+ * Pick the layer time reports out of the OSC stream without building any strings
+ */
+void CueEngine::ProcessMessage(const osc::ReceivedMessage& m, const IpEndpointName& remoteEndpoint)
+{
+    Q_UNUSED(remoteEndpoint)
+    const char* address = m.AddressPattern();
+    if (strncmp(address, TIME_PREFIX, sizeof(TIME_PREFIX) - 1) != 0) {
+        return;
+    }
+    const char* it = address + sizeof(TIME_PREFIX) - 1;
+    int videoLayer = 0;
+    if (*it < '0' || *it > '9') {
+        return;
+    }
+    while (*it >= '0' && *it <= '9') {
+        videoLayer = videoLayer * 10 + (*it++ - '0');
+    }
+    if (strcmp(it, TIME_SUFFIXES[0]) != 0 && strcmp(it, TIME_SUFFIXES[1]) != 0) {
+        return;
+    }
+    if (m.ArgumentCount() == 0) {
+        return;
+    }
+    osc::ReceivedMessage::const_iterator arg = m.ArgumentsBegin();
+    double time;
+    if (arg->IsFloat()) {
+        time = static_cast<double>(arg->AsFloat());
+    } else if (arg->IsDouble()) {
+        time = arg->AsDouble();
+    } else {
+        return;
+    }
+    timecode(videoLayer, time);
+}
+
+/**
+ * @brief CueEngine::timecode
+ * Process a time report of a video layer for the cue layers that follow it
+ * @param videoLayer - video layer of the report
+ * @param time - playhead position of the video layer in seconds
+ */
+void CueEngine::timecode(int videoLayer, double time)
+{
+    if (time <= 0.0) {
+        return;
+    }
+    MtcGenerator* generator = m_mtcGenerator.loadAcquire();
+    if (generator) {
+        generator->timecode(videoLayer, time);
+    }
+    for (int i = 0; i < 2; i++) {
+        cueLayer& layer = m_layers[i];
+        if (layer.videoLayer != videoLayer) {
+            continue;
+        }
+        if (m_externalClock && i == static_cast<int>(CueLayer::PLAYLIST)) {
+            // The playlist cues follow the external clock, see externalTime()
+            continue;
+        }
+        // The playhead back at the start of a layer that does not loop is the next clip,
+        // its track takes over before the first cues of the clip fall due
+        if (layer.hasUpcoming && !layer.loop && time < layer.previousTime && time < 1.0) {
+            takeUpcomingTrack(layer);
+        }
+        if (layer.dispatcher.isEmpty()) {
+            layer.previousTime = time;
+            continue;
+        }
+        // A loop that wraps around or a jump forward lands somewhere in the track. So does a
+        // rewind or scrub, or a clip played again; without chasing on a layer that does not
+        // loop, as the jump may also be a clip change whose new track is still on its way.
+        if (time < layer.previousTime) {
+            reposition(static_cast<CueLayer>(i), layer.dispatcher.frameAt(time), layer.loop);
+        } else if (layer.previousTime > 0.0 && time - layer.previousTime > JUMP) {
+            reposition(static_cast<CueLayer>(i), layer.dispatcher.frameAt(time));
+        }
+        layer.previousTime = time;
+        dispatchCues(static_cast<CueLayer>(i), time);
+    }
+}
+
+/**
+ * @brief CueEngine::reposition
+ * Move the cursor of a layer to a new playhead position after a seek, resume, loop or jump.
+ * Finding the position is a binary search, whatever the length of the track. In chase mode
+ * the cues in effect at the new position are played, so the lights show what they would
+ * have shown had the track been played up to there.
+ * @param layer - the cue layer
+ * @param frame - new playhead frame
+ * @param chase - false to only move the cursor, whatever the seek mode
+ */
+void CueEngine::reposition(CueLayer layer, int frame, bool chase)
+{
+    cueLayer& it = m_layers[static_cast<int>(layer)];
+    it.dispatcher.seek(frame);
+    it.scheduler->reset();
+    if (chase && m_seekMode == SeekMode::CHASE && m_triggersActive) {
+        QVector<cue> state = it.dispatcher.getTrack().stateAt(frame);
+        if (!state.isEmpty()) {
+            playCues(layer, state.constData(), state.size());
+            notifyNotices();
+        }
+    }
+}
+
+/**
+ * @brief CueEngine::dispatchCues
+ * Play every cue that became due since the previous time report of a layer and arm the
+ * timer for the cues that fall due before the next one.
+ * @param layer - the cue layer
+ * @param time - playhead position of the layer in seconds
+ */
+void CueEngine::dispatchCues(CueLayer layer, double time)
+{
+    cueLayer& it = m_layers[static_cast<int>(layer)];
+    it.scheduler->update(time);
+    playDueCues(layer, it.dispatcher.frameAt(time + it.scheduler->getLead()), it.dispatcher.frameAt(time));
+    if (m_triggersActive) {
+        it.scheduler->arm();
+    } else {
+        it.scheduler->stop();
+    }
+}
+
+/**
+ * @brief CueEngine::playDueCues
+ * Play every cue of a layer up to and including the given frame. With a lead that frame is
+ * ahead of the playhead; whether a cue is late is still judged against the playhead.
+ * @param layer - the cue layer
+ * @param frame - last frame to play
+ * @param playhead - playhead frame of the layer
+ */
+void CueEngine::playDueCues(CueLayer layer, int frame, int playhead)
+{
+    CueDispatcher& dispatcher = m_layers[static_cast<int>(layer)].dispatcher;
+    if (!m_triggersActive) {
+        dispatcher.skipTo(frame);
+        return;
+    }
+    const cue* batch;
+    int size;
+    bool late;
+    bool played = false;
+    while (dispatcher.takeBatch(frame, playhead, batch, size, late)) {
+        playCues(layer, batch, size);
+        played = true;
+    }
+    updateStatistics(layer);
+    if (played) {
+        notifyNotices();
+    }
+}
+
+/**
+ * @brief CueEngine::playCues
+ * Play all cues of one frame as a single batch. The note that is still sounding is
+ * replaced once by the batch, unless the batch holds that note itself, so chords survive.
+ * A DMX fade cue applies to the DMX cues after it in the batch.
+ * @param layer - the cue layer
+ * @param batch - first cue of the frame
+ * @param size - number of cues on the frame
+ */
+void CueEngine::playCues(CueLayer layer, const cue* batch, int size)
+{
+    bool killPrevious = true;
+    for (int i = 0; i < size; i++) {
+        if (batch[i].type == CueType::NOTE_ON && batch[i].pitch == m_previousPitch) {
+            killPrevious = false;
+        }
+    }
+    DmxOutput* dmx = m_dmxOutput.loadAcquire();
+    int dmxDelay = dmx ? OutputLatency::getInstance()->getDelay(CueOutput::DMX) : 0;
+    int dmxFade = 0;
+    DmxCurve dmxCurve = DmxCurve::LINEAR;
+    if (m_oscSender) {
+        // Timetagged for when the frame is shown, less the time the receivers take
+        qint64 shown = m_layers[static_cast<int>(layer)].scheduler->untilShown(batch[0].frame);
+        m_oscSender->begin(shown - OutputLatency::getInstance()->getLatency(CueOutput::OSC) * 1000000LL);
+    }
+    for (int i = 0; i < size; i++) {
+        if (batch[i].type == CueType::DMX_FADE) {
+            double fps = m_layers[static_cast<int>(layer)].dispatcher.getTrack().getFps();
+            dmxFade = fps > 0.0 ? qRound(dmxAddress(batch[i]) * 1000.0 / fps) : 0;
+            dmxCurve = static_cast<DmxCurve>(batch[i].velocity & 3);
+            continue;
+        }
+        if (batch[i].type == CueType::DMX) {
+            if (dmx) {
+                dmx->set(m_layers[static_cast<int>(layer)].dmxSource, dmxAddress(batch[i]), batch[i].velocity,
+                         dmxDelay, dmxFade, dmxCurve);
+            }
+            if (m_oscSender) {
+                m_oscSender->dmx(static_cast<int>(layer), dmxAddress(batch[i]), batch[i].velocity);
+            }
+            continue;
+        }
+        cueNotice notice;
+        notice.pitch = batch[i].pitch;
+        notice.noteOn = (batch[i].type == CueType::NOTE_ON);
+        notice.layer = layer;
+        sendNote(notice.pitch, notice.noteOn, killPrevious, batch[i].velocity, batch[i].channel);
+        startChain(notice.pitch, notice.noteOn);
+        if (m_oscSender) {
+            m_oscSender->note(static_cast<int>(layer), notice.pitch, notice.noteOn, batch[i].velocity, batch[i].channel);
+        }
+        if (notice.noteOn && notice.pitch < 128) {
+            killPrevious = false;
+        }
+        if (!m_notices.push(notice)) {
+            m_droppedNotices++;
+        }
+    }
+    flushMidi();
+    if (m_oscSender) {
+        m_oscSender->send();
+    }
+}
+
+/**
+ * @brief CueEngine::sendNote
+ * Add a note to the MIDI messages of the current frame, Raspberry PI actions are left to the GUI.
+ * The messages go out on flushMidi().
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param noteOn - note on or note off
+ * @param killPrevious - stop the previously played note before starting this one
+ * @param velocity - MIDI velocity
+ * @param channel - MIDI channel
+ */
+void CueEngine::sendNote(unsigned int pitch, bool noteOn, bool killPrevious, unsigned int velocity, unsigned int channel)
+{
+    channel = qBound(1u, channel, 16u);
+    if (pitch < 128) {
+        if (noteOn) {
+            unsigned int previous = m_previousPitch;
+            if (killPrevious && previous != pitch && previous < 128) {
+                // The replaced note does not get to play its follow-up
+                m_wheel.cancel(m_chain[previous]);
+                m_chain[previous] = -1;
+            }
+            if (killPrevious && previous < 128) {
+                queueMidi(static_cast<unsigned char>(MIDI_NOTE_OFF + m_previousChannel - 1), previous, 0);
+            }
+            queueMidi(static_cast<unsigned char>(MIDI_NOTE_ON + channel - 1), pitch, velocity);
+        } else {
+            queueMidi(static_cast<unsigned char>(MIDI_NOTE_OFF + channel - 1), pitch, 0);
+        }
+    }
+    m_previousPitch = pitch;
+    m_previousChannel = channel;
+}
+
+void CueEngine::queueMidi(unsigned char status, unsigned int pitch, unsigned int velocity)
+{
+    if (m_midiBatch.count == midiBatch::SIZE) {
+        flushMidi();
+    }
+    QMidiShortMessage& message = m_midiBatch.messages[m_midiBatch.count++];
+    message.status = status;
+    message.data1 = static_cast<unsigned char>(pitch);
+    message.data2 = static_cast<unsigned char>(velocity);
+}
+
+/**
+ * @brief CueEngine::flushMidi
+ * Hand the MIDI messages of the current frame to the output as one batch, after the
+ * delay of the MIDI output. An output with a queue (ALSA) gets the batch right away
+ * with its delivery time. Otherwise batches waiting for their delay are kept in a ring
+ * of preallocated slots with the time they are due, and one precise timer sends them;
+ * sending does not allocate.
+ */
+void CueEngine::flushMidi()
+{
+    if (m_midiBatch.count == 0) {
+        return;
+    }
+    int delay = OutputLatency::getInstance()->getDelay(CueOutput::MIDI);
+    if (delay <= 0) {
+        MidiConnection::getInstance()->sendBatch(m_midiBatch.messages, m_midiBatch.count);
+        m_midiBatch.count = 0;
+        return;
+    }
+    if (MidiConnection::getInstance()->scheduleBatch(m_midiBatch.messages, m_midiBatch.count, delay)) {
+        m_midiBatch.count = 0;
+        return;
+    }
+    int slot = m_delayedNext;
+    m_delayedNext = (m_delayedNext + 1) % DELAYED_BATCHES;
+    midiBatch& delayed = m_delayedBatches[slot];
+    if (delayed.count > 0) {
+        // The ring has come round before the delay expired, the old batch goes out early
+        MidiConnection::getInstance()->sendBatch(delayed.messages, delayed.count);
+    }
+    delayed = m_midiBatch;
+    delayed.due = m_wheelClock.elapsed() + delay;
+    m_midiBatch.count = 0;
+    if (!m_delayTimer->isActive() || m_delayTimer->remainingTime() > delay) {
+        m_delayTimer->start(delay);
+    }
+}
+
+/**
+ * @brief CueEngine::sendDelayedMidi
+ * Send the delayed MIDI batches that are due, oldest first, and wait for the next one
+ */
+void CueEngine::sendDelayedMidi()
+{
+    qint64 now = m_wheelClock.elapsed();
+    qint64 next = -1;
+    for (int i = 0; i < DELAYED_BATCHES; i++) {
+        midiBatch& it = m_delayedBatches[(m_delayedNext + i) % DELAYED_BATCHES];
+        if (it.count == 0) {
+            continue;
+        }
+        if (it.due <= now) {
+            MidiConnection::getInstance()->sendBatch(it.messages, it.count);
+            it.count = 0;
+        } else if (next < 0 || it.due < next) {
+            next = it.due;
+        }
+    }
+    if (next >= 0) {
+        m_delayTimer->start(static_cast<int>(next - now));
+    }
+}
+
+/**
+ * @brief CueEngine::startChain
+ * Time a note that has a duration. A MIDI note on is followed by its next note, or
+ * stopped when it has none. Any change of a Raspberry PI action is reverted.
+ * A note that is played again restarts its timer.
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param noteOn - note on or note off
+ */
+void CueEngine::startChain(unsigned int pitch, bool noteOn)
+{
+    if (pitch > 255) {
+        return;
+    }
+    m_wheel.cancel(m_chain[pitch]);
+    m_chain[pitch] = -1;
+    if (!m_automationActive || m_duration[pitch] == 0 || (pitch < 128 && !noteOn)) {
+        return;
+    }
+
+    quint64 now = static_cast<quint64>(m_wheelClock.elapsed()) / WHEEL_TICK;
+    if (m_wheel.isEmpty() && !m_wheelTimer->isActive()) {
+        // The wheel stands still while it is empty, pick up the time it missed
+        m_wheelOffset = now - m_wheel.getNow();
+    }
+    quint32 ticks = (m_duration[pitch] + WHEEL_TICK - 1) / WHEEL_TICK;
+    m_chain[pitch] = m_wheel.start(ticks, pitch | (noteOn ? 0x100 : 0));
+    if (!m_wheelTimer->isActive()) {
+        m_wheelTimer->start();
+    }
+}
+
+/**
+ * @brief CueEngine::advanceChains
+ * Bring the timer wheel up to date and play the notes of the chains that expired
+ */
+void CueEngine::advanceChains()
+{
+    quint64 target = static_cast<quint64>(m_wheelClock.elapsed()) / WHEEL_TICK - m_wheelOffset;
+    bool played = false;
+    if (target > m_wheel.getNow()) {
+        m_wheel.advance(target - m_wheel.getNow(), [this, &played](quint32 payload) {
+            chainExpired(payload & 0xFF, (payload & 0x100) != 0);
+            played = true;
+        });
+    }
+    if (m_wheel.isEmpty()) {
+        m_wheelTimer->stop();
+    }
+    if (played) {
+        flushMidi();
+        notifyNotices();
+    }
+}
+
+void CueEngine::chainExpired(unsigned int pitch, bool noteOn)
+{
+    m_chain[pitch] = -1;
+    cueNotice notice;
+    if (pitch < 128 && m_next[pitch] > 0) {
+        notice.pitch = m_next[pitch];
+        notice.noteOn = true;
+        sendNote(notice.pitch, true, true);
+    } else {
+        notice.pitch = pitch;
+        notice.noteOn = (pitch >= 128 && !noteOn);
+        sendNote(notice.pitch, notice.noteOn, false);
+    }
+    startChain(notice.pitch, notice.noteOn);
+    if (!m_notices.push(notice)) {
+        m_droppedNotices++;
+    }
+}
+
+void CueEngine::notifyNotices()
+{
+    if (m_noticesNotified.testAndSetOrdered(0, 1)) {
+        emit noticesPending();
+    }
+}
+
+void CueEngine::setTrack(CueLayer layer, const CueTrack& track)
+{
+    QMetaObject::invokeMethod(this, [this, layer, track]() {
+        switchTrack(m_layers[static_cast<int>(layer)], track);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::setUpcomingTrack
+ * Hand in the track of the clip that plays next on the video layer of a cue layer. The
+ * engine switches to it on the first time report of that clip, without waiting for the GUI.
+ * @param layer - the cue layer
+ * @param track - the cues of the next clip
+ */
+void CueEngine::setUpcomingTrack(CueLayer layer, const CueTrack& track)
+{
+    QMetaObject::invokeMethod(this, [this, layer, track]() {
+        cueLayer& it = m_layers[static_cast<int>(layer)];
+        it.upcoming = track;
+        it.hasUpcoming = true;
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::startUpcomingTrack
+ * The next clip has started, switch to its track unless that happened on its first time report
+ * @param layer - the cue layer
+ */
+void CueEngine::startUpcomingTrack(CueLayer layer)
+{
+    QMetaObject::invokeMethod(this, [this, layer]() {
+        cueLayer& it = m_layers[static_cast<int>(layer)];
+        if (it.hasUpcoming) {
+            takeUpcomingTrack(it);
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::dropUpcomingTrack
+ * Forget the track handed in for the next clip, another clip plays next
+ * @param layer - the cue layer
+ */
+void CueEngine::dropUpcomingTrack(CueLayer layer)
+{
+    QMetaObject::invokeMethod(this, [this, layer]() {
+        cueLayer& it = m_layers[static_cast<int>(layer)];
+        it.upcoming = CueTrack();
+        it.hasUpcoming = false;
+    }, Qt::QueuedConnection);
+}
+
+void CueEngine::switchTrack(cueLayer& layer, const CueTrack& track)
+{
+    layer.dispatcher.setTrack(track);
+    layer.scheduler->reset();
+    layer.previousTime = 0.0;
+}
+
+void CueEngine::takeUpcomingTrack(cueLayer& layer)
+{
+    switchTrack(layer, layer.upcoming);
+    layer.upcoming = CueTrack();
+    layer.hasUpcoming = false;
+}
+
+void CueEngine::seek(CueLayer layer, int frame)
+{
+    QMetaObject::invokeMethod(this, [this, layer, frame]() {
+        reposition(layer, frame);
+    }, Qt::QueuedConnection);
+}
+
+void CueEngine::skipTo(CueLayer layer, int frame)
+{
+    QMetaObject::invokeMethod(this, [this, layer, frame]() {
+        m_layers[static_cast<int>(layer)].dispatcher.skipTo(frame);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::follow
+ * Choose the video layer whose time reports drive a cue layer
+ * @param layer - the cue layer
+ * @param videoLayer - the video layer, 0 to stop playing the cue layer
+ */
+void CueEngine::follow(CueLayer layer, int videoLayer)
+{
+    QMetaObject::invokeMethod(this, [this, layer, videoLayer]() {
+        cueLayer& it = m_layers[static_cast<int>(layer)];
+        if (it.videoLayer != videoLayer) {
+            it.videoLayer = videoLayer;
+            it.scheduler->reset();
+            it.previousTime = 0.0;
+            DmxOutput* dmx = m_dmxOutput.loadAcquire();
+            if (dmx && videoLayer == 0 && it.loop) {
+                // A stopped soundscape lets go of its lights, the playlist holds them when paused
+                dmx->release(it.dmxSource, OutputLatency::getInstance()->getDelay(CueOutput::DMX));
+            }
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::setDmxSource
+ * Choose the DMX source the DMX cues of a layer are merged as, e.g. the scare overlay
+ * while it plays on the playlist layer. The overlay lets go of its channels when it ends.
+ * @param layer - the cue layer
+ * @param source - the DMX source
+ */
+void CueEngine::setDmxSource(CueLayer layer, DmxSource source)
+{
+    QMetaObject::invokeMethod(this, [this, layer, source]() {
+        cueLayer& it = m_layers[static_cast<int>(layer)];
+        if (it.dmxSource == source) {
+            return;
+        }
+        DmxOutput* dmx = m_dmxOutput.loadAcquire();
+        if (dmx && it.dmxSource == DmxSource::OVERLAY) {
+            dmx->release(it.dmxSource, OutputLatency::getInstance()->getDelay(CueOutput::DMX));
+        }
+        it.dmxSource = source;
+    }, Qt::QueuedConnection);
+}
+
+void CueEngine::setTriggersActive(bool active)
+{
+    QMetaObject::invokeMethod(this, [this, active]() {
+        m_triggersActive = active;
+        if (!active) {
+            m_layers[0].scheduler->stop();
+            m_layers[1].scheduler->stop();
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::playNote
+ * Send a note that did not come from a cue track, for example pushed by the user.
+ * A note with a DMX channel in Notes.csv sets that channel as the manual DMX source.
+ */
+void CueEngine::playNote(unsigned int pitch, bool noteOn, bool killPrevious, unsigned int velocity)
+{
+    QMetaObject::invokeMethod(this, [this, pitch, noteOn, killPrevious, velocity]() {
+        sendNote(pitch, noteOn, killPrevious, velocity);
+        startChain(pitch, noteOn);
+        flushMidi();
+        DmxOutput* dmx = m_dmxOutput.loadAcquire();
+        if (dmx && pitch < 256 && m_dmxChannel[pitch] >= 0) {
+            dmx->set(DmxSource::MANUAL, static_cast<unsigned int>(m_dmxChannel[pitch]), noteOn ? m_dmxLevel[pitch] : 0,
+                     OutputLatency::getInstance()->getDelay(CueOutput::DMX));
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::setAutomationActive
+ * Switch the timing of notes with a duration on or off, running chains are stopped
+ */
+void CueEngine::setAutomationActive(bool active)
+{
+    QMetaObject::invokeMethod(this, [this, active]() {
+        m_automationActive = active;
+        if (!active) {
+            m_wheel.clear();
+            m_wheelTimer->stop();
+            for (int i = 0; i < 256; i++) {
+                m_chain[i] = -1;
+            }
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::setMtcGenerator
+ * Pass the time reports on to a MIDI timecode generator as soon as they arrive
+ * @param generator - the generator, nullptr to stop
+ */
+void CueEngine::setMtcGenerator(MtcGenerator* generator)
+{
+    m_mtcGenerator.storeRelease(generator);
+}
+
+/**
+ * @brief CueEngine::setDmxOutput
+ * @param output - the network DMX output the DMX cues are sent to, nullptr to drop them
+ */
+void CueEngine::setDmxOutput(DmxOutput* output)
+{
+    m_dmxOutput.storeRelease(output);
+}
+
+/**
+ * @brief CueEngine::setOscTargets
+ * Send the cues of every frame as an OSC bundle to the targets, built and sent in the engine thread
+ * @param targets - the targets, none to stop sending
+ */
+void CueEngine::setOscTargets(const QList<oscTarget>& targets)
+{
+    QMetaObject::invokeMethod(this, [this, targets]() {
+        delete m_oscSender;
+        m_oscSender = targets.isEmpty() ? nullptr : new OscSender(targets);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::setExternalClock
+ * Let the playlist cues follow an external clock instead of the time reports of the server
+ * @param active - true to follow externalTime()
+ */
+void CueEngine::setExternalClock(bool active)
+{
+    QMetaObject::invokeMethod(this, [this, active]() {
+        if (m_externalClock != active) {
+            m_externalClock = active;
+            cueLayer& it = m_layers[static_cast<int>(CueLayer::PLAYLIST)];
+            it.scheduler->reset();
+            it.previousTime = 0.0;
+        }
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief CueEngine::externalTime
+ * Play the playlist cues up to a position of the external clock
+ * @param time - position of the external clock in seconds of the clip
+ * @param locate - the clock jumped to the position: the cues before it, and the ones on
+ * it, count as played and are not fired again
+ */
+void CueEngine::externalTime(double time, bool locate)
+{
+    QMetaObject::invokeMethod(this, [this, time, locate]() {
+        cueLayer& it = m_layers[static_cast<int>(CueLayer::PLAYLIST)];
+        if (!m_externalClock || it.videoLayer == 0 || it.dispatcher.isEmpty() || time < 0.0) {
+            return;
+        }
+        if (locate) {
+            int frame = it.dispatcher.frameAt(time);
+            it.dispatcher.seek(frame);
+            it.dispatcher.skipTo(frame);
+            it.scheduler->reset();
+        }
+        it.previousTime = time;
+        dispatchCues(CueLayer::PLAYLIST, time);
+    }, Qt::QueuedConnection);
+}
+
+void CueEngine::updateLatency()
+{
+    int lead = OutputLatency::getInstance()->getLead();
+    m_layers[0].scheduler->setLead(lead);
+    m_layers[1].scheduler->setLead(lead);
+}
+
+/**
+ * @brief CueEngine::takeDatagram
+ * @return the oldest datagram that was not taken yet, nullptr when all have been taken.
+ * It stays valid until it is handed back with releaseDatagram().
+ */
+const oscDatagram* CueEngine::takeDatagram()
+{
+    int slot;
+    if (m_datagrams.pop(slot)) {
+        return &m_datagramPool[slot];
+    }
+    // Rearm the notification, then look once more for a datagram that slipped in before
+    m_datagramsNotified.storeRelease(0);
+    if (m_datagrams.pop(slot)) {
+        return &m_datagramPool[slot];
+    }
+    return nullptr;
+}
+
+/**
+ * @brief CueEngine::releaseDatagram
+ * Hand a datagram that was taken back to the pool
+ * @param datagram - the datagram
+ */
+void CueEngine::releaseDatagram(const oscDatagram* datagram)
+{
+    m_freeDatagrams.push(static_cast<int>(datagram - m_datagramPool));
+}
+
+/**
+ * @brief CueEngine::takeNotice
+ * @param notice - receives the oldest played cue that was not taken yet
+ * @return false when all played cues have been taken
+ */
+bool CueEngine::takeNotice(cueNotice& notice)
+{
+    if (m_notices.pop(notice)) {
+        return true;
+    }
+    m_noticesNotified.storeRelease(0);
+    return m_notices.pop(notice);
+}
+
+/**
+ * @brief CueEngine::getDroppedDatagrams
+ * @return number of datagrams the GUI could not keep up with
+ */
+quint64 CueEngine::getDroppedDatagrams() const
+{
+    return m_droppedDatagrams.loadRelaxed();
+}
+
+/**
+ * @brief CueEngine::getDroppedNotices
+ * @return number of played cues the GUI could not keep up with, their Raspberry PI actions are lost
+ */
+quint64 CueEngine::getDroppedNotices() const
+{
+    return m_droppedNotices.loadRelaxed();
+}
+
+void CueEngine::updateStatistics(CueLayer layer)
+{
+    int i = static_cast<int>(layer);
+    QMutexLocker locker(&m_statisticsMutex);
+    m_cueStatistics[i] = m_layers[i].dispatcher.getStatistics();
+    scheduleStatistics timing = m_layers[i].scheduler->getStatistics();
+    if (timing.batches > m_scheduleStatistics[i].batches) {
+        // The last timing error reported is that of the layer whose timer fired last
+        m_lastScheduledLayer = i;
+    }
+    m_scheduleStatistics[i] = timing;
+}
+
+/**
+ * @brief CueEngine::getCueStatistics
+ * @return number of played, late and skipped cues over all layers
+ */
+dispatchStatistics CueEngine::getCueStatistics() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    dispatchStatistics total;
+    for (int i = 0; i < 2; i++) {
+        total.fired += m_cueStatistics[i].fired;
+        total.late += m_cueStatistics[i].late;
+        total.skipped += m_cueStatistics[i].skipped;
+    }
+    return total;
+}
+
+/**
+ * @brief CueEngine::getScheduleStatistics
+ * @return number of cue batches played on a timer over all layers and their timing error in
+ * microseconds, the last error is that of the layer that played a batch most recently
+ */
+scheduleStatistics CueEngine::getScheduleStatistics() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    scheduleStatistics total;
+    for (int i = 0; i < 2; i++) {
+        total.batches += m_scheduleStatistics[i].batches;
+        total.totalError += m_scheduleStatistics[i].totalError;
+        total.maxError = qMax(total.maxError, m_scheduleStatistics[i].maxError);
+    }
+    total.lastError = m_scheduleStatistics[m_lastScheduledLayer].lastError;
+    return total;
+}
@@ -0,0 +1,196 @@
+#ifndef CUEENGINE_H
+#define CUEENGINE_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+
+#include <osc/OscReceivedElements.h>
+#include <osc/OscPacketListener.h>
+
+#include "CueDispatcher.h"
+#include "CueScheduler.h"
+#include "DmxCompositor.h"
+#include "OscSender.h"
+#include "SpscQueue.h"
+#include "TimerWheel.h"
+#include "qmidiout.h"
+
+class DmxOutput;
+class MtcGenerator;
+
+enum class CueLayer
+{
+    PLAYLIST = 0,
+    SOUNDSCAPE = 1
+};
+
+// A cue played by the engine, reported to the GUI
+struct cueNotice {
+    unsigned int pitch = 0;
+    bool noteOn = false;
+    CueLayer layer = CueLayer::PLAYLIST;
+};
+
+// An OSC datagram passed on to the GUI, in a slot of a preallocated pool
+struct oscDatagram {
+    static const int SIZE = 16384;
+    char data[SIZE];
+    int size = 0;
+};
+
+/**
+ * @brief The CueEngine class
+ * Runs the path from OSC time report to MIDI note on a thread of its own, such that
+ * dialogs, table updates or database queries in the GUI never delay the lights.
+ * The engine receives the OSC datagrams, follows the cue tracks of the playlist and
+ * the soundscape and sends their MIDI notes. Everything the GUI has to know, the
+ * datagrams themselves and the cues that were played, goes through lock-free queues;
+ * a datagram is read into a fixed buffer and copied into a slot of a preallocated pool.
+ * The GUI steers the engine with queued calls. The track of the clip that follows is
+ * handed in ahead; the engine switches to it on the first time report of that clip.
+ * Notes with a duration in Notes.csv are timed by the engine as well: a MIDI note is
+ * followed by its next note or stopped, a Raspberry PI action is reverted (smoke bursts,
+ * latches that close again). Any number of these chains run at once on a timer wheel.
+ * DMX cues set channel levels on the network DMX output directly, as the DMX source of
+ * their layer; the output merges the sources.
+ * With OSC targets, the cues of every frame also go out as a timetagged OSC bundle.
+ */
+class CueEngine : public QObject, public osc::OscPacketListener
+{
+    Q_OBJECT
+
+public:
+    CueEngine();
+    static CueEngine* getInstance();
+    void start(quint16 oscPort);
+    void stop();
+
+    // Called by the GUI, carried out in the engine thread
+    void setTrack(CueLayer layer, const CueTrack& track);
+    void setUpcomingTrack(CueLayer layer, const CueTrack& track);
+    void startUpcomingTrack(CueLayer layer);
+    void dropUpcomingTrack(CueLayer layer);
+    void seek(CueLayer layer, int frame);
+    void skipTo(CueLayer layer, int frame);
+    void follow(CueLayer layer, int videoLayer);
+    void setDmxSource(CueLayer layer, DmxSource source);
+    void setTriggersActive(bool active);
+    void playNote(unsigned int pitch, bool noteOn, bool killPrevious, unsigned int velocity = 60);
+    void setAutomationActive(bool active);
+    void setMtcGenerator(MtcGenerator* generator);
+    void setDmxOutput(DmxOutput* output);
+    void setOscTargets(const QList<oscTarget>& targets);
+    void setExternalClock(bool active);
+    void externalTime(double time, bool locate);
+
+    // Consumer side of the queues, GUI thread only
+    const oscDatagram* takeDatagram();
+    void releaseDatagram(const oscDatagram* datagram);
+    bool takeNotice(cueNotice& notice);
+    quint64 getDroppedDatagrams() const;
+    quint64 getDroppedNotices() const;
+
+    dispatchStatistics getCueStatistics() const;
+    scheduleStatistics getScheduleStatistics() const;
+
+signals:
+    void datagramsPending();
+    void noticesPending();
+
+protected:
+    virtual void ProcessMessage(const osc::ReceivedMessage& m,
+                                const IpEndpointName& remoteEndpoint);
+
+private slots:
+    void open();
+    void readDatagrams();
+    void updateLatency();
+    void advanceChains();
+    void sendDelayedMidi();
+
+private:
+    struct cueLayer {
+        CueDispatcher dispatcher;
+        CueScheduler* scheduler = nullptr;
+        int videoLayer = 0;
+        DmxSource dmxSource = DmxSource::PLAYLIST;
+        bool loop = false;
+        double previousTime = 0.0;
+        CueTrack upcoming;
+        bool hasUpcoming = false;
+    };
+    // MIDI messages of one frame, handed to the output in one go
+    struct midiBatch {
+        static const int SIZE = 128;
+        QMidiShortMessage messages[SIZE];
+        int count = 0;
+        qint64 due = 0;
+    };
+    static const int DELAYED_BATCHES = 32;
+    static const unsigned int DATAGRAM_SLOTS = 128;
+    // Largest UDP payload
+    static const int PACKET_SIZE = 65536;
+    static CueEngine* s_inst;
+    QThread m_thread;
+    QUdpSocket* m_socket = nullptr;
+    quint16 m_port = 6250;
+    cueLayer m_layers[2];
+    bool m_triggersActive = true;
+    bool m_externalClock = false;
+    SeekMode m_seekMode = SeekMode::CHASE;
+    unsigned int m_previousPitch = 0;
+    unsigned int m_previousChannel = 1;
+    midiBatch m_midiBatch;
+    midiBatch m_delayedBatches[DELAYED_BATCHES];
+    int m_delayedNext = 0;
+    QTimer* m_delayTimer;
+    bool m_automationActive = true;
+    unsigned int m_duration[256];
+    unsigned int m_next[256];
+    int m_chain[256];
+    int m_dmxChannel[256];
+    unsigned int m_dmxLevel[256];
+    TimerWheel m_wheel;
+    QTimer* m_wheelTimer;
+    QElapsedTimer m_wheelClock;
+    quint64 m_wheelOffset = 0;
+    QAtomicPointer<MtcGenerator> m_mtcGenerator;
+    QAtomicPointer<DmxOutput> m_dmxOutput;
+    OscSender* m_oscSender = nullptr;
+    char m_packet[PACKET_SIZE];
+    oscDatagram m_datagramPool[DATAGRAM_SLOTS];
+    // Filled datagrams towards the GUI, and emptied ones back to the engine
+    SpscQueue<int, DATAGRAM_SLOTS> m_datagrams;
+    SpscQueue<int, DATAGRAM_SLOTS> m_freeDatagrams;
+    SpscQueue<cueNotice, 1024> m_notices;
+    QAtomicInt m_datagramsNotified;
+    QAtomicInt m_noticesNotified;
+    QAtomicInteger<quint64> m_droppedDatagrams;
+    QAtomicInteger<quint64> m_droppedNotices;
+    mutable QMutex m_statisticsMutex;
+    dispatchStatistics m_cueStatistics[2];
+    scheduleStatistics m_scheduleStatistics[2];
+    int m_lastScheduledLayer = 0;
+    void timecode(int videoLayer, double time);
+    void reposition(CueLayer layer, int frame, bool chase = true);
+    void switchTrack(cueLayer& layer, const CueTrack& track);
+    void takeUpcomingTrack(cueLayer& layer);
+    void dispatchCues(CueLayer layer, double time);
+    void playDueCues(CueLayer layer, int frame, int playhead);
+    void playCues(CueLayer layer, const cue* batch, int size);
+    void sendNote(unsigned int pitch, bool noteOn, bool killPrevious, unsigned int velocity = 60, unsigned int channel = 1);
+    void queueMidi(unsigned char status, unsigned int pitch, unsigned int velocity);
+    void flushMidi();
+    void startChain(unsigned int pitch, bool noteOn);
+    void chainExpired(unsigned int pitch, bool noteOn);
+    void notifyNotices();
+    void updateStatistics(CueLayer layer);
+    void setRealtime();
+};
+
+#endif // CUEENGINE_H
@@ -0,0 +1,571 @@
+#include "CueFile.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <cstddef>
+#include <cstring>
+
+#include "SmfFile.h"
+#include "Timecode.h"
+
+namespace {
+
+const char CUE_MAGIC[4] = {'C', 'C', 'U', 'E'};
+const char DELTA_MAGIC[4] = {'C', 'D', 'L', 'T'};
+
+/**
+ * @brief parseNumber
+ * Read an unsigned decimal number and step over the separator that follows it
+ * @param pos - current position, advanced past the number and separator
+ * @param end - end of the buffer
+ * @return the number, -1 when there are no digits
+ */
+int parseNumber(const char*& pos, const char* end)
+{
+    int value = -1;
+    while (pos < end && *pos >= '0' && *pos <= '9') {
+        value = (value < 0 ? 0 : value * 10) + (*pos - '0');
+        pos++;
+    }
+    if (pos < end && (*pos == ':' || *pos == ',')) {
+        pos++;
+    }
+    return value;
+}
+
+}
+
+QString CueFile::sidecarName(QString clipName)
+{
+    return QString("%1.midi").arg(clipName.replace("/","-"));
+}
+
+QString CueFile::smfName(QString clipName)
+{
+    return QString("%1.mid").arg(clipName.replace("/","-"));
+}
+
+QString CueFile::compiledName(QString clipName)
+{
+    return QString("%1.cues").arg(clipName.replace("/","-"));
+}
+
+QString CueFile::deltaName(QString clipName)
+{
+    return QString("%1.delta").arg(clipName.replace("/","-"));
+}
+
+/**
+ * @brief CueFile::sourceName
+ * @param clipName - name of the clip
+ * @return the sidecar the cues of the clip come from: the most recently changed of the
+ * CSV and the MIDI file, the CSV name when the clip has neither
+ */
+QString CueFile::sourceName(QString clipName)
+{
+    QFileInfo csv(sidecarName(clipName));
+    QFileInfo smf(smfName(clipName));
+    if (smf.exists() && (!csv.exists() || smf.lastModified() > csv.lastModified())) {
+        return smf.filePath();
+    }
+    return csv.filePath();
+}
+
+/**
+ * @brief CueFile::open
+ * Load the cues of a clip. The compiled file is loaded when it is up to date with
+ * the sidecar, otherwise the sidecar is parsed and compiled again. Saved edits of the
+ * sidecar are applied on top.
+ * @param clipName - name of the clip
+ * @param fps - frame rate of the clip
+ * @return the cue track, empty when the clip has no sidecar
+ */
+CueTrack CueFile::open(QString clipName, double fps)
+{
+    QString source = sourceName(clipName);
+    if (!QFileInfo::exists(source)) {
+        return CueTrack(fps);
+    }
+
+    QString compiled = compiledName(clipName);
+    CueTrack track;
+    bool touched = false;
+    if (!load(compiled, source, fps, track, touched)) {
+        track = readSource(source, fps);
+        if (!write(compiled, track, source)) {
+            qWarning() << "Could not compile" << source;
+        }
+    } else if (touched && !track.isMapped()) {
+        // Only the modification time of the sidecar moved, take it in to skip hashing next time
+        write(compiled, track, source);
+    }
+
+    QByteArray delta;
+    if (readDelta(deltaName(clipName), source, fps, delta)) {
+        track = applyDelta(delta, track);
+    }
+    return track;
+}
+
+/**
+ * @brief CueFile::readCsv
+ * Parse a "timecode,ON|OFF,pitch[,velocity[,channel]]" sidecar straight from its bytes
+ * @param fileName - the CSV sidecar
+ * @param fps - frame rate of the clip
+ * @return the cue track
+ */
+CueTrack CueFile::readCsv(const QString& fileName, double fps)
+{
+    CueTrack track(fps);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return track;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+
+    int nominal = qRound(fps);
+    const char* pos = content.constData();
+    const char* end = pos + content.size();
+    while (pos < end) {
+        const char* endOfLine = static_cast<const char*>(memchr(pos, '\n', static_cast<size_t>(end - pos)));
+        if (!endOfLine) {
+            endOfLine = end;
+        }
+
+        int hours = parseNumber(pos, endOfLine);
+        int minutes = parseNumber(pos, endOfLine);
+        int seconds = parseNumber(pos, endOfLine);
+        int frames = parseNumber(pos, endOfLine);
+        const char* type = pos;
+        while (pos < endOfLine && *pos != ',') {
+            pos++;
+        }
+        bool noteOn = (pos - type == 2 && type[0] == 'O' && type[1] == 'N');
+        bool dmx = (pos - type == 3 && type[0] == 'D' && type[1] == 'M' && type[2] == 'X');
+        bool fade = (pos - type == 4 && memcmp(type, "FADE", 4) == 0);
+        if (pos < endOfLine) {
+            pos++;
+        }
+        int pitch = parseNumber(pos, endOfLine);
+        int velocity = parseNumber(pos, endOfLine);
+        int channel = parseNumber(pos, endOfLine);
+
+        if (dmx) {
+            // "timecode,DMX,channel,level", the channel counted from 0 over all universes
+            if (hours >= 0 && minutes >= 0 && seconds >= 0 && frames >= 0 && pitch >= 0 && velocity >= 0) {
+                track.appendDmx(((hours * 3600) + (minutes * 60) + seconds) * nominal + frames,
+                                static_cast<unsigned int>(pitch), static_cast<unsigned int>(velocity));
+            }
+        } else if (fade) {
+            // "timecode,FADE,frames[,curve]" before the DMX lines of the frame that fade
+            if (hours >= 0 && minutes >= 0 && seconds >= 0 && frames >= 0 && pitch >= 0) {
+                track.appendDmxFade(((hours * 3600) + (minutes * 60) + seconds) * nominal + frames,
+                                    static_cast<unsigned int>(pitch), velocity >= 0 ? static_cast<unsigned int>(velocity) : 0);
+            }
+        } else if (hours >= 0 && minutes >= 0 && seconds >= 0 && frames >= 0 && pitch >= 0) {
+            track.append(((hours * 3600) + (minutes * 60) + seconds) * nominal + frames,
+                         noteOn ? CueType::NOTE_ON : CueType::NOTE_OFF,
+                         static_cast<unsigned int>(pitch),
+                         velocity >= 0 ? static_cast<unsigned int>(velocity) : 60,
+                         channel > 0 ? static_cast<unsigned int>(channel) : 1);
+        }
+        pos = endOfLine + 1;
+    }
+    track.sort();
+    return track;
+}
+
+/**
+ * @brief CueFile::readSource
+ * Parse a sidecar, CSV or MIDI file depending on its extension
+ * @param fileName - the sidecar
+ * @param fps - frame rate of the clip
+ * @return the cue track
+ */
+CueTrack CueFile::readSource(const QString& fileName, double fps)
+{
+    if (fileName.endsWith(".mid", Qt::CaseInsensitive)) {
+        return SmfFile::read(fileName, fps);
+    }
+    return readCsv(fileName, fps);
+}
+
+/**
+ * @brief CueFile::writeCsv
+ * Write a track as a "timecode,ON|OFF,pitch,velocity,channel" sidecar, DMX cues as
+ * "timecode,DMX,channel,level" and their fades as "timecode,FADE,frames,curve"; the file
+ * is replaced atomically
+ * @param fileName - the CSV sidecar
+ * @param track - the cues to be written
+ * @return true on success
+ */
+bool CueFile::writeCsv(const QString& fileName, const CueTrack& track)
+{
+    QByteArray content;
+    content.reserve(track.count() * 28);
+    char timecode[Timecode::BUFFER_SIZE];
+    for (int i = 0; i < track.count(); i++) {
+        const cue& it = track.at(i);
+        content.append(timecode, Timecode::formatFrames(timecode, it.frame, track.getFps()));
+        if (it.type == CueType::DMX) {
+            content.append(",DMX,");
+            content.append(QByteArray::number(dmxAddress(it)));
+            content.append(',');
+            content.append(QByteArray::number(it.velocity));
+            content.append('\n');
+            continue;
+        }
+        if (it.type == CueType::DMX_FADE) {
+            content.append(",FADE,");
+            content.append(QByteArray::number(dmxAddress(it)));
+            content.append(',');
+            content.append(QByteArray::number(it.velocity));
+            content.append('\n');
+            continue;
+        }
+        content.append(it.type == CueType::NOTE_ON ? ",ON," : ",OFF,");
+        content.append(QByteArray::number(it.pitch));
+        content.append(',');
+        content.append(QByteArray::number(it.velocity));
+        content.append(',');
+        content.append(QByteArray::number(it.channel));
+        content.append('\n');
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(content);
+    return file.commit();
+}
+
+/**
+ * @brief CueFile::writeSidecar
+ * Replace the CSV sidecar of a clip by a track, saved edits are part of the track and
+ * the delta is removed. A delta left behind by a crash no longer matches the sidecar.
+ * @param clipName - name of the clip
+ * @param track - the cues to be written
+ * @return true on success
+ */
+bool CueFile::writeSidecar(QString clipName, const CueTrack& track)
+{
+    if (!writeCsv(sidecarName(clipName), track)) {
+        return false;
+    }
+    QFile::remove(deltaName(clipName));
+    return true;
+}
+
+/**
+ * @brief CueFile::save
+ * Save the edited cues of a clip. The edit is reduced to the one run of cues that
+ * differs from the saved track, and added to the delta of the sidecar; the delta is
+ * small and replaced atomically. The sidecar is rewritten, and the delta dropped, once
+ * the delta holds MAX_DELTAS edits or half as many cues as the track.
+ * @param clipName - name of the clip
+ * @param saved - the cues of the clip as they are on disk, as returned by open()
+ * @param track - the edited cues
+ * @return true on success
+ */
+bool CueFile::save(QString clipName, const CueTrack& saved, const CueTrack& track)
+{
+    QString source = sourceName(clipName);
+    if (!QFileInfo::exists(source) || saved.getFps() != track.getFps()) {
+        return writeSidecar(clipName, track);
+    }
+
+    int common = qMin(saved.count(), track.count());
+    int prefix = 0;
+    while (prefix < common && memcmp(&saved.at(prefix), &track.at(prefix), sizeof(cue)) == 0) {
+        prefix++;
+    }
+    int suffix = 0;
+    while (suffix < common - prefix &&
+           memcmp(&saved.at(saved.count() - 1 - suffix), &track.at(track.count() - 1 - suffix), sizeof(cue)) == 0) {
+        suffix++;
+    }
+    cueDelta delta;
+    delta.position = static_cast<quint32>(prefix);
+    delta.removed = static_cast<quint32>(saved.count() - prefix - suffix);
+    delta.inserted = static_cast<quint32>(track.count() - prefix - suffix);
+    delta.reserved = 0;
+    if (delta.removed == 0 && delta.inserted == 0) {
+        return true;
+    }
+
+    QString fileName = deltaName(clipName);
+    QByteArray content;
+    if (!readDelta(fileName, source, track.getFps(), content)) {
+        QFileInfo info(source);
+        cueDeltaHeader header;
+        memcpy(header.magic, DELTA_MAGIC, sizeof(header.magic));
+        header.fpsMillis = static_cast<quint32>(qRound(track.getFps() * 1000));
+        header.count = 0;
+        header.reserved = 0;
+        header.sourceModified = info.lastModified().toMSecsSinceEpoch();
+        header.sourceSize = info.size();
+        header.sourceHash = hashFile(source);
+        content = QByteArray(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    cueDeltaHeader* header = reinterpret_cast<cueDeltaHeader*>(content.data());
+    qint64 size = content.size() + static_cast<qint64>(sizeof(delta) + delta.inserted * sizeof(cue));
+    if (header->count >= MAX_DELTAS ||
+            size - static_cast<qint64>(sizeof(cueDeltaHeader)) > static_cast<qint64>(track.count() * sizeof(cue) / 2)) {
+        return writeSidecar(clipName, track);
+    }
+    header->count++;
+    content.append(reinterpret_cast<const char*>(&delta), sizeof(delta));
+    content.append(reinterpret_cast<const char*>(track.data() + prefix), static_cast<int>(delta.inserted * sizeof(cue)));
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(content);
+    return file.commit();
+}
+
+/**
+ * @brief CueFile::readDelta
+ * Read the delta of a sidecar. The delta is rejected when it does not match the frame
+ * rate or when it was saved on top of another version of the sidecar.
+ * @param fileName - the delta file
+ * @param sourceName - the sidecar
+ * @param fps - frame rate of the clip
+ * @param content - receives the delta file
+ * @return true when the delta can be applied
+ */
+bool CueFile::readDelta(const QString& fileName, const QString& sourceName, double fps, QByteArray& content)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    content = file.readAll();
+    file.close();
+
+    if (content.size() < static_cast<int>(sizeof(cueDeltaHeader))) {
+        return false;
+    }
+    const cueDeltaHeader* header = reinterpret_cast<const cueDeltaHeader*>(content.constData());
+    QFileInfo source(sourceName);
+    if (memcmp(header->magic, DELTA_MAGIC, sizeof(header->magic)) != 0 ||
+            header->fpsMillis != static_cast<quint32>(qRound(fps * 1000)) ||
+            header->sourceSize != source.size()) {
+        return false;
+    }
+    if (header->sourceModified != source.lastModified().toMSecsSinceEpoch() &&
+            header->sourceHash != hashFile(sourceName)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief CueFile::applyDelta
+ * Apply the edits of a delta file in the order they were saved
+ * @param content - the delta file, as checked by readDelta()
+ * @param track - the cues of the sidecar
+ * @return the edited track
+ */
+CueTrack CueFile::applyDelta(const QByteArray& content, CueTrack track)
+{
+    const cueDeltaHeader* header = reinterpret_cast<const cueDeltaHeader*>(content.constData());
+    const char* pos = content.constData() + sizeof(cueDeltaHeader);
+    const char* end = content.constData() + content.size();
+    for (quint32 i = 0; i < header->count; i++) {
+        cueDelta delta;
+        if (end - pos < static_cast<qint64>(sizeof(delta))) {
+            qWarning() << "Delta is cut short after" << i << "edits";
+            break;
+        }
+        memcpy(&delta, pos, sizeof(delta));
+        pos += sizeof(delta);
+        qint64 bytes = static_cast<qint64>(delta.inserted) * static_cast<qint64>(sizeof(cue));
+        if (end - pos < bytes || static_cast<qint64>(delta.position) + delta.removed > track.count()) {
+            qWarning() << "Delta does not fit the track after" << i << "edits";
+            break;
+        }
+        QVector<cue> inserted(static_cast<int>(delta.inserted));
+        memcpy(inserted.data(), pos, static_cast<size_t>(bytes));
+        pos += bytes;
+        track.replace(static_cast<int>(delta.position), static_cast<int>(delta.removed), inserted.constData(), inserted.size());
+    }
+    return track;
+}
+
+/**
+ * @brief CueFile::write
+ * Write a compiled cue file; the file is replaced atomically
+ * @param fileName - the compiled file
+ * @param track - the cues to be written
+ * @param sourceName - the sidecar the cues were read from
+ * @return true on success
+ */
+bool CueFile::write(const QString& fileName, const CueTrack& track, const QString& sourceName)
+{
+    QFileInfo source(sourceName);
+    cueFileHeader header;
+    memcpy(header.magic, CUE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.fpsMillis = static_cast<quint32>(qRound(track.getFps() * 1000));
+    header.count = static_cast<quint32>(track.count());
+    header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+    header.sourceSize = source.size();
+    header.sourceHash = hashFile(sourceName);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(track.data()), static_cast<qint64>(track.count()) * static_cast<qint64>(sizeof(cue)));
+    return file.commit();
+}
+
+/**
+ * @brief CueFile::load
+ * Load a compiled cue file. The file is rejected when it does not match the frame rate or
+ * when the sidecar has changed since it was compiled. A sidecar that was only touched is
+ * recognised by its hash and does not force a recompile. A track of up to MAX_COPIED cues
+ * is read and the file closed, a larger track stays mapped read-only.
+ * @param fileName - the compiled file
+ * @param sourceName - the sidecar
+ * @param fps - frame rate of the clip
+ * @param track - receives the cues
+ * @param touched - set when the sidecar has another modification time than was compiled
+ * @return false when the file cannot be used
+ */
+bool CueFile::load(const QString& fileName, const QString& sourceName, double fps, CueTrack& track, bool& touched)
+{
+    touched = false;
+    QSharedPointer<QFile> file(new QFile(fileName));
+    cueFileHeader header;
+    if (!file->open(QIODevice::ReadOnly) ||
+            file->read(reinterpret_cast<char*>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header))) {
+        return false;
+    }
+    if (memcmp(header.magic, CUE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != VERSION ||
+            header.fpsMillis != static_cast<quint32>(qRound(fps * 1000)) ||
+            file->size() != static_cast<qint64>(sizeof(header) + header.count * sizeof(cue))) {
+        return false;
+    }
+
+    QFileInfo source(sourceName);
+    if (header.sourceSize != source.size()) {
+        return false;
+    }
+    if (header.sourceModified != source.lastModified().toMSecsSinceEpoch()) {
+        if (header.sourceHash != hashFile(sourceName)) {
+            return false;
+        }
+        touched = true;
+    }
+
+    int count = static_cast<int>(header.count);
+    if (count <= MAX_COPIED) {
+        QVector<cue> cues(count);
+        qint64 bytes = static_cast<qint64>(count) * static_cast<qint64>(sizeof(cue));
+        if (file->read(reinterpret_cast<char*>(cues.data()), bytes) != bytes) {
+            return false;
+        }
+        track = CueTrack(cues, fps);
+        return true;
+    }
+    uchar* memory = file->map(0, file->size());
+    if (!memory) {
+        return false;
+    }
+    track = CueTrack(file, reinterpret_cast<const cue*>(memory + sizeof(header)), count, fps);
+    return true;
+}
+
+/**
+ * @brief CueFile::hashFile
+ * @param fileName - file to be hashed
+ * @return 64 bit FNV-1a hash of the file content
+ */
+quint64 CueFile::hashFile(const QString& fileName)
+{
+    quint64 hash = 14695981039346656037ULL;
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly)) {
+        QByteArray content = file.readAll();
+        for (char byte : content) {
+            hash ^= static_cast<unsigned char>(byte);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief CueFile::compileLibrary
+ * Compile the sidecars of all clips in the library and report how long parsing the
+ * sidecars, compiling and loading the compiled files takes
+ * @return number of compiled sidecars
+ */
+int CueFile::compileLibrary()
+{
+    QSqlQuery query;
+    if (!query.exec("SELECT Name, Fps FROM Library ORDER BY Name")) {
+        qCritical("Failed to execute sql query: %s, Error: %s", qPrintable(query.lastQuery()), qPrintable(query.lastError().text()));
+        return -1;
+    }
+
+    int files = 0;
+    qint64 cues = 0;
+    qint64 parseTime = 0;
+    qint64 writeTime = 0;
+    qint64 loadTime = 0;
+    QElapsedTimer timer;
+    while (query.next()) {
+        QString clipName = query.value(0).toString();
+        double fps = query.value(1).toDouble();
+        if (fps < 1.0) {
+            fps = 29.97;
+        }
+        QString source = sourceName(clipName);
+        if (!QFileInfo::exists(source)) {
+            continue;
+        }
+        QString compiled = compiledName(clipName);
+
+        timer.start();
+        CueTrack track = readSource(source, fps);
+        parseTime += timer.nsecsElapsed();
+
+        timer.start();
+        bool written = write(compiled, track, source);
+        writeTime += timer.nsecsElapsed();
+
+        timer.start();
+        CueTrack loaded;
+        bool touched = false;
+        bool valid = load(compiled, source, fps, loaded, touched);
+        loadTime += timer.nsecsElapsed();
+
+        if (!written || !valid || loaded.count() != track.count()) {
+            qWarning() << "Failed to compile" << source;
+            continue;
+        }
+        qInfo("%s: %d cues", qPrintable(source), track.count());
+        files++;
+        cues += track.count();
+    }
+
+    qInfo("Compiled %d sidecars with %lld cues", files, cues);
+    qInfo("Parse sidecars: %.3f ms, write compiled: %.3f ms, load compiled: %.3f ms",
+          parseTime / 1e6, writeTime / 1e6, loadTime / 1e6);
+    return files;
+}
@@ -0,0 +1,83 @@
+#ifndef CUEFILE_H
+#define CUEFILE_H
+
+#include <QString>
+
+#include "CueTrack.h"
+
+// Fixed header of a compiled cue file, followed by an array of packed cue records
+struct cueFileHeader {
+    char magic[4];
+    quint32 version;
+    quint32 fpsMillis;
+    quint32 count;
+    qint64 sourceModified;
+    qint64 sourceSize;
+    quint64 sourceHash;
+};
+
+static_assert(sizeof(cueFileHeader) == 40, "cueFileHeader must stay a packed 40 byte header");
+
+// Fixed header of a delta file, followed by the edits in the order they were saved
+struct cueDeltaHeader {
+    char magic[4];
+    quint32 fpsMillis;
+    quint32 count;
+    quint32 reserved;
+    qint64 sourceModified;
+    qint64 sourceSize;
+    quint64 sourceHash;
+};
+
+// One edit: the run of removed cues at position is replaced by the inserted cues that follow
+struct cueDelta {
+    quint32 position;
+    quint32 removed;
+    quint32 inserted;
+    quint32 reserved;
+};
+
+static_assert(sizeof(cueDeltaHeader) == 40, "cueDeltaHeader must stay a packed 40 byte header");
+static_assert(sizeof(cueDelta) == 16, "cueDelta must stay a packed 16 byte record");
+
+/**
+ * @brief The CueFile class
+ * Compiles the sidecar of a clip into a binary "<clip>.cues" file that is loaded as is,
+ * without parsing. A track of up to MAX_COPIED cues is read into memory and the file is
+ * closed again, so the compiled file can be replaced while the track is in use (Windows
+ * cannot rename over a file that is open or mapped); a larger track is memory mapped
+ * read-only. The sidecar is either the CSV "<clip>.midi" or the Standard MIDI File
+ * "<clip>.mid", whichever was changed last. The compiled file is rebuilt whenever the
+ * sidecar has changed.
+ * Edits are saved as a delta "<clip>.delta" on top of the sidecar, the sidecar itself is
+ * only rewritten when the delta has grown too large.
+ */
+class CueFile
+{
+public:
+    static const quint32 VERSION = 1;
+    static const quint32 MAX_DELTAS = 64;
+    static const int MAX_COPIED = 1 << 16;
+    static QString sidecarName(QString clipName);
+    static QString smfName(QString clipName);
+    static QString compiledName(QString clipName);
+    static QString deltaName(QString clipName);
+    static QString sourceName(QString clipName);
+    static CueTrack open(QString clipName, double fps);
+    static CueTrack readCsv(const QString& fileName, double fps);
+    static CueTrack readSource(const QString& fileName, double fps);
+    static bool writeCsv(const QString& fileName, const CueTrack& track);
+    static bool writeSidecar(QString clipName, const CueTrack& track);
+    static bool save(QString clipName, const CueTrack& saved, const CueTrack& track);
+    static bool write(const QString& fileName, const CueTrack& track, const QString& sourceName);
+    static bool load(const QString& fileName, const QString& sourceName, double fps, CueTrack& track, bool& touched);
+    static int compileLibrary();
+
+private:
+    CueFile() {}
+    static quint64 hashFile(const QString& fileName);
+    static bool readDelta(const QString& fileName, const QString& sourceName, double fps, QByteArray& content);
+    static CueTrack applyDelta(const QByteArray& content, CueTrack track);
+};
+
+#endif // CUEFILE_H
@@ -0,0 +1,241 @@
+#include "CueRecorder.h"
+
+#include <QDebug>
+
+#include <cstring>
+
+#include "CueFile.h"
+
+namespace {
+
+const char JOURNAL_MAGIC[4] = {'C', 'J', 'R', 'N'};
+
+// Header of a journal, followed by the recorded notes as packed cue records
+struct journalHeader {
+    char magic[4];
+    quint32 fpsMillis;
+};
+
+}
+
+CueRecorder::CueRecorder()
+{
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setInterval(FLUSH_INTERVAL);
+    connect(m_flushTimer, SIGNAL(timeout()),
+            this, SLOT(flush()));
+    moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+}
+
+CueRecorder::~CueRecorder()
+{
+    finish();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+QString CueRecorder::journalName(QString clipName)
+{
+    return QString("%1.journal").arg(clipName.replace("/","-"));
+}
+
+/**
+ * @brief CueRecorder::start
+ * Start a take. A journal left behind by a take that did not finish is continued.
+ * @param clipName - name of the clip
+ * @param track - the cues of the clip, the recorded notes are added to these
+ */
+void CueRecorder::start(const QString& clipName, const CueTrack& track)
+{
+    m_clipName = clipName;
+    m_track = track;
+    m_clock.reset();
+    m_time = 0.0;
+    m_dropped = 0;
+
+    QString fileName = journalName(clipName);
+    double fps = track.getFps();
+    bool opened = false;
+    QMetaObject::invokeMethod(this, [this, fileName, fps, &opened]() {
+        opened = openJournal(fileName, fps);
+        m_flushTimer->start();
+    }, Qt::BlockingQueuedConnection);
+    if (!opened) {
+        qWarning() << "Cannot open journal" << fileName << "the take is not protected against a crash";
+    }
+    m_recording = true;
+    qDebug() << "Recording" << clipName;
+}
+
+/**
+ * @brief CueRecorder::timecode
+ * Follow the playhead of the clip being recorded
+ * @param time - playhead position in seconds
+ */
+void CueRecorder::timecode(double time)
+{
+    m_time = time;
+    m_clock.update(time);
+}
+
+/**
+ * @brief CueRecorder::record
+ * Record a note at the current playhead position
+ * @param type - note on or note off
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param velocity - MIDI velocity
+ * @param channel - MIDI channel
+ */
+void CueRecorder::record(CueType type, unsigned int pitch, unsigned int velocity, unsigned int channel)
+{
+    if (!m_recording) {
+        return;
+    }
+    double time = m_clock.isRunning() ? m_clock.timeAt(m_clock.now()) : m_time;
+    cue note;
+    note.frame = m_track.frameAt(time);
+    note.type = type;
+    note.pitch = static_cast<quint8>(pitch);
+    note.velocity = static_cast<quint8>(velocity);
+    note.channel = static_cast<quint8>(channel);
+    if (!m_buffer.push(note)) {
+        m_dropped++;
+    }
+}
+
+/**
+ * @brief CueRecorder::finish
+ * End the take and write it to the CSV sidecar of the clip when any note was recorded.
+ * The journal is removed once the sidecar is written.
+ * @return the cue track of the take, empty when nothing was being recorded
+ */
+CueTrack CueRecorder::finish()
+{
+    if (!m_recording) {
+        return CueTrack();
+    }
+    m_recording = false;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_flushTimer->stop();
+        flush();
+        closeJournal();
+    }, Qt::BlockingQueuedConnection);
+
+    QString fileName = journalName(m_clipName);
+    CueTrack take = m_track;
+    QVector<cue> notes;
+    if (readJournal(fileName, take.getFps(), notes)) {
+        for (const cue& it : notes) {
+            take.append(it.frame, it.type, it.pitch, it.velocity, it.channel);
+        }
+    }
+    // Without a journal the notes are still in the buffer
+    cue note;
+    while (m_buffer.pop(note)) {
+        notes.append(note);
+        take.append(note.frame, note.type, note.pitch, note.velocity, note.channel);
+    }
+    take.sort();
+    if (m_dropped > 0) {
+        qWarning("Recording buffer overflowed, %llu notes were lost", m_dropped);
+    }
+
+    if (notes.isEmpty()) {
+        // Nothing was played, the sidecar stays as it is
+        QFile::remove(fileName);
+    } else if (CueFile::writeSidecar(m_clipName, take)) {
+        QFile::remove(fileName);
+        qDebug() << "Recorded" << notes.size() << "notes for" << m_clipName;
+    } else {
+        qWarning() << "Cannot write" << CueFile::sidecarName(m_clipName) << "the take is kept in" << fileName;
+    }
+    return take;
+}
+
+/**
+ * @brief CueRecorder::flush
+ * Append the buffered notes to the journal (recorder thread)
+ */
+void CueRecorder::flush()
+{
+    if (!m_journal.isOpen()) {
+        return;
+    }
+    cue chunk[256];
+    int count = 0;
+    cue note;
+    while (m_buffer.pop(note)) {
+        chunk[count++] = note;
+        if (count == 256) {
+            m_journal.write(reinterpret_cast<const char*>(chunk), static_cast<qint64>(sizeof(chunk)));
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        m_journal.write(reinterpret_cast<const char*>(chunk), static_cast<qint64>(count * sizeof(cue)));
+    }
+    m_journal.flush();
+}
+
+/**
+ * @brief CueRecorder::openJournal
+ * Open the journal of a take for appending, a journal of the same clip at the same
+ * frame rate is continued, anything else is replaced (recorder thread)
+ */
+bool CueRecorder::openJournal(const QString& fileName, double fps)
+{
+    closeJournal();
+    QVector<cue> lost;
+    bool resume = readJournal(fileName, fps, lost);
+    if (resume && !lost.isEmpty()) {
+        qWarning() << "Continuing an unfinished take with" << lost.size() << "notes from" << fileName;
+    }
+
+    m_journal.setFileName(fileName);
+    if (!m_journal.open(resume ? QIODevice::WriteOnly | QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    if (resume) {
+        // Drop a record that was cut in half by the crash
+        m_journal.resize(static_cast<qint64>(sizeof(journalHeader) + lost.size() * sizeof(cue)));
+    } else {
+        journalHeader header;
+        memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+        header.fpsMillis = static_cast<quint32>(qRound(fps * 1000));
+        m_journal.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        m_journal.flush();
+    }
+    return true;
+}
+
+void CueRecorder::closeJournal()
+{
+    if (m_journal.isOpen()) {
+        m_journal.close();
+    }
+}
+
+/**
+ * @brief CueRecorder::readJournal
+ * @param fileName - the journal
+ * @param fps - frame rate of the clip
+ * @param cues - receives the recorded notes
+ * @return false when there is no journal for this frame rate
+ */
+bool CueRecorder::readJournal(const QString& fileName, double fps, QVector<cue>& cues)
+{
+    QFile file(fileName);
+    journalHeader header;
+    if (!file.open(QIODevice::ReadOnly) ||
+            file.read(reinterpret_cast<char*>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header)) ||
+            memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 ||
+            header.fpsMillis != static_cast<quint32>(qRound(fps * 1000))) {
+        return false;
+    }
+    QByteArray content = file.readAll();
+    int count = content.size() / static_cast<int>(sizeof(cue));
+    cues.resize(count);
+    memcpy(cues.data(), content.constData(), static_cast<size_t>(count) * sizeof(cue));
+    return true;
+}
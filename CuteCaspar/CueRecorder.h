@@ -0,0 +1,61 @@
+#ifndef CUERECORDER_H
+#define CUERECORDER_H
+
+#include <QFile>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+
+#include "CueTrack.h"
+#include "PlayheadClock.h"
+#include "SpscQueue.h"
+
+/**
+ * @brief The CueRecorder class
+ * Records the notes played live during a take. A note is stamped with the frame the
+ * playhead is at, interpolated between the OSC time reports, and put in a preallocated
+ * lock-free buffer; recording a note never touches the disk. A thread of its own
+ * appends the buffer to a journal "<clip>.journal" a few times per second, so a take
+ * survives a crash and is merged in the next time the clip is recorded. The finished
+ * take is the cue track of the clip with the recorded notes, note offs and velocities
+ * included, added to it.
+ */
+class CueRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    CueRecorder();
+    ~CueRecorder();
+    static QString journalName(QString clipName);
+
+    // GUI thread
+    void start(const QString& clipName, const CueTrack& track);
+    void timecode(double time);
+    void record(CueType type, unsigned int pitch, unsigned int velocity, unsigned int channel = 1);
+    CueTrack finish();
+    bool isRecording() const { return m_recording; }
+    QString getClipName() const { return m_clipName; }
+    quint64 getDropped() const { return m_dropped; }
+
+private slots:
+    void flush();
+
+private:
+    static const int FLUSH_INTERVAL = 200;
+    QThread m_thread;
+    QTimer* m_flushTimer;
+    QFile m_journal;
+    SpscQueue<cue, 4096> m_buffer;
+    PlayheadClock m_clock;
+    CueTrack m_track;
+    QString m_clipName;
+    double m_time = 0.0;
+    bool m_recording = false;
+    quint64 m_dropped = 0;
+    bool openJournal(const QString& fileName, double fps);
+    void closeJournal();
+    static bool readJournal(const QString& fileName, double fps, QVector<cue>& cues);
+};
+
+#endif // CUERECORDER_H
@@ -0,0 +1,135 @@
+#include "CueScheduler.h"
+
+// The timer is started on whole milliseconds and is never late by design, the
+// remainder (less than this, in nanoseconds) is waited for actively
+static const qint64 SPIN_WINDOW = 2000000;
+
+CueScheduler::CueScheduler(CueDispatcher& dispatcher, QObject* parent)
+    : QObject(parent),
+      m_dispatcher(dispatcher),
+      m_timer(this)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, SIGNAL(timeout()),
+            this, SLOT(timeout()));
+}
+
+/**
+ * @brief CueScheduler::update
+ * Feed a time report of the layer into the playhead clock
+ * @param time - playhead position in seconds
+ */
+void CueScheduler::update(double time)
+{
+    m_clock.update(time);
+}
+
+/**
+ * @brief CueScheduler::arm
+ * Start the timer for the next cue of the dispatcher, when it is due within the look-ahead
+ * window. Later cues are armed from a following time report.
+ */
+void CueScheduler::arm()
+{
+    int frame = m_dispatcher.nextFrame();
+    if (!m_clock.isRunning() || frame < 0 || m_lookAhead <= 0) {
+        stop();
+        return;
+    }
+    qint64 due = m_clock.nsecsAt(m_dispatcher.getTrack().timeAt(frame)) - m_lead;
+    qint64 wait = due - m_clock.now();
+    if (wait > m_lookAhead) {
+        stop();
+        return;
+    }
+    m_armedFrame = frame;
+    m_armedAt = due;
+    m_timer.start(static_cast<int>(qMax<qint64>(0, wait / 1000000)));
+}
+
+void CueScheduler::stop()
+{
+    m_timer.stop();
+    m_armedFrame = -1;
+}
+
+/**
+ * @brief CueScheduler::untilShown
+ * @param frame - frame of the track
+ * @return nanoseconds until the frame is shown, the lead when the playhead does not run
+ */
+qint64 CueScheduler::untilShown(int frame) const
+{
+    if (!m_clock.isRunning()) {
+        return m_lead;
+    }
+    return m_clock.nsecsAt(m_dispatcher.getTrack().timeAt(frame)) - m_clock.now();
+}
+
+/**
+ * @brief CueScheduler::reset
+ * Stop the timer and forget the playhead, for example after a new track or a seek
+ */
+void CueScheduler::reset()
+{
+    stop();
+    m_clock.reset();
+}
+
+/**
+ * @brief CueScheduler::setLookAhead
+ * @param msecs - how far ahead of the playhead cues are armed, 0 disables the timer
+ */
+void CueScheduler::setLookAhead(int msecs)
+{
+    m_lookAhead = static_cast<qint64>(msecs) * 1000000;
+    if (msecs <= 0) {
+        stop();
+    }
+}
+
+/**
+ * @brief CueScheduler::setLead
+ * @param msecs - how long before their frame is shown cues are handed out
+ */
+void CueScheduler::setLead(int msecs)
+{
+    m_lead = static_cast<qint64>(qMax(0, msecs)) * 1000000;
+}
+
+void CueScheduler::resetStatistics()
+{
+    m_statistics = scheduleStatistics();
+}
+
+/**
+ * @brief CueScheduler::timeout
+ * Hand out the armed frame at its predicted instant and arm the next one
+ */
+void CueScheduler::timeout()
+{
+    int frame = m_armedFrame;
+    if (frame < 0 || m_dispatcher.nextFrame() != frame) {
+        arm();
+        return;
+    }
+    qint64 now = m_clock.now();
+    if (m_armedAt - now > SPIN_WINDOW) {
+        arm();
+        return;
+    }
+    while (now < m_armedAt) {
+        now = m_clock.now();
+    }
+
+    qint64 error = (now - m_armedAt) / 1000;
+    m_statistics.batches++;
+    m_statistics.lastError = error;
+    m_statistics.totalError += error;
+    m_statistics.maxError = qMax(m_statistics.maxError, error);
+
+    m_armedFrame = -1;
+    emit cuesDue(frame);
+    arm();
+}
@@ -0,0 +1,61 @@
+#ifndef CUESCHEDULER_H
+#define CUESCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include "CueDispatcher.h"
+#include "PlayheadClock.h"
+
+struct scheduleStatistics {
+    quint64 batches = 0;
+    qint64 lastError = 0;
+    qint64 totalError = 0;
+    qint64 maxError = 0;
+};
+
+/**
+ * @brief The CueScheduler class
+ * Plays the cues of a dispatcher at the predicted instant their frame is shown, instead
+ * of waiting for the next OSC time report. The time reports feed a playhead clock; the
+ * next cue within the look-ahead window gets a precise timer. The OSC reports still hand
+ * out anything the timer did not catch. Timing errors are measured in microseconds.
+ * With a lead, cues are handed out that much before their frame is shown, to make up
+ * for the latency of the outputs.
+ */
+class CueScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CueScheduler(CueDispatcher& dispatcher, QObject* parent = nullptr);
+    CueDispatcher& getDispatcher() { return m_dispatcher; }
+    void update(double time);
+    void arm();
+    void stop();
+    void reset();
+    void setLookAhead(int msecs);
+    void setLead(int msecs);
+    double getLead() const { return m_lead / 1e9; }
+    qint64 untilShown(int frame) const;
+    scheduleStatistics getStatistics() const { return m_statistics; }
+    void resetStatistics();
+
+signals:
+    void cuesDue(int frame);
+
+private slots:
+    void timeout();
+
+private:
+    CueDispatcher& m_dispatcher;
+    PlayheadClock m_clock;
+    QTimer m_timer;
+    int m_armedFrame = -1;
+    qint64 m_armedAt = 0;
+    qint64 m_lookAhead = 100000000;
+    qint64 m_lead = 0;
+    scheduleStatistics m_statistics;
+};
+
+#endif // CUESCHEDULER_H
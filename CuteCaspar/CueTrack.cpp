@@ -0,0 +1,252 @@
+#include "CueTrack.h"
+
+#include <QSet>
+
+#include <algorithm>
+
+#include "Timecode.h"
+
+CueTrack::CueTrack()
+{
+}
+
+CueTrack::CueTrack(double fps)
+{
+    m_fps = fps;
+}
+
+/**
+ * @brief CueTrack::CueTrack
+ * Take over cues that are already sorted on frame number
+ * @param cues - the cues
+ * @param fps - frame rate the cues were compiled for
+ */
+CueTrack::CueTrack(const QVector<cue>& cues, double fps)
+{
+    m_cues = cues;
+    m_data = m_cues.constData();
+    m_count = m_cues.size();
+    m_fps = fps;
+}
+
+/**
+ * @brief CueTrack::CueTrack
+ * Wrap the cues of a memory mapped cue file, the file stays mapped for the lifetime of the track
+ * @param file - the mapped file
+ * @param cues - first cue in the mapping
+ * @param count - number of cues
+ * @param fps - frame rate the cues were compiled for
+ */
+CueTrack::CueTrack(QSharedPointer<QFile> file, const cue* cues, int count, double fps)
+{
+    m_file = file;
+    m_data = cues;
+    m_count = count;
+    m_fps = fps;
+}
+
+/**
+ * @brief CueTrack::detach
+ * Copy a mapped track into memory owned by the track before it gets modified
+ */
+void CueTrack::detach()
+{
+    if (isMapped()) {
+        m_cues = QVector<cue>(m_data, m_data + m_count);
+        m_file.clear();
+    }
+}
+
+/**
+ * @brief CueTrack::append
+ * Add a cue at the end of the track. Call sort() when cues are not added in frame order.
+ * @param frame - frame number as returned by Timecode::framesFromTimecode()
+ * @param type - note on or note off
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param velocity - MIDI velocity
+ * @param channel - MIDI channel
+ */
+void CueTrack::append(int frame, CueType type, unsigned int pitch, unsigned int velocity, unsigned int channel)
+{
+    detach();
+    cue newCue;
+    newCue.frame = frame;
+    newCue.type = type;
+    newCue.pitch = static_cast<quint8>(pitch);
+    newCue.velocity = static_cast<quint8>(velocity);
+    newCue.channel = static_cast<quint8>(channel);
+    m_cues.append(newCue);
+    m_data = m_cues.constData();
+    m_count = m_cues.size();
+}
+
+/**
+ * @brief CueTrack::appendDmx
+ * @param frame - frame number
+ * @param address - DMX channel from 0 over all universes, 512 per universe
+ * @param value - level 0 to 255
+ */
+void CueTrack::appendDmx(int frame, unsigned int address, unsigned int value)
+{
+    append(frame, CueType::DMX, address & 0xFF, qMin(value, 255u), (address >> 8) & 0xFF);
+}
+
+/**
+ * @brief CueTrack::appendDmxFade
+ * The DMX cues appended after this one on the same frame fade to their level
+ * @param frame - frame number
+ * @param frames - fade time in frames, up to 65535
+ * @param curve - easing curve, see DmxCurve
+ */
+void CueTrack::appendDmxFade(int frame, unsigned int frames, unsigned int curve)
+{
+    frames = qMin(frames, 0xFFFFu);
+    append(frame, CueType::DMX_FADE, frames & 0xFF, qMin(curve, 3u), frames >> 8);
+}
+
+/**
+ * @brief CueTrack::replace
+ * Replace a run of cues by other cues, the track must stay sorted
+ * @param position - index of the first cue to be replaced
+ * @param removed - number of cues to be removed
+ * @param cues - cues to be inserted at the position
+ * @param count - number of cues to be inserted
+ */
+void CueTrack::replace(int position, int removed, const cue* cues, int count)
+{
+    detach();
+    m_cues.remove(position, removed);
+    m_cues.insert(position, count, cue());
+    std::copy(cues, cues + count, m_cues.begin() + position);
+    m_data = m_cues.constData();
+    m_count = m_cues.size();
+}
+
+/**
+ * @brief CueTrack::sort
+ * Sort the cues on frame number, keeping the order of cues that share a frame
+ */
+void CueTrack::sort()
+{
+    detach();
+    std::stable_sort(m_cues.begin(), m_cues.end(), [](const cue& a, const cue& b) {
+        return a.frame < b.frame;
+    });
+    m_data = m_cues.constData();
+}
+
+/**
+ * @brief CueTrack::frameAt
+ * @param time - playhead position in seconds
+ * @return the frame number the cues of this track are compared against
+ */
+int CueTrack::frameAt(double time) const
+{
+    return Timecode::framesFromTime(time, m_fps);
+}
+
+/**
+ * @brief CueTrack::timeAt
+ * @param frame - frame number
+ * @return the playhead position in seconds at which the given frame starts
+ */
+double CueTrack::timeAt(int frame) const
+{
+    return Timecode::timeFromFrames(frame, m_fps);
+}
+
+/**
+ * @brief CueTrack::indexOf
+ * @param frame - frame number
+ * @return index of the first cue at or after the given frame
+ */
+int CueTrack::indexOf(int frame) const
+{
+    const cue* it = std::lower_bound(m_data, m_data + m_count, frame, [](const cue& c, int f) {
+        return c.frame < f;
+    });
+    return static_cast<int>(it - m_data);
+}
+
+/**
+ * @brief CueTrack::endOfFrame
+ * @param index - index of a cue
+ * @return index just past the last cue on the same frame as the given cue
+ */
+int CueTrack::endOfFrame(int index) const
+{
+    int frame = m_data[index].frame;
+    while (index < m_count && m_data[index].frame == frame) {
+        index++;
+    }
+    return index;
+}
+
+/**
+ * @brief CueTrack::noteCount
+ * @return number of NOTE_ON and NOTE_OFF cues, leaving out DMX and other cues
+ */
+int CueTrack::noteCount() const
+{
+    int notes = 0;
+    for (int i = 0; i < m_count; i++) {
+        if (m_data[i].type == CueType::NOTE_ON || m_data[i].type == CueType::NOTE_OFF) {
+            notes++;
+        }
+    }
+    return notes;
+}
+
+/**
+ * @brief CueTrack::timecodeAt
+ * @param index - index of a cue
+ * @return timecode string of the cue, as written in the sidecar
+ */
+QString CueTrack::timecodeAt(int index) const
+{
+    return Timecode::fromFrames(m_data[index].frame, m_fps);
+}
+
+/**
+ * @brief CueTrack::stateAt
+ * Work out which cues are in effect just before the given frame, as if the track had been
+ * played from the start. For MIDI that is the last chord that was started and not stopped
+ * since, because a new note replaces the sounding one. For every Raspberry PI action it is
+ * the last on or off, for every DMX channel its last level.
+ * @param frame - frame number
+ * @return the cues to be played to bring the outputs in that state
+ */
+QVector<cue> CueTrack::stateAt(int frame) const
+{
+    QVector<cue> state;
+    bool seen[256] = {};
+    QSet<unsigned int> dmxSeen;
+    int chordFrame = -1;
+    for (int i = indexOf(frame) - 1; i >= 0; i--) {
+        const cue& it = m_data[i];
+        if (it.type == CueType::DMX_FADE) {
+            // The state is put in place at once
+            continue;
+        }
+        if (it.type == CueType::DMX) {
+            if (!dmxSeen.contains(dmxAddress(it))) {
+                dmxSeen.insert(dmxAddress(it));
+                state.prepend(it);
+            }
+            continue;
+        }
+        if (it.pitch < 128) {
+            if (chordFrame >= 0 && it.frame != chordFrame) {
+                continue;
+            }
+            if (it.type == CueType::NOTE_ON && !seen[it.pitch]) {
+                chordFrame = it.frame;
+                state.prepend(it);
+            }
+        } else if (!seen[it.pitch]) {
+            state.prepend(it);
+        }
+        seen[it.pitch] = true;
+    }
+    return state;
+}
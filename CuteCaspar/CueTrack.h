@@ -0,0 +1,84 @@
+#ifndef CUETRACK_H
+#define CUETRACK_H
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+enum class CueType : quint8
+{
+    NOTE_OFF = 0,
+    NOTE_ON = 1,
+    // Level of a DMX channel: the channel number is channel << 8 | pitch, counted from 0
+    // over all universes, the level is the velocity
+    DMX = 2,
+    // Fade of the DMX cues that follow on the same frame: the fade time in frames is
+    // channel << 8 | pitch, the easing curve (DmxCurve) is the velocity
+    DMX_FADE = 3
+};
+
+// Packed record, also the on-disk layout of a compiled cue file
+struct cue {
+    qint32 frame;
+    CueType type;
+    quint8 pitch;
+    quint8 velocity;
+    quint8 channel;
+};
+
+static_assert(sizeof(cue) == 8, "cue must stay a packed 8 byte record");
+
+inline unsigned int dmxAddress(const cue& it)
+{
+    return static_cast<unsigned int>(it.channel) << 8 | it.pitch;
+}
+
+inline bool isDmx(const cue& it)
+{
+    return it.type == CueType::DMX || it.type == CueType::DMX_FADE;
+}
+
+/**
+ * @brief The CueTrack class
+ * The cues of one clip, stored as a contiguous array sorted on frame number
+ * so that the player can follow it without touching any strings. A frame can
+ * hold several cues; they keep the order in which they were added.
+ * The array is either owned by the track or a read-only memory mapped file.
+ */
+class CueTrack
+{
+public:
+    CueTrack();
+    explicit CueTrack(double fps);
+    CueTrack(const QVector<cue>& cues, double fps);
+    CueTrack(QSharedPointer<QFile> file, const cue* cues, int count, double fps);
+    void append(int frame, CueType type, unsigned int pitch, unsigned int velocity = 60, unsigned int channel = 1);
+    void appendDmx(int frame, unsigned int address, unsigned int value);
+    void appendDmxFade(int frame, unsigned int frames, unsigned int curve);
+    void sort();
+    void replace(int position, int removed, const cue* cues, int count);
+    int count() const { return m_count; }
+    int noteCount() const;
+    bool isEmpty() const { return m_count == 0; }
+    bool isMapped() const { return !m_file.isNull(); }
+    double getFps() const { return m_fps; }
+    const cue& at(int index) const { return m_data[index]; }
+    const cue* data() const { return m_data; }
+    int frameAt(double time) const;
+    double timeAt(int frame) const;
+    int indexOf(int frame) const;
+    int endOfFrame(int index) const;
+    QVector<cue> stateAt(int frame) const;
+    QString timecodeAt(int index) const;
+
+private:
+    QVector<cue> m_cues;
+    QSharedPointer<QFile> m_file;
+    const cue* m_data = nullptr;
+    int m_count = 0;
+    double m_fps = 25.0;
+    void detach();
+};
+
+#endif // CUETRACK_H
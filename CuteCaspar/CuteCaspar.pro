@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui network sql mqtt
+QT       += core gui network sql mqtt concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -27,20 +27,36 @@ CONFIG += c++11
 SOURCES += \
         CasparOSCListener.cpp \
         ControlDialog.cpp \
+        CueCache.cpp \
+        CueDispatcher.cpp \
+        CueEngine.cpp \
+        CueFile.cpp \
+        CueRecorder.cpp \
+        CueScheduler.cpp \
+        CueTrack.cpp \
         DeviceDialog.cpp \
+        DmxCapture.cpp \
+        DmxCompositor.cpp \
+        DmxOutput.cpp \
         EffectsDelegate.cpp \
         Main.cpp \
         MidiConnection.cpp \
         MidiEditorDialog.cpp \
-        MidiLogger.cpp \
         MidiNotes.cpp \
         MidiPanelDialog.cpp \
         MidiReader.cpp \
+        MtcChase.cpp \
+        MtcGenerator.cpp \
+        OscRouter.cpp \
+        OscSender.cpp \
+        OutputLatency.cpp \
         PlayListDialog.cpp \
         Player.cpp \
+        PlayheadClock.cpp \
         RaspberryPI.cpp \
         RaspberryPIDialog.cpp \
         SettingsDialog.cpp \
+        SmfFile.cpp \
         ip/IpEndpointName.cpp \
         ip/NetworkingUtils.cpp \
         ip/UdpSocket.cpp \
@@ -53,21 +69,37 @@ SOURCES += \
 HEADERS += \
         CasparOSCListener.h \
         ControlDialog.h \
+        CueCache.h \
+        CueDispatcher.h \
+        CueEngine.h \
+        CueFile.h \
+        CueRecorder.h \
+        CueScheduler.h \
+        CueTrack.h \
         DeviceDialog.h \
+        DmxCapture.h \
+        DmxCompositor.h \
+        DmxOutput.h \
         EffectsDelegate.h \
         MainWindow.h \
         MidiConnection.h \
         MidiEditorDialog.h \
-        MidiLogger.h \
         MidiNotes.h \
         MidiPanelDialog.h \
         MidiReader.h \
+        MtcChase.h \
+        MtcGenerator.h \
+        OscRouter.h \
+        OscSender.h \
         Models/LibraryModel.h \
+        OutputLatency.h \
         PlayListDialog.h \
         Player.h \
+        PlayheadClock.h \
         RaspberryPI.h \
         RaspberryPIDialog.h \
         SettingsDialog.h \
+        SmfFile.h \
         ip/IpEndpointName.h \
         ip/NetworkingUtils.h \
         ip/PacketListener.h \
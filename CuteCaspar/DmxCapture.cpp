@@ -0,0 +1,299 @@
+#include "DmxCapture.h"
+
+#include <QDebug>
+
+#include <cstring>
+
+#include "CueFile.h"
+
+DmxCapture::DmxCapture()
+{
+    m_socket = new QUdpSocket(this);
+    connect(m_socket, SIGNAL(readyRead()),
+            this, SLOT(readDatagrams()));
+    moveToThread(&m_thread);
+    m_thread.start(QThread::HighPriority);
+}
+
+DmxCapture::~DmxCapture()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief DmxCapture::open
+ * Start listening for DMX from a console
+ * @param protocol - Art-Net or sACN
+ * @param firstUniverse - network number of the first universe, the others follow it
+ * @param universes - number of universes
+ * @return true when the input is listening
+ */
+bool DmxCapture::open(DmxProtocol protocol, int firstUniverse, int universes)
+{
+    int lowest = (protocol == DmxProtocol::SACN) ? 1 : 0;
+    int highest = (protocol == DmxProtocol::SACN) ? 63999 : 32767;
+    universes = qBound(1, universes, DmxOutput::MAX_UNIVERSES);
+    if (firstUniverse < lowest || firstUniverse + universes - 1 > highest) {
+        qWarning() << "DMX input universes out of range" << firstUniverse << universes;
+        return false;
+    }
+    quint16 port = (protocol == DmxProtocol::SACN) ? 5568 : 6454;
+
+    bool opened = false;
+    QMetaObject::invokeMethod(this, [this, protocol, firstUniverse, universes, port, &opened]() {
+        QMutexLocker locker(&m_mutex);
+        if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+            m_socket->close();
+        }
+        m_protocol = protocol;
+        m_firstUniverse = firstUniverse;
+        m_universes = universes;
+        m_levels.fill(0, universes * UNIVERSE_SIZE);
+        m_previous.fill(0, universes * UNIVERSE_SIZE);
+        m_received.fill(0, universes);
+        opened = m_socket->bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint);
+        if (!opened) {
+            return;
+        }
+        // A console sends every universe some 40 times per second, let the system keep a burst
+        m_socket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 1 << 20);
+        if (protocol == DmxProtocol::SACN) {
+            for (int i = 0; i < universes; i++) {
+                m_socket->joinMulticastGroup(QHostAddress(0xEFFF0000u | static_cast<quint32>(firstUniverse + i)));
+            }
+        }
+    }, Qt::BlockingQueuedConnection);
+
+    if (!opened) {
+        qWarning() << "Cannot listen for DMX on port" << port;
+        return false;
+    }
+    qDebug() << "Listening for" << universes << "DMX universes from" << firstUniverse
+             << (protocol == DmxProtocol::SACN ? "over sACN" : "over Art-Net");
+    return true;
+}
+
+void DmxCapture::close()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        QMutexLocker locker(&m_mutex);
+        if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+            m_socket->close();
+        }
+    }, Qt::BlockingQueuedConnection);
+}
+
+captureStatistics DmxCapture::getStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_statistics;
+}
+
+/**
+ * @brief DmxCapture::start
+ * Start a take, the buffer for the changes is allocated here
+ * @param clipName - name of the clip
+ * @param track - the cues of the clip, for its frame rate
+ */
+void DmxCapture::start(const QString& clipName, const CueTrack& track)
+{
+    m_clipName = clipName;
+    double fps = track.getFps();
+    QMetaObject::invokeMethod(this, [this, fps]() {
+        QMutexLocker locker(&m_mutex);
+        m_track = CueTrack(fps);
+        m_clock.reset();
+        m_time = 0.0;
+        m_frame = -1;
+        m_received.fill(0);
+        m_changes.clear();
+        m_changes.reserve(MAX_CHANGES);
+        m_statistics = captureStatistics();
+        m_capturing = true;
+    }, Qt::BlockingQueuedConnection);
+    m_recording = true;
+    qDebug() << "Capturing DMX for" << clipName;
+}
+
+/**
+ * @brief DmxCapture::timecode
+ * Follow the playhead of the clip being recorded
+ * @param time - playhead position in seconds
+ */
+void DmxCapture::timecode(double time)
+{
+    QMetaObject::invokeMethod(this, [this, time]() {
+        m_time = time;
+        m_clock.update(time);
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief DmxCapture::finish
+ * End the take and write it to the CSV sidecar of the clip, when anything was received.
+ * The DMX cues of the clip are replaced by the take, its notes are kept.
+ * @param take - the cues of the clip, with the notes recorded during the take
+ * @return the cue track with the captured DMX cues
+ */
+CueTrack DmxCapture::finish(const CueTrack& take)
+{
+    if (!m_recording) {
+        return take;
+    }
+    m_recording = false;
+    QVector<cue> changes;
+    QMetaObject::invokeMethod(this, [this, &changes]() {
+        QMutexLocker locker(&m_mutex);
+        if (m_frame >= 0) {
+            recordFrame(m_frame);
+        }
+        m_capturing = false;
+        changes.swap(m_changes);
+    }, Qt::BlockingQueuedConnection);
+
+    captureStatistics statistics = getStatistics();
+    if (statistics.dropped > 0) {
+        qWarning("DMX capture buffer overflowed, %llu changes were lost", statistics.dropped);
+    }
+    if (changes.isEmpty()) {
+        // No console was heard, the DMX cues stay as they are
+        return take;
+    }
+    CueTrack captured(take.getFps());
+    for (int i = 0; i < take.count(); i++) {
+        const cue& it = take.at(i);
+        if (!isDmx(it)) {
+            captured.append(it.frame, it.type, it.pitch, it.velocity, it.channel);
+        }
+    }
+    for (const cue& it : changes) {
+        captured.append(it.frame, it.type, it.pitch, it.velocity, it.channel);
+    }
+    captured.sort();
+
+    if (CueFile::writeSidecar(m_clipName, captured)) {
+        qDebug() << "Captured" << changes.size() << "DMX changes over" << statistics.frames << "frames for" << m_clipName;
+    } else {
+        qWarning() << "Cannot write" << CueFile::sidecarName(m_clipName) << "the DMX take is lost";
+    }
+    return captured;
+}
+
+/**
+ * @brief DmxCapture::readDatagrams
+ * Take in the universes that arrived, into the preallocated buffers (receive thread)
+ */
+void DmxCapture::readDatagrams()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_socket->hasPendingDatagrams()) {
+        qint64 size = m_socket->readDatagram(m_datagram, sizeof(m_datagram));
+        if (size < 0) {
+            break;
+        }
+        if (receive(m_datagram, static_cast<int>(size))) {
+            m_statistics.packets++;
+        } else {
+            m_statistics.invalid++;
+        }
+    }
+}
+
+/**
+ * @brief DmxCapture::receive
+ * Copy the levels of an ArtDmx or E1.31 data packet. The first packet of a new frame
+ * of the playhead records the frame before it.
+ * @param data - the datagram
+ * @param size - its size
+ * @return false when it is not a DMX packet
+ */
+bool DmxCapture::receive(const char* data, int size)
+{
+    int number;
+    int count;
+    const char* levels;
+    if (m_protocol == DmxProtocol::SACN) {
+        if (size < 126 || memcmp(data + 4, "ASC-E1.17", 9) != 0 || data[21] != 0x04 || data[43] != 0x02) {
+            return false;
+        }
+        if ((data[112] & 0xC0) != 0 || data[125] != 0) {
+            // Preview data, a source that stops, or not levels (start code other than 0)
+            return true;
+        }
+        number = static_cast<uchar>(data[113]) << 8 | static_cast<uchar>(data[114]);
+        count = (static_cast<uchar>(data[123]) << 8 | static_cast<uchar>(data[124])) - 1;
+        levels = data + 126;
+        count = qMin(count, size - 126);
+    } else {
+        if (size < 18 || memcmp(data, "Art-Net", 8) != 0 || data[8] != 0x00 || data[9] != 0x50) {
+            return false;
+        }
+        number = static_cast<uchar>(data[14]) | (static_cast<uchar>(data[15]) & 0x7F) << 8;
+        count = static_cast<uchar>(data[16]) << 8 | static_cast<uchar>(data[17]);
+        levels = data + 18;
+        count = qMin(count, size - 18);
+    }
+    int index = number - m_firstUniverse;
+    if (index < 0 || index >= m_universes || count <= 0) {
+        return true;
+    }
+
+    if (m_capturing) {
+        int frame = m_track.frameAt(m_clock.isRunning() ? m_clock.timeAt(m_clock.now()) : m_time);
+        if (frame != m_frame) {
+            if (m_frame >= 0) {
+                recordFrame(m_frame);
+            }
+            m_frame = frame;
+        }
+        if (m_received[index] == 0) {
+            m_received[index] = 1;
+        }
+    }
+    memcpy(m_levels.data() + index * UNIVERSE_SIZE, levels, static_cast<size_t>(qMin(count, static_cast<int>(UNIVERSE_SIZE))));
+    return true;
+}
+
+/**
+ * @brief DmxCapture::recordFrame
+ * Add a cue for every channel that changed since the previous frame, all channels of a
+ * universe on its first frame (receive thread)
+ * @param frame - the frame that ended
+ */
+void DmxCapture::recordFrame(int frame)
+{
+    m_statistics.frames++;
+    for (int i = 0; i < m_universes; i++) {
+        if (m_received[i] == 0) {
+            continue;
+        }
+        bool all = (m_received[i] == 1);
+        m_received[i] = 2;
+        const quint8* levels = m_levels.constData() + i * UNIVERSE_SIZE;
+        quint8* previous = m_previous.data() + i * UNIVERSE_SIZE;
+        if (!all && memcmp(levels, previous, UNIVERSE_SIZE) == 0) {
+            continue;
+        }
+        for (int c = 0; c < UNIVERSE_SIZE; c++) {
+            if (!all && levels[c] == previous[c]) {
+                continue;
+            }
+            if (m_changes.size() == MAX_CHANGES) {
+                m_statistics.dropped++;
+                continue;
+            }
+            unsigned int address = static_cast<unsigned int>(i * UNIVERSE_SIZE + c);
+            cue change;
+            change.frame = frame;
+            change.type = CueType::DMX;
+            change.pitch = static_cast<quint8>(address & 0xFF);
+            change.velocity = levels[c];
+            change.channel = static_cast<quint8>(address >> 8);
+            m_changes.append(change);
+            m_statistics.changes++;
+        }
+        memcpy(previous, levels, UNIVERSE_SIZE);
+    }
+}
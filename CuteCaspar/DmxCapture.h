@@ -0,0 +1,81 @@
+#ifndef DMXCAPTURE_H
+#define DMXCAPTURE_H
+
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QUdpSocket>
+#include <QVector>
+
+#include "CueTrack.h"
+#include "DmxOutput.h"
+#include "PlayheadClock.h"
+
+struct captureStatistics {
+    quint64 packets = 0;
+    quint64 invalid = 0;
+    quint64 frames = 0;
+    quint64 changes = 0;
+    quint64 dropped = 0;
+};
+
+/**
+ * @brief The DmxCapture class
+ * Records what a lighting console sends over Art-Net or E1.31 (sACN) while a clip plays,
+ * as DMX cues of the clip. A thread of its own receives the universes into buffers that
+ * are allocated when the input is opened. Once per frame of the playhead the levels are
+ * compared with those of the previous frame and only the channels that changed become a
+ * cue, so the take is a delta-encoded track that plays back through the cue engine like
+ * any other DMX cue. The first frame a universe is received holds all of its channels.
+ * Channels are numbered from 0 over the captured universes, 512 per universe, the same
+ * way as the DMX output. A take replaces the DMX cues of the clip.
+ */
+class DmxCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int UNIVERSE_SIZE = DmxOutput::UNIVERSE_SIZE;
+    static const int MAX_CHANGES = 1 << 20;
+
+    DmxCapture();
+    ~DmxCapture();
+    bool open(DmxProtocol protocol, int firstUniverse, int universes);
+    void close();
+    captureStatistics getStatistics() const;
+
+    // GUI thread
+    void start(const QString& clipName, const CueTrack& track);
+    void timecode(double time);
+    CueTrack finish(const CueTrack& take);
+    bool isRecording() const { return m_recording; }
+
+private slots:
+    void readDatagrams();
+
+private:
+    QThread m_thread;
+    QUdpSocket* m_socket;
+    mutable QMutex m_mutex;
+    DmxProtocol m_protocol = DmxProtocol::ARTNET;
+    int m_firstUniverse = 0;
+    int m_universes = 0;
+    char m_datagram[1024];
+    QVector<quint8> m_levels;
+    QVector<quint8> m_previous;
+    QVector<quint8> m_received;
+    QVector<cue> m_changes;
+    PlayheadClock m_clock;
+    CueTrack m_track;
+    double m_time = 0.0;
+    int m_frame = -1;
+    bool m_capturing = false;
+    captureStatistics m_statistics;
+    // GUI thread
+    QString m_clipName;
+    bool m_recording = false;
+    bool receive(const char* data, int size);
+    void recordFrame(int frame);
+};
+
+#endif // DMXCAPTURE_H
@@ -0,0 +1,314 @@
+#include "DmxCompositor.h"
+
+#include <QtMath>
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DMX_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define DMX_NEON
+#include <arm_neon.h>
+#endif
+
+DmxCompositor::DmxCompositor()
+{
+    for (int i = 0; i < SOURCES; i++) {
+        m_priority[i] = 100;
+        m_order[i] = i;
+    }
+}
+
+/**
+ * @brief DmxCompositor::resize
+ * Make room for a number of universes, all sources released and all channels HTP
+ * @param universes - number of universes
+ */
+void DmxCompositor::resize(int universes)
+{
+    m_universes = qMax(0, universes);
+    m_channels = m_universes * UNIVERSE_SIZE;
+    m_levels.fill(0, SOURCES * m_channels);
+    m_active.fill(0, SOURCES * m_channels);
+    m_owner.fill(0, SOURCES * m_channels);
+    m_ltp.fill(0, m_channels);
+    m_fadeIndex.fill(-1, SOURCES * m_channels);
+    m_fades.resize(MAX_FADES);
+    m_fadeCount = 0;
+}
+
+/**
+ * @brief DmxCompositor::setPriority
+ * @param source - the source
+ * @param priority - a source of higher priority takes the channels it holds from the lower ones
+ */
+void DmxCompositor::setPriority(DmxSource source, int priority)
+{
+    m_priority[static_cast<int>(source)] = priority;
+    sortSources();
+}
+
+/**
+ * @brief DmxCompositor::setLtp
+ * @param address - channel from 0 over all universes
+ * @param ltp - true when the latest level of the sources of equal priority wins, false for the highest
+ */
+void DmxCompositor::setLtp(unsigned int address, bool ltp)
+{
+    if (address < static_cast<unsigned int>(m_channels)) {
+        m_ltp[static_cast<int>(address)] = ltp ? 0xFF : 0x00;
+    }
+}
+
+/**
+ * @brief DmxCompositor::set
+ * Let a source take a channel to a level, right away or with a fade. A fade starts from
+ * where the channel of the source is, also in the middle of another fade.
+ * @param source - the source
+ * @param address - channel from 0 over all universes
+ * @param value - level
+ * @param now - current time in nanoseconds
+ * @param fade - fade time in nanoseconds
+ * @param curve - easing curve of the fade
+ */
+void DmxCompositor::set(DmxSource source, unsigned int address, quint8 value, qint64 now, qint64 fade, DmxCurve curve)
+{
+    if (address >= static_cast<unsigned int>(m_channels)) {
+        return;
+    }
+    int s = static_cast<int>(source);
+    int index = s * m_channels + static_cast<int>(address);
+    m_active[index] = 0xFF;
+    if (m_ltp[static_cast<int>(address)]) {
+        for (int other = 0; other < SOURCES; other++) {
+            if (m_priority[other] == m_priority[s]) {
+                m_owner[other * m_channels + static_cast<int>(address)] = 0x00;
+            }
+        }
+        m_owner[index] = 0xFF;
+    }
+
+    int position = m_fadeIndex[index];
+    if (fade <= 0 || (position < 0 && m_levels[index] == value)) {
+        m_levels[index] = value;
+        if (position >= 0) {
+            removeFade(position);
+        }
+        return;
+    }
+    if (position < 0) {
+        if (m_fadeCount == MAX_FADES) {
+            // No room for another fade, the level snaps
+            m_levels[index] = value;
+            return;
+        }
+        position = m_fadeCount++;
+        m_fadeIndex[index] = position;
+    }
+    dmxFade& it = m_fades[position];
+    it.index = static_cast<quint32>(index);
+    it.from = m_levels[index];
+    it.to = value;
+    it.curve = curve;
+    it.start = now;
+    it.duration = fade;
+}
+
+/**
+ * @brief DmxCompositor::release
+ * Let go of all channels of a source, e.g. when its cue track is replaced. An LTP channel
+ * passes to another source of the same priority that holds it.
+ * @param source - the source
+ */
+void DmxCompositor::release(DmxSource source)
+{
+    int s = static_cast<int>(source);
+    int base = s * m_channels;
+    for (int k = 0; k < m_fadeCount; ) {
+        if (static_cast<int>(m_fades[k].index) >= base && static_cast<int>(m_fades[k].index) < base + m_channels) {
+            removeFade(k);
+        } else {
+            k++;
+        }
+    }
+    for (int address = 0; address < m_channels; address++) {
+        if (m_owner[base + address]) {
+            for (int other = 0; other < SOURCES; other++) {
+                if (other != s && m_priority[other] == m_priority[s] && m_active[other * m_channels + address]) {
+                    m_owner[other * m_channels + address] = 0xFF;
+                    break;
+                }
+            }
+        }
+    }
+    std::fill(m_levels.begin() + base, m_levels.begin() + base + m_channels, 0);
+    std::fill(m_active.begin() + base, m_active.begin() + base + m_channels, 0);
+    std::fill(m_owner.begin() + base, m_owner.begin() + base + m_channels, 0);
+}
+
+/**
+ * @brief DmxCompositor::evaluate
+ * Bring the levels of the running fades to the given time, finished fades are dropped
+ * @param now - current time in nanoseconds
+ */
+void DmxCompositor::evaluate(qint64 now)
+{
+    quint8* levels = m_levels.data();
+    for (int k = 0; k < m_fadeCount; ) {
+        const dmxFade& it = m_fades[k];
+        qint64 elapsed = now - it.start;
+        if (elapsed >= it.duration) {
+            levels[it.index] = it.to;
+            removeFade(k);
+            continue;
+        }
+        double t = elapsed > 0 ? static_cast<double>(elapsed) / it.duration : 0.0;
+        levels[it.index] = static_cast<quint8>(qRound(it.from + (it.to - it.from) * ease(it.curve, t)));
+        k++;
+    }
+}
+
+/**
+ * @brief DmxCompositor::ease
+ * @param curve - easing curve
+ * @param t - progress of the fade, 0 to 1
+ * @return progress of the level, 0 to 1
+ */
+double DmxCompositor::ease(DmxCurve curve, double t)
+{
+    switch (curve) {
+    case DmxCurve::EASE_IN:
+        return t * t;
+    case DmxCurve::EASE_OUT:
+        return t * (2.0 - t);
+    case DmxCurve::EASE_IN_OUT:
+        return t * t * (3.0 - 2.0 * t);
+    case DmxCurve::LINEAR:
+        break;
+    }
+    return t;
+}
+
+/**
+ * @brief DmxCompositor::merge
+ * Merge the sources into one universe, 16 channels at a time. Per group of sources of
+ * equal priority, from high to low: the HTP level is the highest held level, the LTP
+ * level the one of the latest source; the group gets the channels that no group of
+ * higher priority holds.
+ * @param universe - universe number, from 0
+ * @param output - receives the 512 levels of the universe
+ */
+void DmxCompositor::merge(int universe, quint8* output) const
+{
+#if defined(DMX_SSE2) || defined(DMX_NEON)
+    const int base = universe * UNIVERSE_SIZE;
+    const quint8* levels = m_levels.constData();
+    const quint8* active = m_active.constData();
+    const quint8* owner = m_owner.constData();
+    const quint8* ltpMask = m_ltp.constData() + base;
+    for (int c = 0; c < UNIVERSE_SIZE; c += 16) {
+#if defined(DMX_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ltp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ltpMask + c));
+        __m128i result = zero;
+        __m128i taken = zero;
+        for (int i = 0; i < SOURCES; ) {
+            int priority = m_priority[m_order[i]];
+            __m128i htp = zero;
+            __m128i latest = zero;
+            __m128i held = zero;
+            for (; i < SOURCES && m_priority[m_order[i]] == priority; i++) {
+                int offset = m_order[i] * m_channels + base + c;
+                __m128i level = _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + offset));
+                __m128i hold = _mm_loadu_si128(reinterpret_cast<const __m128i*>(active + offset));
+                __m128i own = _mm_loadu_si128(reinterpret_cast<const __m128i*>(owner + offset));
+                htp = _mm_max_epu8(htp, _mm_and_si128(level, hold));
+                latest = _mm_or_si128(latest, _mm_and_si128(level, own));
+                held = _mm_or_si128(held, hold);
+            }
+            __m128i value = _mm_or_si128(_mm_andnot_si128(ltp, htp), _mm_and_si128(ltp, latest));
+            __m128i claim = _mm_andnot_si128(taken, held);
+            result = _mm_or_si128(_mm_andnot_si128(claim, result), _mm_and_si128(claim, value));
+            taken = _mm_or_si128(taken, held);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + c), result);
+#else
+        const uint8x16_t zero = vdupq_n_u8(0);
+        const uint8x16_t ltp = vld1q_u8(ltpMask + c);
+        uint8x16_t result = zero;
+        uint8x16_t taken = zero;
+        for (int i = 0; i < SOURCES; ) {
+            int priority = m_priority[m_order[i]];
+            uint8x16_t htp = zero;
+            uint8x16_t latest = zero;
+            uint8x16_t held = zero;
+            for (; i < SOURCES && m_priority[m_order[i]] == priority; i++) {
+                int offset = m_order[i] * m_channels + base + c;
+                uint8x16_t level = vld1q_u8(levels + offset);
+                uint8x16_t hold = vld1q_u8(active + offset);
+                uint8x16_t own = vld1q_u8(owner + offset);
+                htp = vmaxq_u8(htp, vandq_u8(level, hold));
+                latest = vorrq_u8(latest, vandq_u8(level, own));
+                held = vorrq_u8(held, hold);
+            }
+            uint8x16_t value = vbslq_u8(ltp, latest, htp);
+            uint8x16_t claim = vbicq_u8(held, taken);
+            result = vbslq_u8(claim, value, result);
+            taken = vorrq_u8(taken, held);
+        }
+        vst1q_u8(output + c, result);
+#endif
+    }
+#else
+    mergeScalar(universe, output);
+#endif
+}
+
+/**
+ * @brief DmxCompositor::mergeScalar
+ * Same as merge(), one channel at a time; the reference for the vector kernels
+ */
+void DmxCompositor::mergeScalar(int universe, quint8* output) const
+{
+    const int base = universe * UNIVERSE_SIZE;
+    for (int c = 0; c < UNIVERSE_SIZE; c++) {
+        quint8 ltp = m_ltp[base + c];
+        quint8 result = 0;
+        quint8 taken = 0;
+        for (int i = 0; i < SOURCES; ) {
+            int priority = m_priority[m_order[i]];
+            quint8 htp = 0;
+            quint8 latest = 0;
+            quint8 held = 0;
+            for (; i < SOURCES && m_priority[m_order[i]] == priority; i++) {
+                int offset = m_order[i] * m_channels + base + c;
+                htp = qMax<quint8>(htp, m_levels[offset] & m_active[offset]);
+                latest |= m_levels[offset] & m_owner[offset];
+                held |= m_active[offset];
+            }
+            quint8 value = static_cast<quint8>((htp & ~ltp) | (latest & ltp));
+            quint8 claim = static_cast<quint8>(held & ~taken);
+            result = static_cast<quint8>((result & ~claim) | (value & claim));
+            taken |= held;
+        }
+        output[c] = result;
+    }
+}
+
+void DmxCompositor::sortSources()
+{
+    std::stable_sort(m_order, m_order + SOURCES, [this](int a, int b) {
+        return m_priority[a] > m_priority[b];
+    });
+}
+
+void DmxCompositor::removeFade(int position)
+{
+    m_fadeIndex[static_cast<int>(m_fades[position].index)] = -1;
+    int last = --m_fadeCount;
+    if (position != last) {
+        m_fades[position] = m_fades[last];
+        m_fadeIndex[static_cast<int>(m_fades[position].index)] = position;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef DMXCOMPOSITOR_H
+#define DMXCOMPOSITOR_H
+
+#include <QVector>
+
+enum class DmxSource : quint8
+{
+    PLAYLIST = 0,
+    SOUNDSCAPE = 1,
+    OVERLAY = 2,
+    MANUAL = 3
+};
+
+enum class DmxCurve : quint8
+{
+    LINEAR = 0,
+    EASE_IN = 1,
+    EASE_OUT = 2,
+    EASE_IN_OUT = 3
+};
+
+/**
+ * @brief The DmxCompositor class
+ * Merges the DMX levels of several sources (clip track, soundscape, scare overlay, manual
+ * presses) into the universes that are sent out. Every source keeps its own levels and
+ * the channels it holds. A channel goes to the source of highest priority that holds it;
+ * sources of the same priority are merged highest takes precedence (HTP), or latest takes
+ * precedence (LTP) on the channels marked as such (moving heads, colour wheels).
+ * A level change can fade in over a time with an easing curve; the running fades are kept
+ * in a fixed list and evaluated once per refresh. The merge works on 16 channels at a
+ * time (SSE2 or NEON), merge() and mergeScalar() give the same result.
+ * Not thread safe, it belongs to the DMX sending thread.
+ */
+class DmxCompositor
+{
+public:
+    static const int UNIVERSE_SIZE = 512;
+    static const int SOURCES = 4;
+    static const int MAX_FADES = 4096;
+
+    DmxCompositor();
+    void resize(int universes);
+    int getUniverses() const { return m_universes; }
+    void setPriority(DmxSource source, int priority);
+    void setLtp(unsigned int address, bool ltp);
+    void set(DmxSource source, unsigned int address, quint8 value, qint64 now, qint64 fade = 0, DmxCurve curve = DmxCurve::LINEAR);
+    void release(DmxSource source);
+    void evaluate(qint64 now);
+    void merge(int universe, quint8* output) const;
+    void mergeScalar(int universe, quint8* output) const;
+    int getActiveFades() const { return m_fadeCount; }
+    static double ease(DmxCurve curve, double t);
+
+private:
+    struct dmxFade {
+        quint32 index;
+        quint8 from;
+        quint8 to;
+        DmxCurve curve;
+        qint64 start;
+        qint64 duration;
+    };
+    int m_universes = 0;
+    int m_channels = 0;
+    // Per source, one byte per channel over all universes
+    QVector<quint8> m_levels;
+    QVector<quint8> m_active;
+    QVector<quint8> m_owner;
+    QVector<quint8> m_ltp;
+    QVector<qint32> m_fadeIndex;
+    QVector<dmxFade> m_fades;
+    int m_fadeCount = 0;
+    int m_priority[SOURCES];
+    int m_order[SOURCES];
+    void sortSources();
+    void removeFade(int position);
+};
+
+#endif // DMXCOMPOSITOR_H
@@ -0,0 +1,388 @@
+#include "DmxOutput.h"
+
+#include <QDebug>
+#include <QUuid>
+
+#include <cstring>
+#include <utility>
+
+DmxOutput::DmxOutput()
+{
+    for (int i = 0; i < DmxCompositor::SOURCES; i++) {
+        m_priority[i] = 100;
+    }
+    m_clock.start();
+    m_socket = new QUdpSocket(this);
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(refresh()));
+    moveToThread(&m_thread);
+    m_thread.start(QThread::TimeCriticalPriority);
+}
+
+DmxOutput::~DmxOutput()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief DmxOutput::protocolFromName
+ * @param name - "artnet" or "sacn" (also "e1.31")
+ * @param valid - receives false for an unknown name
+ */
+DmxProtocol DmxOutput::protocolFromName(const QString& name, bool& valid)
+{
+    QString lower = name.toLower();
+    valid = true;
+    if (lower == "artnet" || lower == "art-net") {
+        return DmxProtocol::ARTNET;
+    }
+    if (lower == "sacn" || lower == "e1.31") {
+        return DmxProtocol::SACN;
+    }
+    valid = false;
+    return DmxProtocol::ARTNET;
+}
+
+/**
+ * @brief DmxOutput::channelsFromText
+ * @param text - channels and ranges of channels, e.g. "0-15,40"
+ * @return the channels, unreadable parts are left out
+ */
+QList<unsigned int> DmxOutput::channelsFromText(const QString& text)
+{
+    QList<unsigned int> channels;
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        QStringList range = part.split('-');
+        bool validFirst;
+        bool validLast;
+        unsigned int first = range.first().trimmed().toUInt(&validFirst);
+        unsigned int last = range.last().trimmed().toUInt(&validLast);
+        if (range.size() > 2 || !validFirst || !validLast || last < first ||
+                last >= static_cast<unsigned int>(MAX_UNIVERSES * UNIVERSE_SIZE)) {
+            qWarning() << "Ignoring DMX channels" << part;
+            continue;
+        }
+        for (unsigned int channel = first; channel <= last; channel++) {
+            channels.append(channel);
+        }
+    }
+    return channels;
+}
+
+/**
+ * @brief DmxOutput::open
+ * Start sending universes
+ * @param protocol - Art-Net or sACN
+ * @param target - IP address of the receiver; empty broadcasts Art-Net and sends sACN to the multicast group of each universe
+ * @param firstUniverse - network number of the first universe, the others follow it
+ * @param universes - number of universes
+ * @param rate - refreshes per second
+ * @return true when the output is sending
+ */
+bool DmxOutput::open(DmxProtocol protocol, const QString& target, int firstUniverse, int universes, double rate)
+{
+    QHostAddress address;
+    if (target != "" && !address.setAddress(target)) {
+        qWarning() << "Invalid DMX target" << target;
+        return false;
+    }
+    int lowest = (protocol == DmxProtocol::SACN) ? 1 : 0;
+    int highest = (protocol == DmxProtocol::SACN) ? 63999 : 32767;
+    universes = qBound(1, universes, MAX_UNIVERSES);
+    if (firstUniverse < lowest || firstUniverse + universes - 1 > highest) {
+        qWarning() << "DMX universes out of range" << firstUniverse << universes;
+        return false;
+    }
+    rate = qBound(1.0, rate, 100.0);
+
+    QMetaObject::invokeMethod(this, [this, protocol, address, firstUniverse, universes, rate]() {
+        QMutexLocker locker(&m_mutex);
+        m_timer->stop();
+        m_protocol = protocol;
+        m_port = (protocol == DmxProtocol::SACN) ? 5568 : 6454;
+        // One source identity per run of the application
+        QByteArray cid = QUuid::createUuid().toRfc4122();
+        m_universes.clear();
+        m_universes.resize(universes);
+        for (int i = 0; i < universes; i++) {
+            dmxUniverse& it = m_universes[i];
+            int number = firstUniverse + i;
+            if (protocol == DmxProtocol::SACN) {
+                buildSacn(it, number, cid);
+            } else {
+                buildArtNet(it, number);
+            }
+            if (!address.isNull()) {
+                it.target = address;
+            } else if (protocol == DmxProtocol::SACN) {
+                it.target = QHostAddress(0xEFFF0000u | static_cast<quint32>(number));
+            } else {
+                it.target = QHostAddress(QHostAddress::Broadcast);
+            }
+        }
+        m_compositor.resize(universes);
+        configure();
+        m_statistics = dmxStatistics();
+        m_jitterSum = 0;
+        m_period = static_cast<qint64>(1e9 / rate);
+        m_start = m_clock.nsecsElapsed();
+        m_due = m_start;
+        m_open = true;
+        m_timer->start(0);
+    }, Qt::BlockingQueuedConnection);
+
+    qDebug() << "Sending" << universes << "DMX universes from" << firstUniverse
+             << (protocol == DmxProtocol::SACN ? "over sACN" : "over Art-Net") << "at" << rate << "Hz";
+    return true;
+}
+
+void DmxOutput::close()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        QMutexLocker locker(&m_mutex);
+        m_timer->stop();
+        m_open = false;
+        m_universes.clear();
+    }, Qt::BlockingQueuedConnection);
+}
+
+bool DmxOutput::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_open;
+}
+
+/**
+ * @brief DmxOutput::setPriority
+ * @param source - the source
+ * @param priority - a source of higher priority takes the channels it holds from the lower ones
+ */
+void DmxOutput::setPriority(DmxSource source, int priority)
+{
+    QMetaObject::invokeMethod(this, [this, source, priority]() {
+        QMutexLocker locker(&m_mutex);
+        m_priority[static_cast<int>(source)] = priority;
+        configure();
+    }, Qt::BlockingQueuedConnection);
+}
+
+/**
+ * @brief DmxOutput::setLtp
+ * @param addresses - the channels on which the latest source wins instead of the highest level
+ */
+void DmxOutput::setLtp(const QList<unsigned int>& addresses)
+{
+    QMetaObject::invokeMethod(this, [this, addresses]() {
+        QMutexLocker locker(&m_mutex);
+        for (unsigned int address : std::as_const(m_ltp)) {
+            m_compositor.setLtp(address, false);
+        }
+        m_ltp = addresses;
+        configure();
+    }, Qt::BlockingQueuedConnection);
+}
+
+void DmxOutput::configure()
+{
+    for (int i = 0; i < DmxCompositor::SOURCES; i++) {
+        m_compositor.setPriority(static_cast<DmxSource>(i), m_priority[i]);
+    }
+    for (unsigned int address : std::as_const(m_ltp)) {
+        m_compositor.setLtp(address, true);
+    }
+}
+
+dmxStatistics DmxOutput::getStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    dmxStatistics statistics = m_statistics;
+    statistics.dropped = m_dropped.loadRelaxed();
+    return statistics;
+}
+
+/**
+ * @brief DmxOutput::set
+ * Change the level of a channel for a source, it goes out with the first refresh after its delay
+ * @param source - where the level comes from
+ * @param address - channel number from 0 over all universes, 512 channels per universe
+ * @param value - level 0 to 255
+ * @param delay - delay in milliseconds
+ * @param fade - fade time in milliseconds
+ * @param curve - easing curve of the fade
+ */
+void DmxOutput::set(DmxSource source, unsigned int address, unsigned int value, int delay, int fade, DmxCurve curve)
+{
+    if (address >= static_cast<unsigned int>(MAX_UNIVERSES * UNIVERSE_SIZE)) {
+        return;
+    }
+    dmxChange change;
+    change.address = static_cast<quint16>(address);
+    change.value = static_cast<quint8>(qMin(value, 255u));
+    change.source = source;
+    change.curve = curve;
+    change.fade = qMax(0, fade);
+    change.due = m_clock.nsecsElapsed() + qMax(0, delay) * 1000000LL;
+    if (!m_changes.push(change)) {
+        m_dropped++;
+    }
+}
+
+/**
+ * @brief DmxOutput::release
+ * Let go of all channels of a source after the delay
+ * @param source - the source
+ * @param delay - delay in milliseconds
+ */
+void DmxOutput::release(DmxSource source, int delay)
+{
+    dmxChange change;
+    change.source = source;
+    change.release = true;
+    change.due = m_clock.nsecsElapsed() + qMax(0, delay) * 1000000LL;
+    if (!m_changes.push(change)) {
+        m_dropped++;
+    }
+}
+
+/**
+ * @brief DmxOutput::refresh
+ * Apply the changes that are due and send every universe, then sleep until the next
+ * refresh. Refreshes are timed from the start, so the rate does not drift; a refresh
+ * that is more than a period late is skipped rather than sent in a burst (sending thread).
+ */
+void DmxOutput::refresh()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) {
+        return;
+    }
+    qint64 now = m_clock.nsecsElapsed();
+    applyChanges(now);
+    m_compositor.evaluate(now);
+
+    for (int i = 0; i < m_universes.size(); i++) {
+        dmxUniverse& it = m_universes[i];
+        m_compositor.merge(i, reinterpret_cast<quint8*>(it.levels));
+        // Art-Net keeps sequence 0 for "not sequenced"
+        it.sequence++;
+        if (it.sequence == 0 && m_protocol == DmxProtocol::ARTNET) {
+            it.sequence = 1;
+        }
+        it.packet.data()[it.sequenceOffset] = static_cast<char>(it.sequence);
+        if (m_socket->writeDatagram(it.packet.constData(), it.packet.size(), it.target, m_port) < 0) {
+            m_statistics.errors++;
+        } else {
+            m_statistics.packets++;
+        }
+    }
+
+    qint64 jitter = qAbs(now - m_due);
+    m_statistics.frames++;
+    m_jitterSum += jitter;
+    m_statistics.meanJitter = m_jitterSum / static_cast<qint64>(m_statistics.frames);
+    m_statistics.maxJitter = qMax(m_statistics.maxJitter, jitter);
+    if (now > m_start) {
+        m_statistics.frameRate = m_statistics.frames * 1e9 / (now - m_start + m_period);
+    }
+
+    m_due += m_period;
+    now = m_clock.nsecsElapsed();
+    if (now - m_due > m_period) {
+        m_due = now;
+    }
+    m_timer->start(static_cast<int>(qMax<qint64>(0, (m_due - now + 500000) / 1000000)));
+}
+
+void DmxOutput::applyChanges(qint64 now)
+{
+    for (;;) {
+        if (!m_hasWaiting) {
+            if (!m_changes.pop(m_waiting)) {
+                return;
+            }
+            m_hasWaiting = true;
+        }
+        if (m_waiting.due > now) {
+            return;
+        }
+        if (m_waiting.release) {
+            m_compositor.release(m_waiting.source);
+        } else {
+            // The fade runs from the instant the change was due
+            m_compositor.set(m_waiting.source, m_waiting.address, m_waiting.value, m_waiting.due,
+                             m_waiting.fade * 1000000LL, m_waiting.curve);
+        }
+        m_hasWaiting = false;
+    }
+}
+
+/**
+ * @brief DmxOutput::buildArtNet
+ * Build an ArtDmx packet for a universe, all levels at 0
+ * @param universe - the universe
+ * @param number - its 15 bit port address
+ */
+void DmxOutput::buildArtNet(dmxUniverse& universe, int number)
+{
+    QByteArray& packet = universe.packet;
+    packet.fill(0, 18 + UNIVERSE_SIZE);
+    char* data = packet.data();
+    memcpy(data, "Art-Net", 8);
+    data[8] = 0x00;                                     // OpDmx 0x5000, low byte first
+    data[9] = 0x50;
+    data[11] = 14;                                      // protocol version
+    data[14] = static_cast<char>(number & 0xFF);        // sub-net and universe
+    data[15] = static_cast<char>((number >> 8) & 0x7F); // net
+    data[16] = static_cast<char>(UNIVERSE_SIZE >> 8);
+    data[17] = static_cast<char>(UNIVERSE_SIZE & 0xFF);
+    universe.sequenceOffset = 12;
+    universe.levels = data + 18;
+}
+
+static void writeFlagsAndLength(char* data, int length)
+{
+    data[0] = static_cast<char>(0x70 | ((length >> 8) & 0x0F));
+    data[1] = static_cast<char>(length & 0xFF);
+}
+
+/**
+ * @brief DmxOutput::buildSacn
+ * Build an E1.31 data packet for a universe, all levels at 0
+ * @param universe - the universe
+ * @param number - its universe number, 1 to 63999
+ * @param cid - 16 byte identity of this source
+ */
+void DmxOutput::buildSacn(dmxUniverse& universe, int number, const QByteArray& cid)
+{
+    const int size = 126 + UNIVERSE_SIZE;
+    QByteArray& packet = universe.packet;
+    packet.fill(0, size);
+    char* data = packet.data();
+    // Root layer
+    data[1] = 0x10;                                     // preamble size
+    memcpy(data + 4, "ASC-E1.17\0\0\0", 12);
+    writeFlagsAndLength(data + 16, size - 16);
+    data[21] = 0x04;                                    // VECTOR_ROOT_E131_DATA
+    memcpy(data + 22, cid.constData(), 16);
+    // Framing layer
+    writeFlagsAndLength(data + 38, size - 38);
+    data[43] = 0x02;                                    // VECTOR_E131_DATA_PACKET
+    memcpy(data + 44, "CuteCaspar", 10);                // source name, 64 bytes
+    data[108] = 100;                                    // priority
+    data[113] = static_cast<char>(number >> 8);
+    data[114] = static_cast<char>(number & 0xFF);
+    // DMP layer
+    writeFlagsAndLength(data + 115, size - 115);
+    data[117] = 0x02;                                   // VECTOR_DMP_SET_PROPERTY
+    data[118] = static_cast<char>(0xA1);                // address and data type
+    data[122] = 0x01;                                   // address increment
+    data[123] = static_cast<char>((UNIVERSE_SIZE + 1) >> 8);
+    data[124] = static_cast<char>((UNIVERSE_SIZE + 1) & 0xFF);
+    universe.sequenceOffset = 111;
+    universe.levels = data + 126;                       // after start code 0
+}
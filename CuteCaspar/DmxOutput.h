@@ -0,0 +1,116 @@
+#ifndef DMXOUTPUT_H
+#define DMXOUTPUT_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+#include <QVector>
+
+#include "DmxCompositor.h"
+#include "SpscQueue.h"
+
+enum class DmxProtocol
+{
+    ARTNET,
+    SACN
+};
+
+struct dmxStatistics {
+    quint64 frames = 0;
+    quint64 packets = 0;
+    quint64 errors = 0;
+    quint64 dropped = 0;
+    double frameRate = 0.0;
+    qint64 meanJitter = 0;
+    qint64 maxJitter = 0;
+};
+
+/**
+ * @brief The DmxOutput class
+ * Sends DMX universes over the network, Art-Net or E1.31 (sACN), without a MIDI to DMX
+ * box in between. A thread of its own sends every universe at a steady refresh rate,
+ * whether it changed or not, and keeps track of how far off the refresh instants it
+ * woke up (jitter). The packets are built once when the output is opened; a refresh
+ * only fills in the levels and the sequence number.
+ * Channels are addressed from 0 over all universes, 512 per universe. The cue engine
+ * hands in level changes through a lock-free queue, each with the source it comes from,
+ * the time it is due and a fade. A DmxCompositor merges the sources on every refresh.
+ */
+class DmxOutput : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int UNIVERSE_SIZE = DmxCompositor::UNIVERSE_SIZE;
+    static const int MAX_UNIVERSES = 128;
+
+    DmxOutput();
+    ~DmxOutput();
+    bool open(DmxProtocol protocol, const QString& target, int firstUniverse, int universes, double rate);
+    void close();
+    bool isOpen() const;
+    dmxStatistics getStatistics() const;
+    void setPriority(DmxSource source, int priority);
+    void setLtp(const QList<unsigned int>& addresses);
+
+    // One producer thread only, the cue engine
+    void set(DmxSource source, unsigned int address, unsigned int value, int delay = 0,
+             int fade = 0, DmxCurve curve = DmxCurve::LINEAR);
+    void release(DmxSource source, int delay = 0);
+
+    static DmxProtocol protocolFromName(const QString& name, bool& valid);
+    static QList<unsigned int> channelsFromText(const QString& text);
+
+private slots:
+    void refresh();
+
+private:
+    struct dmxChange {
+        quint16 address = 0;
+        quint8 value = 0;
+        DmxSource source = DmxSource::PLAYLIST;
+        DmxCurve curve = DmxCurve::LINEAR;
+        bool release = false;
+        qint32 fade = 0;
+        qint64 due = 0;
+    };
+    struct dmxUniverse {
+        QByteArray packet;
+        QHostAddress target;
+        char* levels = nullptr;
+        int sequenceOffset = 0;
+        quint8 sequence = 0;
+    };
+    QThread m_thread;
+    QTimer* m_timer;
+    QUdpSocket* m_socket;
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    bool m_open = false;
+    DmxProtocol m_protocol = DmxProtocol::ARTNET;
+    quint16 m_port = 6454;
+    QVector<dmxUniverse> m_universes;
+    DmxCompositor m_compositor;
+    int m_priority[DmxCompositor::SOURCES];
+    QList<unsigned int> m_ltp;
+    SpscQueue<dmxChange, 4096> m_changes;
+    dmxChange m_waiting;
+    bool m_hasWaiting = false;
+    qint64 m_period = 0;
+    qint64 m_start = 0;
+    qint64 m_due = 0;
+    qint64 m_jitterSum = 0;
+    QAtomicInteger<quint64> m_dropped;
+    dmxStatistics m_statistics;
+    void buildArtNet(dmxUniverse& universe, int number);
+    void buildSacn(dmxUniverse& universe, int number, const QByteArray& cid);
+    void applyChanges(qint64 now);
+    void configure();
+};
+
+#endif // DMXOUTPUT_H
@@ -1,13 +1,16 @@
 #include "MainWindow.h"
 
 #include "Version.h"
+#include "CueFile.h"
+#include "DatabaseManager.h"
+#include "SmfFile.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 #include <QStyleFactory>
 #include <QDir>
 #include <QtSql/QSqlDatabase>
 
-
 int main(int argc, char *argv[])
 {
     QApplication application(argc, argv);
@@ -16,6 +19,30 @@ int main(int argc, char *argv[])
 
     qDebug("Starting %s %s", qPrintable(application.applicationName()), qPrintable(application.applicationVersion()));
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption compileCuesOption("compile-cues", "Compile the cue sidecars of all clips in the library and report timings.");
+    parser.addOption(compileCuesOption);
+    QCommandLineOption importSmfOption("import-smf", "Compile the MIDI file sidecars (<clip>.mid) of all clips in the library.");
+    parser.addOption(importSmfOption);
+    QCommandLineOption exportSmfOption("export-smf", "Write the cues of all clips in the library as MIDI files into <folder>.", "folder");
+    parser.addOption(exportSmfOption);
+    parser.process(application);
+
+    if (parser.isSet(compileCuesOption)) {
+        DatabaseManager::getInstance()->initializeDatabase();
+        return CueFile::compileLibrary() < 0 ? 1 : 0;
+    }
+    if (parser.isSet(importSmfOption)) {
+        DatabaseManager::getInstance()->initializeDatabase();
+        return SmfFile::importLibrary() < 0 ? 1 : 0;
+    }
+    if (parser.isSet(exportSmfOption)) {
+        DatabaseManager::getInstance()->initializeDatabase();
+        return SmfFile::exportLibrary(parser.value(exportSmfOption)) < 0 ? 1 : 0;
+    }
+
     qApp->setStyle(QStyleFactory::create("Fusion"));
 
     QPalette darkPalette;
@@ -7,11 +7,16 @@
 #include <QtSql>
 #include <QtMath>
 
+#include <cstring>
+
 #include "DatabaseManager.h"
 #include "PlayListDialog.h"
 
 #include "Models/LibraryModel.h"
 
+#include "CueCache.h"
+#include "CueEngine.h"
+
 #include "Timecode.h"
 
 MainWindow::MainWindow(QWidget *parent) :
@@ -33,16 +38,18 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(DatabaseManager::getInstance(), SIGNAL(databaseUpdated(QString)),
             this, SLOT(databaseUpdated(QString)));
 
-    // Set-up UDP connection with device
-    udp.bind(QHostAddress::Any, oscPort);
-
-    // Data is available for reading from the device
-    connect(&udp, SIGNAL(readyRead()),
-            this, SLOT(readyRead()));
-
-    // CasparCG OSC listener received data
-    connect(&listener, SIGNAL(messageAvailable(QStringList,QStringList)),
-            this, SLOT(processOsc(QStringList,QStringList)));
+    // CasparCG OSC listener received data, routed by address
+    OscRouter& router = listener.getRouter();
+    router.add("/channel/1/stage/layer/2/file/frame", [this](const int*, const osc::ReceivedMessage& message) {
+        // TO DO: this only needs default video frames, must become parameter
+        emit currentFrame(static_cast<int>(OscRouter::number(message, 0)), static_cast<int>(OscRouter::number(message, 1)));
+    });
+    router.add("/channel/1/stage/layer/#/file/time", [this](const int* numbers, const osc::ReceivedMessage& message) {
+        emit currentTime(OscRouter::number(message, 0), OscRouter::number(message, 1), numbers[0]);
+    });
+    router.add("/channel/1/stage/layer/#/foreground/file/time", [this](const int* numbers, const osc::ReceivedMessage& message) {
+        emit currentTime(OscRouter::number(message, 0), OscRouter::number(message, 1), numbers[0]);
+    });
 
     m_midiCon = MidiConnection::getInstance();
     m_raspberryPI = RaspberryPI::getInstance();
@@ -50,6 +57,11 @@ MainWindow::MainWindow(QWidget *parent) :
     // Set-up player
     m_player = Player::getInstance();
 
+    // OSC messages from the device are received by the cue engine, in a thread of its own
+    connect(CueEngine::getInstance(), SIGNAL(datagramsPending()),
+            this, SLOT(processDatagrams()), Qt::QueuedConnection);
+    CueEngine::getInstance()->start(oscPort);
+
     connect(m_player, SIGNAL(newRandomClip(ClipInfo)),
             SLOT(newRandomClip(ClipInfo)));
 
@@ -80,6 +92,7 @@ MainWindow::MainWindow(QWidget *parent) :
 MainWindow::~MainWindow()
 {
     disconnectServer();
+    CueEngine::getInstance()->stop();
     delete ui;
 }
 
@@ -115,8 +128,8 @@ void MainWindow::connectServer()
     m_device->connectDevice();
     m_player->setDevice(m_device);
 
-    connect(m_midiCon, SIGNAL(midiMessageReceived(unsigned int, bool)),
-            m_player, SLOT(playNote(unsigned int, bool)), Qt::UniqueConnection);
+    connect(m_midiCon, SIGNAL(midiMessageReceived(unsigned int, bool, unsigned int)),
+            m_player, SLOT(playNote(unsigned int, bool, unsigned int)), Qt::UniqueConnection);
 
     // Playlist: when next clip has started, load the following clip
     connect(this, SIGNAL(nextClip()),
@@ -137,10 +150,6 @@ void MainWindow::connectServer()
     connect(m_player, SIGNAL(playerStatus(PlayerStatus, bool)),
             this, SLOT(playerStatus(PlayerStatus, bool)), Qt::UniqueConnection);
 
-    // Player wants to refresh playlist
-    connect(m_player, SIGNAL(refreshPlayList()),
-            this, SLOT(refreshPlayList()), Qt::UniqueConnection);
-
     connect(m_raspberryPI, SIGNAL(insertPlaylist(QString, QString)),
             m_player, SLOT(insertPlaylist(QString, QString)), Qt::UniqueConnection);
 
@@ -198,40 +207,25 @@ void MainWindow::onTcpStateChanged(QAbstractSocket::SocketState socketState)
 }
 
 /**
- * @brief MainWindow::readyRead
- * Data is available for reading from device. This data will be read and
- * forwarded to th OSC listener.
+ * @brief MainWindow::processDatagrams
+ * Datagrams from the device have been received by the cue engine. They are
+ * taken from its queue and forwarded to the OSC listener.
  */
-void MainWindow::readyRead()
-{
-    QByteArray buffer;
-    buffer.resize(static_cast<int>(udp.pendingDatagramSize()));
-    QHostAddress sender;
-    quint16 senderPort;
-    udp.readDatagram(buffer.data(), buffer.size(), &sender, &senderPort);
-    if (buffer.mid(0, 5) == "raspi") {
-        emit parseMessage(&buffer.data()[6]);
-    } else {
-        listener.ProcessPacket(buffer.data(), buffer.size(), IpEndpointName(sender.toIPv4Address(), senderPort));
+void MainWindow::processDatagrams()
+{
+    const oscDatagram* datagram;
+    while ((datagram = CueEngine::getInstance()->takeDatagram()) != nullptr) {
+        if (datagram->size >= 5 && memcmp(datagram->data, "raspi", 5) == 0) {
+            emit parseMessage(QString::fromLatin1(datagram->data + 6, qMax(0, datagram->size - 6)));
+        } else {
+            listener.ProcessPacket(datagram->data, datagram->size, IpEndpointName());
+        }
+        CueEngine::getInstance()->releaseDatagram(datagram);
     }
-}
-
-/**
- * @brief Process recieved OSC messages
- * @param address - An OSC Address Pattern in StringList
- * @param values - A list of OSC values
- */
-void MainWindow::processOsc(QStringList address, QStringList values)
-{
-    QString adr = address.join("/");
-    if (adr == "channel/1/stage/layer/2/file/frame") {  // TO DO: this only needs default video frames, must become parameter
-        emit currentFrame(values[0].toInt(), values[1].toInt());
-    } else if (QRegularExpression("channel/1/stage/layer/./file/time").match(adr).hasMatch()) {
-        emit currentTime(values[0].toDouble(), values[1].toDouble(), address[4].toInt());
-    } else if (QRegularExpression("channel/1/stage/layer/./foreground/file/time").match(adr).hasMatch()) {
-        emit currentTime(values[0].toDouble(), values[1].toDouble(), address[4].toInt());
-    } else {
-//      qDebug() << address << values;
+    quint64 dropped = CueEngine::getInstance()->getDroppedDatagrams();
+    if (dropped != m_droppedDatagrams) {
+        qWarning("Cue engine: %llu OSC datagrams dropped, the GUI cannot keep up", dropped - m_droppedDatagrams);
+        m_droppedDatagrams = dropped;
     }
 }
 
@@ -279,6 +273,7 @@ void MainWindow::mediaChanged(const QList<CasparMedia>& mediaItems, CasparDevice
 //    }
 
     // Find library items to insert.
+    MidiReader midiRead;
     foreach (CasparMedia mediaItem, mediaItems)
     {
         bool found = false;
@@ -290,9 +285,8 @@ void MainWindow::mediaChanged(const QList<CasparMedia>& mediaItems, CasparDevice
 
         if (!found) {
             int numberOfNotes = 0;
-            MidiReader *midiRead = new MidiReader();
-            QMap<QString, message> midiList = midiRead->openLog(mediaItem.getName());
-            if (midiRead->isReady()) {
+            CueTrack midiList = midiRead.openLog(mediaItem.getName(), mediaItem.getFPS());
+            if (midiRead.isReady()) {
                 numberOfNotes = midiList.count();
             }
             insertModels.push_back(LibraryModel(0, mediaItem.getName(), mediaItem.getName(), "", mediaItem.getType(), 0, mediaItem.getTimecode(), mediaItem.getFPS(), numberOfNotes));
@@ -308,6 +302,10 @@ void MainWindow::mediaChanged(const QList<CasparMedia>& mediaItems, CasparDevice
     }
 
     qDebug("LibraryManager::mediaChanged %lld msec", time.elapsed());
+
+    cacheStatistics cache = CueCache::getInstance()->getStatistics();
+    qDebug("Cue cache: %d tracks, %lld bytes, %llu hits, %llu misses, %llu evictions",
+           cache.entries, cache.bytes, cache.hits, cache.misses, cache.evictions);
 }
 
 void MainWindow::on_actionExit_triggered()
@@ -743,8 +741,8 @@ void MainWindow::on_actionMIDI_Editor_triggered()
         m_midiEditorDialog = new MidiEditorDialog();
 
         // Retrieve current MIDI playlist from Player
-        connect(m_player, SIGNAL(newMidiPlaylist(QMap<QString, message>, double)),
-                m_midiEditorDialog, SLOT(newMidiPlaylist(QMap<QString, message>, double)));
+        connect(m_player, SIGNAL(newMidiPlaylist(CueTrack, double)),
+                m_midiEditorDialog, SLOT(newMidiPlaylist(CueTrack, double)));
 
         // Actual note being played at the moment
         connect(m_player, SIGNAL(currentNote(QString, bool, unsigned int)),
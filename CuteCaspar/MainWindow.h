@@ -21,7 +21,6 @@
 #include "RaspberryPIDialog.h"
 #include "ControlDialog.h"
 
-#include "MidiLogger.h"
 #include "MidiReader.h"
 #include "Player.h"
 #include "MidiConnection.h"
@@ -43,8 +42,7 @@ public:
 
 public slots:
     void onTcpStateChanged(QAbstractSocket::SocketState socketState);
-    void readyRead();
-    void processOsc(QStringList address, QStringList values);
+    void processDatagrams();
     void listMedia();
     void setTimeCode(double time, double duration, int videoLayer);
     void reportActiveClip(ClipInfo clipName, ClipInfo upcoming, bool insert = false);
@@ -100,7 +98,7 @@ signals:
 private:
     Ui::MainWindow *ui;
     QTcpSocket tcp;
-    QUdpSocket udp;
+    quint64 m_droppedDatagrams = 0;
     int playCurVFrame, playLastVFrame, playFps;
     void log(QString message);
     CasparOscListener listener;
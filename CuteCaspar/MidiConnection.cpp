@@ -81,6 +81,7 @@ void MidiConnection::openInputPort(int index)
 
 void MidiConnection::openOutputPort(int index)
 {
+    QMutexLocker locker(&m_outputMutex);
     if(midiOut->isPortOpen()) {
         midiOut->closePort();
     }
@@ -106,27 +107,54 @@ int MidiConnection::getOpenOutputPortIndex() const {
 }
 
 
-void MidiConnection::playNote(unsigned int pitch)
+void MidiConnection::playNote(unsigned int pitch, unsigned int velocity, unsigned int channel)
 {
-    QMidiMessage *message = new QMidiMessage();
-    message->setChannel(1);
-    message->setStatus(MIDI_NOTE_ON);
-    message->setPitch(pitch);
-    message->setVelocity(60);
+    // Notes are sent from the cue engine thread as well as from the GUI
+    QMutexLocker locker(&m_outputMutex);
+    midiOut->sendNoteOn(channel, pitch, velocity);
+}
+
 
-    midiOut->sendMessage(message);
+void MidiConnection::killNote(unsigned int pitch, unsigned int channel)
+{
+    QMutexLocker locker(&m_outputMutex);
+    midiOut->sendNoteOff(channel, pitch, 0);
 }
 
 
-void MidiConnection::killNote(unsigned int pitch)
+/**
+ * @brief MidiConnection::sendBatch
+ * Send all messages that are due on the same frame in one go
+ * @param messages - the messages, in the order they have to be sent
+ * @param count - number of messages
+ */
+void MidiConnection::sendBatch(const QMidiShortMessage* messages, int count)
 {
-    QMidiMessage *message = new QMidiMessage();
-    message->setChannel(1);
-    message->setStatus(MIDI_NOTE_OFF);
-    message->setPitch(pitch);
-    message->setVelocity(0);
+    QMutexLocker locker(&m_outputMutex);
+    midiOut->sendBatch(messages, count);
+}
 
-    midiOut->sendMessage(message);
+/**
+ * @brief MidiConnection::scheduleBatch
+ * Hand messages to the output now and let the MIDI driver deliver them after a delay,
+ * without a timer in this application
+ * @param messages - the messages, in the order they have to be sent
+ * @param count - number of messages
+ * @param delay - delay in milliseconds
+ * @return false when the output cannot schedule, nothing was sent then
+ */
+bool MidiConnection::scheduleBatch(const QMidiShortMessage* messages, int count, int delay)
+{
+    QMutexLocker locker(&m_outputMutex);
+    if (!midiOut->canSchedule()) {
+        return false;
+    }
+    double now = midiOut->getQueueTime();
+    if (now < 0.0) {
+        return false;
+    }
+    midiOut->scheduleBatch(messages, count, now + delay / 1000.0);
+    return true;
 }
 
 
@@ -141,16 +169,16 @@ void MidiConnection::messageReceived(QMidiMessage* msg)
     case MIDI_NOTE_ON:
         if (msg->getVelocity() == 0) {
             if (LOG_MIDI_NOTE_OFF) {
-                emit midiMessageReceived(msg->getPitch(), false);
+                emit midiMessageReceived(msg->getPitch(), false, 0);
             }
         } else {
             // For Yamaha interpretation of MIDI_NOTE_ON with velocity 0
-            emit midiMessageReceived(msg->getPitch(), true);
+            emit midiMessageReceived(msg->getPitch(), true, msg->getVelocity());
         }
         break;
     case MIDI_NOTE_OFF:
         if (LOG_MIDI_NOTE_OFF) {
-            emit midiMessageReceived(msg->getPitch(), false);
+            emit midiMessageReceived(msg->getPitch(), false, msg->getVelocity());
         }
         break;
     default:
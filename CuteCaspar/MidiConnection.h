@@ -1,6 +1,8 @@
 #ifndef MIDICONNECTION_H
 #define MIDICONNECTION_H
 
+#include <QMutex>
+
 #include "qmidiin.h"
 #include "qmidiout.h"
 #include "qmidimessage.h"
@@ -18,8 +20,10 @@ public:
     QStringList getAvailableOutputPorts();
     void openInputPort(int index);
     void openOutputPort(int index);
-    void playNote(unsigned int pitch);
-    void killNote(unsigned int pitch);
+    void playNote(unsigned int pitch, unsigned int velocity = 60, unsigned int channel = 1);
+    void killNote(unsigned int pitch, unsigned int channel = 1);
+    void sendBatch(const QMidiShortMessage* messages, int count);
+    bool scheduleBatch(const QMidiShortMessage* messages, int count, int delay);
     int getOpenInputPortIndex() const;
     int getOpenOutputPortIndex() const;
 
@@ -27,7 +31,7 @@ public slots:
     void messageReceived(QMidiMessage *msg);
 
 signals:
-    void midiMessageReceived(unsigned int pitch, bool onOff);
+    void midiMessageReceived(unsigned int pitch, bool onOff, unsigned int velocity);
 
 private:
     static MidiConnection* s_inst;
@@ -37,6 +41,7 @@ private:
     QString currentOutputPortName = nullptr;
     int currentInputPortIndex = -1;
     int currentOutputPortIndex = -1;
+    QMutex m_outputMutex;
 };
 
 #endif // MIDICONNECTION_H
@@ -4,7 +4,6 @@
 #include "MidiNotes.h"
 #include "Timecode.h"
 #include "EffectsDelegate.h"
-#include "DatabaseManager.h"
 
 
 MidiEditorDialog::MidiEditorDialog(QWidget *parent) :
@@ -47,19 +46,27 @@ MidiEditorDialog::~MidiEditorDialog()
  * @param midiPlayList - the playlist to be loaded
  * @param timecode - the timecode to put the pointer at
  */
-void MidiEditorDialog::newMidiPlaylist(QMap<QString, message> midiPlayList, double timecode)
+void MidiEditorDialog::newMidiPlaylist(CueTrack midiPlayList, double timecode)
 {
     m_model->setRowCount(0);
-    m_midiPlaylist = &midiPlayList;
-
-    int row = 0;
+    m_cues = QVector<cue>(midiPlayList.data(), midiPlayList.data() + midiPlayList.count());
+    m_fps = midiPlayList.getFps();
 
     MidiNotes* midiNotes = MidiNotes::getInstance();
 
-    for(QString time : midiPlayList.keys()) {
-        m_model->setItem(row, 0, new QStandardItem(time));
-        m_model->setItem(row, 1, new QStandardItem(midiPlayList.value(time).type));
-        m_model->setItem(row, 2, new QStandardItem(midiNotes->getNoteNameByPitch(midiPlayList.value(time).pitch)));
+    int row = 0;
+    for (int i = 0; i < midiPlayList.count(); i++) {
+        const cue& it = midiPlayList.at(i);
+        if (isDmx(it)) {
+            // The editor is about notes, DMX levels and fades are kept as they are
+            continue;
+        }
+        // The row remembers its cue, so saving keeps what the editor does not show
+        QStandardItem* item = new QStandardItem(midiPlayList.timecodeAt(i));
+        item->setData(i, Qt::UserRole);
+        m_model->setItem(row, 0, item);
+        m_model->setItem(row, 1, new QStandardItem(it.type == CueType::NOTE_ON ? "ON" : "OFF"));
+        m_model->setItem(row, 2, new QStandardItem(midiNotes->getNoteNameByPitch(it.pitch)));
         row++;
     }
 
@@ -81,18 +88,20 @@ void MidiEditorDialog::newMidiPlaylist(QMap<QString, message> midiPlayList, doub
 
 void MidiEditorDialog::currentNote(QString timecode, bool noteOn, unsigned int pitch)
 {
-    Q_UNUSED(noteOn)
-    Q_UNUSED(pitch)
-
-    QModelIndexList matches = m_model->match(m_model->index(0,0), Qt::DisplayRole, timecode);
-    if (matches.size() == 0) {
-        addNewNote(timecode, noteOn, pitch);
-    } else {
-        foreach(const QModelIndex &index, matches) {
+    // Several notes can share a timecode, only the same note on the same timecode is known already
+    QString effect = MidiNotes::getInstance()->getNoteNameByPitch(pitch);
+    QModelIndexList matches = m_model->match(m_model->index(0,0), Qt::DisplayRole, timecode, -1);
+    bool found = false;
+    foreach(const QModelIndex &index, matches) {
+        if (m_model->data(m_model->index(index.row(), 2)).toString() == effect) {
             ui->tableView->selectRow(index.row());
             m_currentIndex = index.row();
+            found = true;
         }
     }
+    if (!found) {
+        addNewNote(timecode, noteOn, pitch);
+    }
 }
 
 void MidiEditorDialog::addNewNote(QString timecode, bool noteOn, unsigned int pitch)
@@ -154,21 +163,64 @@ void MidiEditorDialog::on_btnDelete_clicked()
 }
 
 
+/**
+ * @brief MidiEditorDialog::on_btnSave_clicked
+ * A row loaded from the track replaces its cue where it was, only the fields that were
+ * edited change; the velocity and channel of recorded and imported notes are kept, and
+ * the saved track differs from the sidecar only where it was edited. Deleted rows drop
+ * their cue, added rows are new notes.
+ */
 void MidiEditorDialog::on_btnSave_clicked()
 {
+    MidiNotes* midiNotes = MidiNotes::getInstance();
+    QVector<cue> cues = m_cues;
+    QVector<bool> kept(cues.size());
+    for (int i = 0; i < cues.size(); i++) {
+        kept[i] = isDmx(cues[i]);
+    }
+    QVector<cue> added;
+
     int numberOfRows = m_model->rowCount();
-    QMap<QString, message> output;
     for (int i = 0; i < numberOfRows; i++) {
-        qDebug() << m_model->data(m_model->index(i,0)).toString()
-                 << m_model->data(m_model->index(i,1)).toString()
-                 << MidiNotes::getInstance()->getNotePitchByName(m_model->data(m_model->index(i,2)).toString());
-        message newNote;
-        newNote.timeCode = m_model->data(m_model->index(i,0)).toString();
-        newNote.type = m_model->data(m_model->index(i,1)).toString();
-        newNote.pitch = MidiNotes::getInstance()->getNotePitchByName(m_model->data(m_model->index(i,2)).toString());
-        output[m_model->data(m_model->index(i,0)).toString()] = newNote;
-    }
-    DatabaseManager::getInstance()->updateMidiStatus(m_activeClip.getName(), numberOfRows);
+        QString timecode = m_model->data(m_model->index(i,0)).toString();
+        QString type = m_model->data(m_model->index(i,1)).toString();
+        QString effect = m_model->data(m_model->index(i,2)).toString();
+        QVariant index = m_model->data(m_model->index(i,0), Qt::UserRole);
+
+        cue it;
+        it.velocity = 60;
+        it.channel = 1;
+        if (index.isValid()) {
+            it = cues[index.toInt()];
+        }
+        if (!index.isValid() || timecode != Timecode::fromFrames(it.frame, m_fps)) {
+            it.frame = Timecode::framesFromTimecode(timecode, m_fps);
+        }
+        if (it.frame < 0) {
+            continue;
+        }
+        it.type = (type == "ON") ? CueType::NOTE_ON : CueType::NOTE_OFF;
+        if (!index.isValid() || effect != midiNotes->getNoteNameByPitch(it.pitch)) {
+            it.pitch = static_cast<quint8>(midiNotes->getNotePitchByName(effect));
+        }
+        if (index.isValid()) {
+            cues[index.toInt()] = it;
+            kept[index.toInt()] = true;
+        } else {
+            added.append(it);
+        }
+    }
+
+    CueTrack output(m_fps);
+    for (int i = 0; i < cues.size(); i++) {
+        if (kept[i]) {
+            output.append(cues[i].frame, cues[i].type, cues[i].pitch, cues[i].velocity, cues[i].channel);
+        }
+    }
+    for (const cue& it : added) {
+        output.append(it.frame, it.type, it.pitch, it.velocity, it.channel);
+    }
+    output.sort();
     Player::getInstance()->saveMidiPlayList(output);
 }
 
@@ -229,7 +281,7 @@ void MidiEditorDialog::setClip(ClipInfo clip)
     if (clip.getName() != "") {
         m_activeClip = clip;
         ui->lblClipName->setText(m_activeClip.getName());
-        Player::getInstance()->retrieveMidiPlayList(m_activeClip.getName());
+        Player::getInstance()->retrieveMidiPlayList(m_activeClip);
     }
 }
 
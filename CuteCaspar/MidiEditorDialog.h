@@ -19,7 +19,7 @@ public:
     ~MidiEditorDialog();
 
 public slots:
-    void newMidiPlaylist(QMap<QString, message> midiPlayList, double timecode);
+    void newMidiPlaylist(CueTrack midiPlayList, double timecode);
     void currentNote(QString timecode, bool noteOn, unsigned int pitch);
     void setClip(ClipInfo clip);
     void playerStatus(PlayerStatus status, bool recording);
@@ -34,11 +34,12 @@ private slots:
 private:
     Ui::MidiEditorDialog *ui;
     QStandardItemModel* m_model = nullptr;
-    QMap<QString, message>* m_midiPlaylist = nullptr;
     int m_currentIndex = 0;
     ClipInfo m_activeClip;
     PlayerStatus m_playerStatus;
     QString m_timecode;
+    QVector<cue> m_cues;
+    double m_fps = 25.0;
     void addNewNote(QString timecode, bool noteOn, unsigned int pitch);
 };
 
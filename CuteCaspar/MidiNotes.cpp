@@ -40,16 +40,32 @@ void MidiNotes::loadNotes()
         tempNote.pitch = line.split(',').at(1).toUInt();
         tempNote.duration = line.split(',').at(2).toUInt();
         tempNote.next = line.split(',').at(3).toUInt();
+        // Optional: DMX channel and level of a manual press
+        if (line.split(',').size() > 5) {
+            bool valid;
+            int channel = line.split(',').at(4).trimmed().toInt(&valid);
+            if (valid) {
+                tempNote.dmxChannel = channel;
+                tempNote.dmxLevel = qMin(line.split(',').at(5).trimmed().toUInt(), 255u);
+            }
+        }
         m_notes.append(tempNote);
         counter++;
     }
 
-    // Add RaspberryPI actions
-    m_notes.append({counter++, "Button", 129, 0, 0});
-    m_notes.append({counter++, "Light" , 130, 0, 0});
-    m_notes.append({counter++, "Magnet", 131, 0, 0});
-    m_notes.append({counter++, "Motion", 132, 0, 0});
-    m_notes.append({counter++, "Smoke",  133, 0, 0});
+    // Add RaspberryPI actions, unless the profile defines them with a duration
+    // (a smoke burst, a latch that closes again)
+    const QList<note> actions = {{0, "Button", 129, 0, 0},
+                                 {0, "Light" , 130, 0, 0},
+                                 {0, "Magnet", 131, 0, 0},
+                                 {0, "Motion", 132, 0, 0},
+                                 {0, "Smoke",  133, 0, 0}};
+    for (note action : actions) {
+        if (getNoteNameByPitch(action.pitch).isEmpty()) {
+            action.id = counter++;
+            m_notes.append(action);
+        }
+    }
 }
 
 QList<note> MidiNotes::getNotes() const
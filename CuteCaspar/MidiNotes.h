@@ -9,6 +9,9 @@ struct note {
     unsigned int pitch;
     unsigned int duration;
     unsigned int next;
+    // DMX channel set by a manual press, -1 for none
+    int dmxChannel = -1;
+    unsigned int dmxLevel = 255;
 };
 
 class MidiNotes : public QObject
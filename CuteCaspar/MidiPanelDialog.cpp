@@ -3,6 +3,8 @@
 
 #include <QtCore>
 
+#include "CueEngine.h"
+
 MidiPanelDialog::MidiPanelDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::MidiPanelDialog)
@@ -38,14 +40,7 @@ MidiPanelDialog::MidiPanelDialog(QWidget *parent) :
         }
         button[notes[i].pitch] = newButton;
     }
-
-    // Timer sequence for notes with a duration
-    m_timer = new QTimer(this);
-    m_timer->setSingleShot(true);
-    connect(this, SIGNAL(waitNote(int)),
-            m_timer, SLOT(start(int)));
-    connect(m_timer, SIGNAL(timeout()),
-            this, SLOT(automatedSequence()));
+    CueEngine::getInstance()->setAutomationActive(ui->chkLive->isChecked());
 }
 
 MidiPanelDialog::~MidiPanelDialog()
@@ -107,13 +102,6 @@ void MidiPanelDialog::activateButton(unsigned int pitch, bool active)
             previousPitch = pitch;
         }
     }
-    if (m_timer->isActive()) {
-        m_timer->stop();
-    }
-    if (MidiNotes::getInstance()->getDuration(pitch) > 0 && m_live) {
-        m_nextPitch = MidiNotes::getInstance()->getNext(pitch);
-        emit waitNote(static_cast<int>(MidiNotes::getInstance()->getDuration(pitch)));
-    }
 }
 
 void MidiPanelDialog::setButtonColor(QPushButton* button, QColor color)
@@ -124,12 +112,11 @@ void MidiPanelDialog::setButtonColor(QPushButton* button, QColor color)
     button->update();
 }
 
-void MidiPanelDialog::automatedSequence()
-{
-    activateButton(m_nextPitch);
-}
-
+/**
+ * @brief MidiPanelDialog::on_chkLive_stateChanged
+ * Notes with a duration are followed up by the cue engine, also when this dialog is closed
+ */
 void MidiPanelDialog::on_chkLive_stateChanged(int check)
 {
-    m_live = check;
+    CueEngine::getInstance()->setAutomationActive(check);
 }
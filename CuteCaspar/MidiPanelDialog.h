@@ -24,12 +24,10 @@ public slots:
 
 signals:
     void buttonPushed(unsigned int, bool);
-    void waitNote(int duration);
 
 private slots:
     void playNote();
     void killNote();
-    void automatedSequence();
     void on_chkLive_stateChanged(int check);
 
 private:
@@ -37,15 +35,12 @@ private:
     QList<note> notes;
     QMap<unsigned int, QPushButton*> button;
     unsigned int previousPitch = 0;
-    unsigned int m_nextPitch = 0;
     void setButtonColor(QPushButton *button, QColor color);
     bool m_button = false;
     bool m_light = false;
     bool m_magnet = false;
     bool m_motion = false;
     bool m_smoke = false;
-    QTimer* m_timer;
-    bool m_live = true;
 };
 
 #endif // MIDIPANELDIALOG_H
@@ -1,35 +1,23 @@
 #include "MidiReader.h"
 
-#include "QFile"
-#include "QTextStream"
-#include "QDebug"
+#include "CueCache.h"
 
 MidiReader::MidiReader()
 {
     m_ready = false;
 }
 
-QMap<QString, message> MidiReader::openLog(QString videoFile)
+/**
+ * @brief MidiReader::openLog
+ * Load the cues of a clip from its sidecar, through the shared cue cache
+ * @param videoFile - name of the clip
+ * @param fps - frame rate of the clip
+ * @return the cue track
+ */
+CueTrack MidiReader::openLog(QString videoFile, double fps)
 {
-    m_ready = false;
-    QMap<QString, message> output;
-    QFile logFile(QString("%1.midi").arg(videoFile.replace("/","-")));
-    if (logFile.open(QIODevice::ReadOnly)) {
-       QTextStream in(&logFile);
-       while (!in.atEnd()) {
-          QString line = in.readLine();
-          QStringList list = line.split(",");
-          message message;
-          message.timeCode = list.at(0);
-          message.type = list.at(1);
-          message.pitch = list.at(2).toUInt();
-          output[list.at(0)] = message;
-       }
-       logFile.close();
-       if (output.size() != 0) {
-            m_ready = true;
-       }
-    }
+    CueTrack output = CueCache::getInstance()->getTrack(videoFile, fps);
+    m_ready = !output.isEmpty();
     return output;
 }
 
@@ -3,17 +3,13 @@
 
 #include <QObject>
 
-struct message {
-    QString timeCode;
-    QString type;
-    unsigned int pitch;
-};
+#include "CueTrack.h"
 
 class MidiReader
 {
 public:
     MidiReader();
-    QMap<QString, message> openLog(QString videoFile);
+    CueTrack openLog(QString videoFile, double fps);
     bool isReady() const;
 
 private:
@@ -0,0 +1,284 @@
+#include "MtcChase.h"
+
+#include <QDebug>
+#include <QtMath>
+
+#include "CueEngine.h"
+#include "MtcGenerator.h"
+#include "Timecode.h"
+#include "qmidiin.h"
+
+MtcChase::MtcChase(CueEngine* engine)
+{
+    m_engine = engine;
+    for (int i = 0; i < 8; i++) {
+        m_nibbles[i] = 0;
+    }
+    m_input = new QMidiIn(this);
+    // Quarter frames are MIDI time messages and full frames are SysEx, both are needed
+    m_input->setIgnoreTypes(false, false, true);
+    connect(m_input, SIGNAL(midiMessageReceived(QMidiMessage*)),
+            this, SLOT(messageReceived(QMidiMessage*)));
+    m_dropoutTimer = new QTimer(this);
+    m_dropoutTimer->setSingleShot(true);
+    connect(m_dropoutTimer, SIGNAL(timeout()),
+            this, SLOT(dropout()));
+    m_freewheelTimer = new QTimer(this);
+    m_freewheelTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_freewheelTimer, SIGNAL(timeout()),
+            this, SLOT(freewheel()));
+    moveToThread(&m_thread);
+    m_thread.start(QThread::TimeCriticalPriority);
+}
+
+MtcChase::~MtcChase()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief MtcChase::open
+ * Open the MIDI input the timecode comes in on, and let the playlist cues follow it
+ * @param portName - name of the MIDI input
+ * @return true when the input is open
+ */
+bool MtcChase::open(const QString& portName)
+{
+    bool opened = false;
+    QMetaObject::invokeMethod(this, [this, portName, &opened]() {
+        if (m_input->isPortOpen()) {
+            m_input->closePort();
+        }
+        m_input->openPort(portName);
+        opened = m_input->isPortOpen();
+    }, Qt::BlockingQueuedConnection);
+
+    if (opened) {
+        qDebug() << "Chasing MIDI timecode from" << portName;
+        m_engine->setExternalClock(true);
+    } else {
+        qWarning() << "Cannot open MIDI timecode input" << portName;
+    }
+    return opened;
+}
+
+void MtcChase::close()
+{
+    QMetaObject::invokeMethod(this, [this]() {
+        m_dropoutTimer->stop();
+        m_freewheelTimer->stop();
+        if (m_input->isPortOpen()) {
+            m_input->closePort();
+        }
+        setState(ChaseState::STOPPED);
+    }, Qt::BlockingQueuedConnection);
+    m_engine->setExternalClock(false);
+}
+
+/**
+ * @brief MtcChase::setOffset
+ * @param seconds - timecode at which the clip starts, e.g. 3600 for 01:00:00:00
+ */
+void MtcChase::setOffset(double seconds)
+{
+    QMetaObject::invokeMethod(this, [this, seconds]() {
+        m_offset = seconds;
+    }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief MtcChase::setFreewheel
+ * @param msecs - how long the clock runs on by itself when the timecode drops out, 0 to stop right away
+ */
+void MtcChase::setFreewheel(int msecs)
+{
+    QMetaObject::invokeMethod(this, [this, msecs]() {
+        m_freewheel = qMax(0, msecs);
+    }, Qt::QueuedConnection);
+}
+
+void MtcChase::messageReceived(QMidiMessage* message)
+{
+    switch (message->getStatus()) {
+    case MIDI_TIME_CODE:
+        quarterFrame(static_cast<int>(message->getValue() >> 4) & 7, static_cast<int>(message->getValue() & 0x0F));
+        break;
+    case MIDI_SYSEX:
+        fullFrame(message->_sysExData);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief MtcChase::quarterFrame
+ * Collect the pieces of the timecode. Eight pieces in a row carry the timecode of the
+ * frame the first piece was sent on; after that every piece moves the clock a quarter frame.
+ * @param piece - number of the piece, 0 to 7
+ * @param value - its nibble
+ */
+void MtcChase::quarterFrame(int piece, int value)
+{
+    m_dropoutTimer->start(qRound(4000.0 / m_fps));
+    if (piece != m_expected) {
+        // Lost a piece, or the timecode runs backwards: wait for a whole run again
+        m_received = 0;
+        m_base = -1;
+    }
+    m_expected = (piece + 1) & 7;
+    m_nibbles[piece] = value;
+    if (piece == 0) {
+        m_received = 0;
+        if (m_base >= 0) {
+            m_base += 2;
+        }
+    }
+    m_received |= 1 << piece;
+
+    if (piece == 7 && m_received == 0xFF) {
+        int rate = (m_nibbles[7] >> 1) & 3;
+        qint64 base = framesOf((m_nibbles[7] & 1) << 4 | m_nibbles[6],
+                               m_nibbles[5] << 4 | m_nibbles[4],
+                               m_nibbles[3] << 4 | m_nibbles[2],
+                               m_nibbles[1] << 4 | m_nibbles[0], rate);
+        if (base != m_base) {
+            // First run after a lock, a jump or a change of rate
+            m_fps = MtcGenerator::rateFps(rate);
+            m_base = base;
+            if (m_state == ChaseState::LOCKED) {
+                setState(ChaseState::STOPPED);
+                m_position = -1.0;
+            }
+        }
+    }
+    if (m_base >= 0) {
+        sample((m_base + piece / 4.0) / m_fps);
+    }
+}
+
+/**
+ * @brief MtcChase::fullFrame
+ * A full frame message tells where the clock was located, quarter frames follow when it runs
+ * @param data - the SysEx message
+ */
+void MtcChase::fullFrame(const std::vector<unsigned char>& data)
+{
+    if (data.size() < 10 || data[1] != 0x7F || data[3] != 0x01 || data[4] != 0x01) {
+        return;
+    }
+    int rate = (data[5] >> 5) & 3;
+    m_fps = MtcGenerator::rateFps(rate);
+    qint64 frames = framesOf(data[5] & 0x1F, data[6], data[7], data[8], rate);
+    m_dropoutTimer->stop();
+    m_freewheelTimer->stop();
+    m_base = -1;
+    m_received = 0;
+    m_clock.reset();
+    setState(ChaseState::STOPPED);
+    double time = frames / m_fps - m_offset;
+    if (time != m_position) {
+        report(time, true);
+        emit located(time);
+    }
+}
+
+/**
+ * @brief MtcChase::sample
+ * Follow one position of the timecode
+ * @param time - timecode in seconds
+ */
+void MtcChase::sample(double time)
+{
+    double clip = time - m_offset;
+    qint64 now = m_clock.now();
+    if (m_state != ChaseState::LOCKED) {
+        // Carry on where the clock got to, anywhere else the cues are located again
+        double expected = (m_state == ChaseState::FREEWHEEL) ? m_clock.timeAt(now) : m_position;
+        bool carryOn = m_position >= 0.0 && qAbs(expected - clip) <= 2.0 / m_fps;
+        m_freewheelTimer->stop();
+        setState(ChaseState::LOCKED);
+        if (!carryOn) {
+            m_clock.reset();
+            m_clock.update(clip);
+            report(clip, true);
+            emit located(clip);
+            return;
+        }
+    }
+    m_clock.update(clip);
+    // Once a frame is enough, the cue scheduler times the cues in between
+    if (m_expected == 1 || m_expected == 5) {
+        report(m_clock.isRunning() ? m_clock.timeAt(now) : clip, false);
+    }
+}
+
+void MtcChase::report(double time, bool locate)
+{
+    m_position = time;
+    m_engine->externalTime(time, locate);
+}
+
+/**
+ * @brief MtcChase::dropout
+ * No timecode for four frames: freewheel on the clock, or stop
+ */
+void MtcChase::dropout()
+{
+    m_base = -1;
+    m_received = 0;
+    m_expected = 0;
+    if (m_state != ChaseState::LOCKED) {
+        return;
+    }
+    if (m_freewheel > 0 && m_clock.isRunning()) {
+        setState(ChaseState::FREEWHEEL);
+        m_freewheelStart = m_clock.now();
+        m_freewheelTimer->start(qMax(1, qRound(1000.0 / m_fps)));
+    } else {
+        setState(ChaseState::STOPPED);
+    }
+}
+
+void MtcChase::freewheel()
+{
+    qint64 now = m_clock.now();
+    if (now - m_freewheelStart > m_freewheel * 1000000LL) {
+        m_freewheelTimer->stop();
+        m_position = m_clock.timeAt(now);
+        setState(ChaseState::STOPPED);
+        return;
+    }
+    report(m_clock.timeAt(now), false);
+}
+
+void MtcChase::setState(ChaseState state)
+{
+    if (m_state != state) {
+        m_state = state;
+        switch (state) {
+        case ChaseState::STOPPED:
+            qDebug() << "MIDI timecode stopped at" << m_position;
+            break;
+        case ChaseState::LOCKED:
+            qDebug() << "MIDI timecode locked";
+            break;
+        case ChaseState::FREEWHEEL:
+            qDebug() << "MIDI timecode dropped out, freewheeling";
+            break;
+        }
+    }
+}
+
+/**
+ * @brief MtcChase::framesOf
+ * @return the real frame count of a timecode label at an MTC rate
+ */
+qint64 MtcChase::framesOf(int hours, int minutes, int seconds, int frames, int rate)
+{
+    double fps = MtcGenerator::rateFps(rate);
+    int label = ((hours * 60 + minutes) * 60 + seconds) * qRound(fps) + frames;
+    return Timecode::realFramesFromLabel(label, fps);
+}
@@ -0,0 +1,77 @@
+#ifndef MTCCHASE_H
+#define MTCCHASE_H
+
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+
+#include <vector>
+
+#include "PlayheadClock.h"
+
+class CueEngine;
+class QMidiIn;
+class QMidiMessage;
+
+enum class ChaseState
+{
+    STOPPED,
+    LOCKED,
+    FREEWHEEL
+};
+
+/**
+ * @brief The MtcChase class
+ * Lets the playlist cues follow MIDI timecode from an external clock, an audio
+ * workstation or a lighting console. The quarter frames are read on a thread of their
+ * own and smoothed by a PlayheadClock, so jitter on the MIDI input does not reach the
+ * cues. When the timecode drops out the clock freewheels for a while and then stops.
+ * Timecode that comes back close to where the clock got to carries on; timecode that
+ * comes back anywhere else relocates the cues without firing the ones that were passed.
+ */
+class MtcChase : public QObject
+{
+    Q_OBJECT
+
+public:
+    MtcChase(CueEngine* engine);
+    ~MtcChase();
+    bool open(const QString& portName);
+    void close();
+    void setOffset(double seconds);
+    void setFreewheel(int msecs);
+
+signals:
+    void located(double time);
+
+private slots:
+    void messageReceived(QMidiMessage* message);
+    void dropout();
+    void freewheel();
+
+private:
+    QThread m_thread;
+    QMidiIn* m_input;
+    CueEngine* m_engine;
+    QTimer* m_dropoutTimer;
+    QTimer* m_freewheelTimer;
+    PlayheadClock m_clock;
+    ChaseState m_state = ChaseState::STOPPED;
+    double m_offset = 0.0;
+    int m_freewheel = 1000;
+    qint64 m_freewheelStart = 0;
+    int m_nibbles[8];
+    int m_received = 0;
+    int m_expected = 0;
+    double m_fps = 25.0;
+    qint64 m_base = -1;
+    double m_position = -1.0;
+    void quarterFrame(int piece, int value);
+    void fullFrame(const std::vector<unsigned char>& data);
+    void sample(double time);
+    void report(double time, bool locate);
+    void setState(ChaseState state);
+    qint64 framesOf(int hours, int minutes, int seconds, int frames, int rate);
+};
+
+#endif // MTCCHASE_H
@@ -0,0 +1,290 @@
+#include "MtcGenerator.h"
+
+#include <QDebug>
+#include <QtMath>
+
+#include "Timecode.h"
+#include "qmidiout.h"
+
+MtcGenerator::MtcGenerator()
+{
+    m_quarterFrame.reserve(2);
+    m_fullFrame.reserve(10);
+    m_output = new QMidiOut(this);
+    m_timer = new QTimer(this);
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, SIGNAL(timeout()),
+            this, SLOT(tick()));
+    moveToThread(&m_thread);
+    m_thread.start(QThread::TimeCriticalPriority);
+}
+
+MtcGenerator::~MtcGenerator()
+{
+    close();
+    m_thread.quit();
+    m_thread.wait();
+}
+
+/**
+ * @brief MtcGenerator::open
+ * Open the MIDI output the timecode is sent to
+ * @param portName - name of the output, "virtual" creates a virtual port "CuteCaspar MTC"
+ * @return true when the output is open
+ */
+bool MtcGenerator::open(const QString& portName)
+{
+    bool opened = false;
+    QMetaObject::invokeMethod(this, [this, portName, &opened]() {
+        if (m_output->isPortOpen()) {
+            m_output->closePort();
+        }
+        if (portName == "virtual") {
+            m_output->openVirtualPort("CuteCaspar MTC");
+        } else {
+            int index = m_output->getPorts().indexOf(portName);
+            if (index >= 0) {
+                m_output->openPort(static_cast<unsigned int>(index));
+            }
+        }
+        opened = m_output->isPortOpen();
+    }, Qt::BlockingQueuedConnection);
+
+    QMutexLocker locker(&m_mutex);
+    m_open = opened;
+    m_relocate = true;
+    if (opened) {
+        qDebug() << "Sending MIDI timecode to" << portName;
+    } else {
+        qWarning() << "Cannot open MIDI timecode output" << portName;
+    }
+    return opened;
+}
+
+void MtcGenerator::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_open = false;
+    }
+    QMetaObject::invokeMethod(this, [this]() {
+        m_timer->stop();
+        if (m_output->isPortOpen()) {
+            m_output->closePort();
+        }
+    }, Qt::BlockingQueuedConnection);
+}
+
+bool MtcGenerator::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_open;
+}
+
+/**
+ * @brief MtcGenerator::follow
+ * Choose the video layer the timecode follows
+ * @param videoLayer - the video layer, 0 to stop sending timecode
+ * @param fps - frame rate of the clip on the layer
+ */
+void MtcGenerator::follow(int videoLayer, double fps)
+{
+    if (fps < 1.0) {
+        fps = 25.0;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (m_videoLayer != videoLayer || m_fps != fps) {
+        m_videoLayer = videoLayer;
+        m_fps = fps;
+        m_clock.reset();
+        m_relocate = true;
+    }
+}
+
+/**
+ * @brief MtcGenerator::timecode
+ * Follow the time reports of the video layers, the sending thread is woken up when it was idle
+ * @param videoLayer - video layer of the report
+ * @param time - playhead position of the video layer in seconds
+ */
+void MtcGenerator::timecode(int videoLayer, double time)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_open || videoLayer != m_videoLayer) {
+            return;
+        }
+        m_clock.update(time);
+    }
+    if (m_ticking.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "tick", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief MtcGenerator::relocate
+ * Send a full frame message before the next quarter frame, after a seek or a change of clip
+ */
+void MtcGenerator::relocate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_relocate = true;
+}
+
+mtcStatistics MtcGenerator::getStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_statistics;
+}
+
+/**
+ * @brief MtcGenerator::mtcFps
+ * @param fps - frame rate of a clip
+ * @return the frame rate the clip is counted at in MTC
+ */
+double MtcGenerator::mtcFps(double fps)
+{
+    return fps > 30.5 ? fps / 2.0 : fps;
+}
+
+/**
+ * @brief MtcGenerator::rateCode
+ * @param fps - frame rate of a clip
+ * @return the MTC rate code: 0 = 24, 1 = 25, 2 = 29.97 drop-frame, 3 = 30 fps
+ */
+int MtcGenerator::rateCode(double fps)
+{
+    fps = mtcFps(fps);
+    if (Timecode::isDropFrame(fps)) {
+        return 2;
+    }
+    switch (qRound(fps)) {
+    case 24:
+        return 0;
+    case 25:
+        return 1;
+    default:
+        return 3;
+    }
+}
+
+double MtcGenerator::rateFps(int code)
+{
+    static const double rates[4] = {24.0, 25.0, 29.97, 30.0};
+    return rates[code & 3];
+}
+
+/**
+ * @brief MtcGenerator::tick
+ * Send the quarter frames the playhead has reached and sleep until the next one is due.
+ * A playhead that jumped is relocated with a full frame, one that stopped gets a full
+ * frame of the position it stopped at (sending thread).
+ */
+void MtcGenerator::tick()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_open || m_videoLayer == 0 || !m_clock.isRunning()) {
+        if (m_open && m_sent >= 0) {
+            sendFullFrame(static_cast<int>(m_sent / 4));
+        }
+        m_sent = -1;
+        m_ticking.storeRelease(0);
+        return;
+    }
+
+    double quarterRate = mtcFps(m_fps) * 4.0;
+    qint64 now = m_clock.now();
+    qint64 quarter = static_cast<qint64>(qFloor(m_clock.timeAt(now) * quarterRate));
+    if (quarter < 0) {
+        quarter = 0;
+    }
+    if (m_relocate || m_sent < 0 || quarter < m_sent || quarter - m_sent > 8) {
+        // Quarter frames resume with the next one, receivers lock again within two frames
+        sendFullFrame(static_cast<int>(quarter / 4));
+        m_sent = quarter;
+        m_relocate = false;
+    } else if (quarter > m_sent) {
+        // A late wake up catches up on the quarter frames it missed
+        qint64 jitter = now - m_clock.nsecsAt((m_sent + 1) / quarterRate);
+        while (m_sent < quarter) {
+            sendQuarterFrame(++m_sent);
+        }
+        m_jitterSum += qAbs(jitter);
+        m_jitterCount++;
+        m_statistics.meanJitter = m_jitterSum / static_cast<qint64>(m_jitterCount);
+        m_statistics.maxJitter = qMax(m_statistics.maxJitter, qAbs(jitter));
+    }
+
+    qint64 wait = m_clock.nsecsAt((m_sent + 1) / quarterRate) - m_clock.now();
+    m_timer->start(static_cast<int>(qMax<qint64>(0, (wait + 999999) / 1000000)));
+}
+
+/**
+ * @brief MtcGenerator::splitLabel
+ * @param frames - real frame count at the MTC rate
+ * @param hours, minutes, seconds, frame - receive the timecode label
+ */
+void MtcGenerator::splitLabel(int frames, int& hours, int& minutes, int& seconds, int& frame) const
+{
+    double fps = mtcFps(m_fps);
+    int nominal = qRound(fps);
+    int label = Timecode::labelFromRealFrames(frames, fps);
+    frame = label % nominal;
+    seconds = (label / nominal) % 60;
+    minutes = (label / nominal / 60) % 60;
+    hours = (label / nominal / 3600) % 24;
+}
+
+/**
+ * @brief MtcGenerator::sendQuarterFrame
+ * Send one piece of the timecode. A run of eight pieces, starting on an even frame,
+ * carries the timecode of that frame.
+ * @param quarter - quarter frames since the start of the clip
+ */
+void MtcGenerator::sendQuarterFrame(qint64 quarter)
+{
+    int piece = static_cast<int>(quarter & 7);
+    int hours, minutes, seconds, frame;
+    splitLabel(static_cast<int>(quarter >> 3) * 2, hours, minutes, seconds, frame);
+    int value = 0;
+    switch (piece) {
+    case 0: value = frame & 0x0F; break;
+    case 1: value = frame >> 4; break;
+    case 2: value = seconds & 0x0F; break;
+    case 3: value = seconds >> 4; break;
+    case 4: value = minutes & 0x0F; break;
+    case 5: value = minutes >> 4; break;
+    case 6: value = hours & 0x0F; break;
+    case 7: value = (hours >> 4) | (rateCode(m_fps) << 1); break;
+    }
+    m_quarterFrame.clear();
+    m_quarterFrame.push_back(MIDI_TIME_CODE);
+    m_quarterFrame.push_back(static_cast<unsigned char>((piece << 4) | value));
+    m_output->sendRawMessage(m_quarterFrame);
+    m_statistics.quarterFrames++;
+}
+
+/**
+ * @brief MtcGenerator::sendFullFrame
+ * Send the complete timecode of a frame at once
+ * @param frames - real frame count at the MTC rate
+ */
+void MtcGenerator::sendFullFrame(int frames)
+{
+    int hours, minutes, seconds, frame;
+    splitLabel(frames, hours, minutes, seconds, frame);
+    m_fullFrame.clear();
+    m_fullFrame.push_back(MIDI_SYSEX);
+    m_fullFrame.push_back(0x7F);
+    m_fullFrame.push_back(0x7F);
+    m_fullFrame.push_back(0x01);
+    m_fullFrame.push_back(0x01);
+    m_fullFrame.push_back(static_cast<unsigned char>((rateCode(m_fps) << 5) | hours));
+    m_fullFrame.push_back(static_cast<unsigned char>(minutes));
+    m_fullFrame.push_back(static_cast<unsigned char>(seconds));
+    m_fullFrame.push_back(static_cast<unsigned char>(frame));
+    m_fullFrame.push_back(MIDI_SYSEX_END);
+    m_output->sendRawMessage(m_fullFrame);
+    m_statistics.fullFrames++;
+}
@@ -0,0 +1,78 @@
+#ifndef MTCGENERATOR_H
+#define MTCGENERATOR_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QTimer>
+
+#include <vector>
+
+#include "PlayheadClock.h"
+
+class QMidiOut;
+
+struct mtcStatistics {
+    quint64 quarterFrames = 0;
+    quint64 fullFrames = 0;
+    qint64 meanJitter = 0;
+    qint64 maxJitter = 0;
+};
+
+/**
+ * @brief The MtcGenerator class
+ * Sends MIDI Timecode on a MIDI output of its own, such that lighting desks can follow
+ * the video. The timecode follows the smoothed playhead of one video layer. A thread of
+ * its own sends every quarter frame at the instant the playhead reaches it and keeps
+ * track of how far off that instant it was (jitter). A full frame message relocates the
+ * receiver whenever the playhead jumps (clip change, seek, insert) and when it stops.
+ * MTC knows 24, 25, 29.97 drop-frame and 30 fps; faster clips are counted at half rate.
+ */
+class MtcGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    MtcGenerator();
+    ~MtcGenerator();
+    bool open(const QString& portName);
+    void close();
+    bool isOpen() const;
+
+    // Can be called from any thread
+    void follow(int videoLayer, double fps);
+    void timecode(int videoLayer, double time);
+    void relocate();
+    mtcStatistics getStatistics() const;
+
+    static double mtcFps(double fps);
+    static int rateCode(double fps);
+    static double rateFps(int code);
+
+private slots:
+    void tick();
+
+private:
+    QThread m_thread;
+    QTimer* m_timer;
+    QMidiOut* m_output;
+    bool m_open = false;
+    mutable QMutex m_mutex;
+    PlayheadClock m_clock;
+    int m_videoLayer = 0;
+    double m_fps = 25.0;
+    bool m_relocate = true;
+    QAtomicInt m_ticking;
+    qint64 m_sent = -1;
+    qint64 m_jitterSum = 0;
+    quint64 m_jitterCount = 0;
+    mtcStatistics m_statistics;
+    std::vector<unsigned char> m_quarterFrame;
+    std::vector<unsigned char> m_fullFrame;
+    void splitLabel(int frames, int& hours, int& minutes, int& seconds, int& frame) const;
+    void sendQuarterFrame(qint64 quarter);
+    void sendFullFrame(int frames);
+};
+
+#endif // MTCGENERATOR_H
@@ -0,0 +1,197 @@
+#include "OscRouter.h"
+
+#include <QDebug>
+
+#include <cstring>
+
+// FNV-1a, to compare a segment with the interned ones without comparing their text
+static const quint32 FNV_OFFSET = 2166136261u;
+static const quint32 FNV_PRIME = 16777619u;
+
+// Numbers in an address are indexes (channel, layer, port), nine digits cannot overflow
+static const int MAX_DIGITS = 9;
+
+OscRouter::OscRouter()
+{
+    m_nodes.append(oscNode());
+}
+
+/**
+ * @brief OscRouter::add
+ * Register the handler of an address, a handler registered before for it is replaced
+ * @param pattern - the address, starting with "/"; a "#" segment matches a number
+ * @param handler - receives the numbers of the "#" segments, in order, and the message
+ * @return false when the pattern cannot be routed
+ */
+bool OscRouter::add(const char* pattern, Handler handler)
+{
+    if (pattern == nullptr || pattern[0] != '/') {
+        qWarning() << "OSC route must start with /" << pattern;
+        return false;
+    }
+    int node = 0;
+    int numbers = 0;
+    const char* p = pattern;
+    while (*p == '/') {
+        const char* segment = ++p;
+        while (*p != '\0' && *p != '/') {
+            p++;
+        }
+        int length = static_cast<int>(p - segment);
+        if (length == 0) {
+            qWarning() << "OSC route has an empty segment" << pattern;
+            return false;
+        }
+        if (length == 1 && segment[0] == '#') {
+            if (++numbers > MAX_NUMBERS) {
+                qWarning() << "OSC route has more than" << MAX_NUMBERS << "numbers" << pattern;
+                return false;
+            }
+            if (m_nodes[node].number < 0) {
+                m_nodes.append(oscNode());
+                m_nodes[node].number = m_nodes.size() - 1;
+            }
+            node = m_nodes[node].number;
+            continue;
+        }
+        quint32 hash = hashOf(segment, length);
+        int next = child(node, segment, length, hash);
+        if (next < 0) {
+            oscNode it;
+            it.nextSibling = m_nodes[node].firstChild;
+            it.text = m_segments.size();
+            it.length = length;
+            it.hash = hash;
+            m_segments.append(segment, length);
+            m_nodes.append(it);
+            next = m_nodes.size() - 1;
+            m_nodes[node].firstChild = next;
+        }
+        node = next;
+    }
+
+    if (m_nodes[node].handler < 0) {
+        m_nodes[node].handler = m_handlers.size();
+        m_handlers.append(handler);
+    } else {
+        m_handlers[m_nodes[node].handler] = handler;
+    }
+    return true;
+}
+
+/**
+ * @brief OscRouter::dispatch
+ * Call the handler of the address of a message
+ * @param message - the message
+ * @return false when no handler was registered for its address
+ */
+bool OscRouter::dispatch(const osc::ReceivedMessage& message) const
+{
+    int numbers[MAX_NUMBERS];
+    int handler = match(0, message.AddressPattern(), numbers, 0);
+    if (handler < 0) {
+        return false;
+    }
+    m_handlers[handler](numbers, message);
+    return true;
+}
+
+/**
+ * @brief OscRouter::number
+ * An argument of a message as a number, whatever numeric type it was sent as
+ * @param message - the message
+ * @param index - argument index, from 0
+ * @return the value, 0 when the argument is missing or not a number
+ */
+double OscRouter::number(const osc::ReceivedMessage& message, int index)
+{
+    osc::ReceivedMessage::const_iterator arg = message.ArgumentsBegin();
+    for (int i = 0; i < index && arg != message.ArgumentsEnd(); i++) {
+        ++arg;
+    }
+    if (arg == message.ArgumentsEnd()) {
+        return 0.0;
+    }
+    if (arg->IsFloat()) {
+        return static_cast<double>(arg->AsFloat());
+    } else if (arg->IsDouble()) {
+        return arg->AsDouble();
+    } else if (arg->IsInt32()) {
+        return arg->AsInt32();
+    } else if (arg->IsInt64()) {
+        return static_cast<double>(arg->AsInt64());
+    }
+    return 0.0;
+}
+
+/**
+ * @brief OscRouter::match
+ * Follow the rest of an address down the trie. A literal segment is tried before a number,
+ * the number when the literal leads nowhere.
+ * @param node - node the address has reached
+ * @param address - the rest of the address, at the "/" of the next segment
+ * @param numbers - receives the numbers of the path
+ * @param count - numbers on the path so far
+ * @return index of the handler, -1 when there is none
+ */
+int OscRouter::match(int node, const char* address, int* numbers, int count) const
+{
+    const oscNode& it = m_nodes[node];
+    if (*address == '\0') {
+        return it.handler;
+    }
+    if (*address != '/') {
+        return -1;
+    }
+    const char* segment = ++address;
+    quint32 hash = FNV_OFFSET;
+    bool digits = true;
+    while (*address != '\0' && *address != '/') {
+        hash = (hash ^ static_cast<uchar>(*address)) * FNV_PRIME;
+        digits = digits && *address >= '0' && *address <= '9';
+        address++;
+    }
+    int length = static_cast<int>(address - segment);
+
+    int next = child(node, segment, length, hash);
+    if (next >= 0) {
+        int handler = match(next, address, numbers, count);
+        if (handler >= 0) {
+            return handler;
+        }
+    }
+    if (it.number < 0 || !digits || length == 0 || length > MAX_DIGITS || count == MAX_NUMBERS) {
+        return -1;
+    }
+    int value = 0;
+    for (int i = 0; i < length; i++) {
+        value = value * 10 + (segment[i] - '0');
+    }
+    numbers[count] = value;
+    return match(it.number, address, numbers, count + 1);
+}
+
+/**
+ * @brief OscRouter::child
+ * @return the literal child of a node for a segment, -1 when there is none
+ */
+int OscRouter::child(int node, const char* segment, int length, quint32 hash) const
+{
+    for (int next = m_nodes[node].firstChild; next >= 0; next = m_nodes[next].nextSibling) {
+        const oscNode& it = m_nodes[next];
+        if (it.hash == hash && it.length == length
+                && memcmp(m_segments.constData() + it.text, segment, static_cast<size_t>(length)) == 0) {
+            return next;
+        }
+    }
+    return -1;
+}
+
+quint32 OscRouter::hashOf(const char* segment, int length)
+{
+    quint32 hash = FNV_OFFSET;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<uchar>(segment[i])) * FNV_PRIME;
+    }
+    return hash;
+}
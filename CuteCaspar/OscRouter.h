@@ -0,0 +1,49 @@
+#ifndef OSCROUTER_H
+#define OSCROUTER_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include <functional>
+
+#include <osc/OscReceivedElements.h>
+
+/**
+ * @brief The OscRouter class
+ * Hands OSC messages to the handler of their address. The addresses are registered once,
+ * e.g. "/channel/#/stage/layer/#/file/time", and their segments are interned into a trie;
+ * a "#" segment matches a number, which is passed to the handler. A message is routed by
+ * walking its address pattern in place, segment by segment, so routing does not allocate.
+ * A literal segment takes precedence over a number.
+ */
+class OscRouter
+{
+public:
+    static const int MAX_NUMBERS = 4;
+    typedef std::function<void(const int* numbers, const osc::ReceivedMessage& message)> Handler;
+
+    OscRouter();
+    bool add(const char* pattern, Handler handler);
+    bool dispatch(const osc::ReceivedMessage& message) const;
+    int count() const { return m_handlers.size(); }
+    static double number(const osc::ReceivedMessage& message, int index);
+
+private:
+    struct oscNode {
+        int firstChild = -1;
+        int nextSibling = -1;
+        int number = -1;
+        int handler = -1;
+        int text = 0;
+        int length = 0;
+        quint32 hash = 0;
+    };
+    QVector<oscNode> m_nodes;
+    QByteArray m_segments;
+    QVector<Handler> m_handlers;
+    int match(int node, const char* address, int* numbers, int count) const;
+    int child(int node, const char* segment, int length, quint32 hash) const;
+    static quint32 hashOf(const char* segment, int length);
+};
+
+#endif // OSCROUTER_H
@@ -0,0 +1,126 @@
+#include "OscSender.h"
+
+#include <chrono>
+
+// Addresses per cue layer: playlist, soundscape
+static const char* NOTE_ADDRESSES[] = {"/cue/playlist/note", "/cue/soundscape/note"};
+static const char* ACTION_ADDRESSES[] = {"/cue/playlist/action", "/cue/soundscape/action"};
+static const char* DMX_ADDRESSES[] = {"/cue/playlist/dmx", "/cue/soundscape/dmx"};
+
+// Room for the largest message: size slot, address, type tags and four arguments
+static const std::size_t MESSAGE_SIZE = 64;
+
+// Seconds from the NTP epoch (1900) to the Unix epoch (1970)
+static const quint64 NTP_UNIX_OFFSET = 2208988800ULL;
+
+OscSender::OscSender(const QList<oscTarget>& targets)
+    : m_targets(targets),
+      m_stream(m_buffer, BUFFER_SIZE)
+{
+}
+
+/**
+ * @brief OscSender::timeTag
+ * @param delay - nanoseconds from now
+ * @return NTP time: seconds since 1900 in the high word, the fraction of a second in the low word
+ */
+quint64 OscSender::timeTag(qint64 delay)
+{
+    qint64 nsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count() + qMax<qint64>(0, delay);
+    quint64 seconds = static_cast<quint64>(nsecs / 1000000000) + NTP_UNIX_OFFSET;
+    quint64 fraction = (static_cast<quint64>(nsecs % 1000000000) << 32) / 1000000000;
+    return seconds << 32 | fraction;
+}
+
+/**
+ * @brief OscSender::begin
+ * Start the bundle of a frame
+ * @param delay - nanoseconds until the cues are to take effect, a cue that is late takes effect at once
+ */
+void OscSender::begin(qint64 delay)
+{
+    m_timeTag = timeTag(delay);
+    m_messages = 0;
+    m_stream.Clear();
+    m_stream << osc::BeginBundle(m_timeTag);
+}
+
+/**
+ * @brief OscSender::note
+ * @param layer - cue layer, 0 for the playlist, 1 for the soundscape
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param noteOn - note on or note off
+ * @param velocity - MIDI velocity
+ * @param channel - MIDI channel
+ */
+void OscSender::note(int layer, unsigned int pitch, bool noteOn, unsigned int velocity, unsigned int channel)
+{
+    reserve();
+    if (pitch < 128) {
+        m_stream << osc::BeginMessage(NOTE_ADDRESSES[layer & 1])
+                 << static_cast<osc::int32>(channel)
+                 << static_cast<osc::int32>(pitch)
+                 << static_cast<osc::int32>(noteOn ? velocity : 0)
+                 << osc::EndMessage;
+    } else {
+        m_stream << osc::BeginMessage(ACTION_ADDRESSES[layer & 1])
+                 << static_cast<osc::int32>(pitch)
+                 << noteOn
+                 << osc::EndMessage;
+    }
+    m_messages++;
+}
+
+/**
+ * @brief OscSender::dmx
+ * @param layer - cue layer, 0 for the playlist, 1 for the soundscape
+ * @param address - DMX channel from 0 over all universes
+ * @param value - level 0 to 255
+ */
+void OscSender::dmx(int layer, unsigned int address, unsigned int value)
+{
+    reserve();
+    m_stream << osc::BeginMessage(DMX_ADDRESSES[layer & 1])
+             << static_cast<osc::int32>(address)
+             << static_cast<osc::int32>(value)
+             << osc::EndMessage;
+    m_messages++;
+}
+
+/**
+ * @brief OscSender::send
+ * Close the bundle and send it to every target, an empty bundle is not sent
+ */
+void OscSender::send()
+{
+    if (m_messages == 0) {
+        m_stream.Clear();
+        return;
+    }
+    m_stream << osc::EndBundle;
+    for (const oscTarget& target : m_targets) {
+        if (m_socket.writeDatagram(m_stream.Data(), static_cast<qint64>(m_stream.Size()), target.address, target.port) < 0) {
+            m_statistics.errors++;
+        } else {
+            m_statistics.packets++;
+        }
+    }
+    m_statistics.bundles++;
+    m_messages = 0;
+    m_stream.Clear();
+}
+
+/**
+ * @brief OscSender::reserve
+ * Send the bundle so far and start another one with the same timetag when the next
+ * message might not fit
+ */
+void OscSender::reserve()
+{
+    if (m_stream.Capacity() - m_stream.Size() >= MESSAGE_SIZE) {
+        return;
+    }
+    send();
+    m_stream << osc::BeginBundle(m_timeTag);
+}
@@ -0,0 +1,61 @@
+#ifndef OSCSENDER_H
+#define OSCSENDER_H
+
+#include <QHostAddress>
+#include <QList>
+#include <QString>
+#include <QUdpSocket>
+
+#include <osc/OscOutboundPacketStream.h>
+
+struct oscTarget {
+    QString name;
+    QHostAddress address;
+    quint16 port = 0;
+};
+
+struct oscStatistics {
+    quint64 bundles = 0;
+    quint64 packets = 0;
+    quint64 errors = 0;
+};
+
+/**
+ * @brief The OscSender class
+ * Sends the cues of a frame as one OSC bundle to every target, for media servers and sound
+ * desks that act on OSC. The bundle carries an NTP timetag of the instant the frame is
+ * shown, so a receiver that honours timetags fires the cues on time however the network
+ * delays them. Messages:
+ *   /cue/<layer>/note channel pitch velocity (velocity 0 is note off)
+ *   /cue/<layer>/action action on
+ *   /cue/<layer>/dmx channel level
+ * with <layer> playlist or soundscape. The bundle is written into a fixed buffer, the
+ * same bytes go to every target; a frame that does not fit is split over several bundles
+ * with the same timetag. Belongs to the thread of the cue engine.
+ */
+class OscSender
+{
+public:
+    // Stay within one Ethernet frame
+    static const int BUFFER_SIZE = 1472;
+
+    explicit OscSender(const QList<oscTarget>& targets);
+    void begin(qint64 delay);
+    void note(int layer, unsigned int pitch, bool noteOn, unsigned int velocity, unsigned int channel);
+    void dmx(int layer, unsigned int address, unsigned int value);
+    void send();
+    oscStatistics getStatistics() const { return m_statistics; }
+    static quint64 timeTag(qint64 delay);
+
+private:
+    QUdpSocket m_socket;
+    QList<oscTarget> m_targets;
+    char m_buffer[BUFFER_SIZE];
+    osc::OutboundPacketStream m_stream;
+    quint64 m_timeTag = 0;
+    int m_messages = 0;
+    oscStatistics m_statistics;
+    void reserve();
+};
+
+#endif // OSCSENDER_H
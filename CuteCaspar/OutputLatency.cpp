@@ -0,0 +1,137 @@
+#include "OutputLatency.h"
+
+#include <QDebug>
+#include <QSettings>
+#include <QTimer>
+
+#include "RaspberryPI.h"
+
+OutputLatency* OutputLatency::s_inst = nullptr;
+
+OutputLatency::OutputLatency()
+{
+    QSettings settings("VRT", "CasparCGClient");
+    settings.beginGroup("Configuration");
+    for (CueOutput output : {CueOutput::MIDI, CueOutput::UDP, CueOutput::MQTT, CueOutput::DMX, CueOutput::OSC}) {
+        m_latency[static_cast<int>(output)].storeRelaxed(qMax(0, settings.value(settingName(output), 0).toInt()));
+    }
+    m_autoMeasure = settings.value("latency_auto", false).toBool();
+    settings.endGroup();
+}
+
+OutputLatency* OutputLatency::getInstance()
+{
+    if (!s_inst) {
+        s_inst = new OutputLatency();
+    }
+    return s_inst;
+}
+
+QString OutputLatency::settingName(CueOutput output)
+{
+    switch (output) {
+    case CueOutput::MIDI:
+        return "latency_midi";
+    case CueOutput::UDP:
+        return "latency_udp";
+    case CueOutput::MQTT:
+        return "latency_mqtt";
+    case CueOutput::DMX:
+        return "latency_dmx";
+    case CueOutput::OSC:
+        return "latency_osc";
+    }
+    return QString();
+}
+
+int OutputLatency::getLatency(CueOutput output) const
+{
+    return m_latency[static_cast<int>(output)].loadRelaxed();
+}
+
+/**
+ * @brief OutputLatency::setLatency
+ * Change and store the latency of an output
+ * @param output - the output
+ * @param msecs - latency in milliseconds
+ */
+void OutputLatency::setLatency(CueOutput output, int msecs)
+{
+    msecs = qMax(0, msecs);
+    if (getLatency(output) != msecs) {
+        m_latency[static_cast<int>(output)].storeRelaxed(msecs);
+
+        QSettings settings("VRT", "CasparCGClient");
+        settings.beginGroup("Configuration");
+        settings.setValue(settingName(output), msecs);
+        settings.endGroup();
+
+        qDebug() << QString("Latency of %1 set to %2 ms").arg(settingName(output)).arg(msecs);
+        emit latencyChanged();
+    }
+}
+
+/**
+ * @brief OutputLatency::getLead
+ * @return how far ahead of the video cues have to be handed out, in milliseconds
+ */
+int OutputLatency::getLead() const
+{
+    return qMax(qMax(qMax(getLatency(CueOutput::MIDI), getLatency(CueOutput::DMX)),
+                     qMax(getLatency(CueOutput::UDP), getLatency(CueOutput::MQTT))),
+                getLatency(CueOutput::OSC));
+}
+
+/**
+ * @brief OutputLatency::getDelay
+ * @param output - the output
+ * @return how long a cue handed out at the lead has to wait before it is sent to the output
+ */
+int OutputLatency::getDelay(CueOutput output) const
+{
+    return getLead() - getLatency(output);
+}
+
+bool OutputLatency::isAutoMeasure() const
+{
+    return m_autoMeasure;
+}
+
+/**
+ * @brief OutputLatency::deliver
+ * Send to an output after its delay, immediately when the output is the slowest one.
+ * For the Raspberry PI links, in the GUI thread; the cue engine delays its MIDI batches
+ * itself, without allocating a timer per batch.
+ * @param output - the output
+ * @param action - sends the message to the output
+ */
+void OutputLatency::deliver(CueOutput output, std::function<void()> action)
+{
+    int delay = getDelay(output);
+    if (delay > 0) {
+        QTimer::singleShot(delay, Qt::PreciseTimer, action);
+    } else {
+        action();
+    }
+}
+
+/**
+ * @brief OutputLatency::measure
+ * Measure the latencies of the Raspberry PI links and store them. MIDI latency depends
+ * on the interface and cannot be measured, it keeps its configured value.
+ */
+void OutputLatency::measure()
+{
+    int udp = RaspberryPI::getInstance()->measureUdpLatency();
+    if (udp >= 0) {
+        setLatency(CueOutput::UDP, udp);
+    } else {
+        qDebug() << "UDP latency could not be measured";
+    }
+    int mqtt = RaspberryPI::getInstance()->measureMqttLatency();
+    if (mqtt >= 0) {
+        setLatency(CueOutput::MQTT, mqtt);
+    } else {
+        qDebug() << "MQTT latency could not be measured";
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef OUTPUTLATENCY_H
+#define OUTPUTLATENCY_H
+
+#include <QAtomicInt>
+#include <QObject>
+
+#include <functional>
+
+enum class CueOutput
+{
+    MIDI,
+    UDP,
+    MQTT,
+    DMX,
+    OSC
+};
+
+/**
+ * @brief The OutputLatency class
+ * Latency of every output a cue can be sent to, in milliseconds. Cues are handed out
+ * ahead of the video by the largest latency (the lead); every output then waits for
+ * the difference with its own latency, so all outputs land on the same frame.
+ */
+class OutputLatency : public QObject
+{
+
+    Q_OBJECT
+
+public:
+    OutputLatency();
+    static OutputLatency *getInstance();
+    int getLatency(CueOutput output) const;
+    void setLatency(CueOutput output, int msecs);
+    int getLead() const;
+    int getDelay(CueOutput output) const;
+    bool isAutoMeasure() const;
+    void deliver(CueOutput output, std::function<void()> action);
+    void measure();
+
+signals:
+    void latencyChanged();
+
+private:
+    static OutputLatency* s_inst;
+    QAtomicInt m_latency[5];
+    bool m_autoMeasure = false;
+    static QString settingName(CueOutput output);
+};
+
+#endif // OUTPUTLATENCY_H
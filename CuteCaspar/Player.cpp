@@ -3,8 +3,11 @@
 #include <QSqlQuery>
 #include <QtSql>
 #include <QPushButton>
+#include <QSettings>
+#include <QtConcurrent>
 
-#include "MidiConnection.h"
+#include "CueCache.h"
+#include "CueFile.h"
 #include "RaspberryPI.h"
 #include "DatabaseManager.h"
 #include "Timecode.h"
@@ -17,7 +20,117 @@ Player::Player()
     m_status = PlayerStatus::IDLE;
 
     midiRead = new MidiReader();
-    midiLog = new MidiLogger();
+    m_recorder = new CueRecorder();
+
+    // Create the cue cache in this (GUI) thread before any prefetch uses it
+    CueCache::getInstance();
+
+    // Cues are played by the cue engine, the played cues are reported back here
+    m_cueEngine = CueEngine::getInstance();
+    connect(m_cueEngine, SIGNAL(noticesPending()),
+            this, SLOT(cuesPlayed()), Qt::QueuedConnection);
+    // The cues of the next clip go to the engine as soon as they are loaded
+    connect(&m_upcomingWatcher, SIGNAL(finished()),
+            this, SLOT(handUpcomingCues()));
+
+    // MIDI timecode follows the playlist layer when an output is configured
+    m_mtcGenerator = new MtcGenerator();
+    QSettings settings("VRT", "CasparCGClient");
+    settings.beginGroup("Configuration");
+    QString mtcOutput = settings.value("mtc_out", "").toString();
+    QString mtcInput = settings.value("mtc_in", "").toString();
+    int mtcFreewheel = settings.value("mtc_freewheel", 1000).toInt();
+    double mtcOffset = settings.value("mtc_offset", 0.0).toDouble();
+    m_mtcSeekVideo = settings.value("mtc_seek_video", false).toBool();
+    QString dmxProtocol = settings.value("dmx_protocol", "").toString();
+    QString dmxTarget = settings.value("dmx_target", "").toString();
+    int dmxUniverse = settings.value("dmx_universe", -1).toInt();
+    int dmxUniverses = settings.value("dmx_universes", 1).toInt();
+    double dmxRate = settings.value("dmx_rate", 44.0).toDouble();
+    int dmxPriority[DmxCompositor::SOURCES];
+    dmxPriority[static_cast<int>(DmxSource::PLAYLIST)] = settings.value("dmx_priority_playlist", 100).toInt();
+    dmxPriority[static_cast<int>(DmxSource::SOUNDSCAPE)] = settings.value("dmx_priority_soundscape", 100).toInt();
+    dmxPriority[static_cast<int>(DmxSource::OVERLAY)] = settings.value("dmx_priority_overlay", 150).toInt();
+    dmxPriority[static_cast<int>(DmxSource::MANUAL)] = settings.value("dmx_priority_manual", 100).toInt();
+    QString dmxLtp = settings.value("dmx_ltp", "").toString();
+    QString dmxInProtocol = settings.value("dmx_in_protocol", "").toString();
+    int dmxInUniverse = settings.value("dmx_in_universe", -1).toInt();
+    int dmxInUniverses = settings.value("dmx_in_universes", 1).toInt();
+    settings.endGroup();
+    if (mtcOutput != "" && m_mtcGenerator->open(mtcOutput)) {
+        m_cueEngine->setMtcGenerator(m_mtcGenerator);
+    }
+
+    // The playlist cues chase MIDI timecode instead of the video when an input is configured
+    m_mtcChase = nullptr;
+    if (mtcInput != "") {
+        m_mtcChase = new MtcChase(m_cueEngine);
+        m_mtcChase->setFreewheel(mtcFreewheel);
+        m_mtcChase->setOffset(mtcOffset);
+        connect(m_mtcChase, SIGNAL(located(double)),
+                this, SLOT(mtcLocated(double)), Qt::QueuedConnection);
+        m_mtcChase->open(mtcInput);
+    }
+
+    // DMX cues go straight to the network when a protocol is configured
+    m_dmxOutput = nullptr;
+    if (dmxProtocol != "") {
+        bool valid;
+        DmxProtocol protocol = DmxOutput::protocolFromName(dmxProtocol, valid);
+        if (!valid) {
+            qWarning() << "Unknown DMX protocol" << dmxProtocol;
+        } else {
+            if (dmxUniverse < 0) {
+                dmxUniverse = (protocol == DmxProtocol::SACN) ? 1 : 0;
+            }
+            m_dmxOutput = new DmxOutput();
+            for (int i = 0; i < DmxCompositor::SOURCES; i++) {
+                m_dmxOutput->setPriority(static_cast<DmxSource>(i), dmxPriority[i]);
+            }
+            m_dmxOutput->setLtp(DmxOutput::channelsFromText(dmxLtp));
+            if (m_dmxOutput->open(protocol, dmxTarget, dmxUniverse, dmxUniverses, dmxRate)) {
+                m_cueEngine->setDmxOutput(m_dmxOutput);
+            }
+        }
+    }
+
+    // Every frame of cues also goes out as an OSC bundle to the targets in the OscOutput table
+    QList<oscTarget> oscTargets;
+    for (const OscOutputModel& model : DatabaseManager::getInstance()->getOscOutput()) {
+        oscTarget target;
+        target.name = model.getName();
+        target.port = static_cast<quint16>(model.getPort());
+        if (!target.address.setAddress(model.getAddress()) || model.getPort() <= 0 || model.getPort() > 65535) {
+            qWarning() << "Invalid OSC output" << model.getName() << model.getAddress() << model.getPort();
+            continue;
+        }
+        qDebug() << "Sending cues as OSC to" << target.name << model.getAddress() << target.port;
+        oscTargets.append(target);
+    }
+    m_cueEngine->setOscTargets(oscTargets);
+
+    // A take also captures the DMX of a lighting console when an input protocol is configured
+    m_dmxCapture = nullptr;
+    if (dmxInProtocol != "") {
+        bool valid;
+        DmxProtocol protocol = DmxOutput::protocolFromName(dmxInProtocol, valid);
+        if (!valid) {
+            qWarning() << "Unknown DMX input protocol" << dmxInProtocol;
+        } else {
+            if (dmxInUniverse < 0) {
+                dmxInUniverse = (protocol == DmxProtocol::SACN) ? 1 : 0;
+            }
+            if (m_dmxOutput && DmxOutput::protocolFromName(dmxProtocol, valid) == protocol &&
+                    dmxInUniverse < dmxUniverse + dmxUniverses && dmxUniverse < dmxInUniverse + dmxInUniverses) {
+                qWarning() << "The DMX input shares universes with the DMX output, a take may capture the output";
+            }
+            m_dmxCapture = new DmxCapture();
+            if (!m_dmxCapture->open(protocol, dmxInUniverse, dmxInUniverses)) {
+                delete m_dmxCapture;
+                m_dmxCapture = nullptr;
+            }
+        }
+    }
 
     // TODO: SoundScape cLip name should not be hardcoded
     ClipInfo soundScapeClip;
@@ -41,6 +154,24 @@ void Player::setRandom(bool random)
     m_random = random;
 }
 
+/**
+ * @brief Player::getCueStatistics
+ * @return number of played, late and skipped cues over all layers
+ */
+dispatchStatistics Player::getCueStatistics() const
+{
+    return m_cueEngine->getCueStatistics();
+}
+
+/**
+ * @brief Player::getScheduleStatistics
+ * @return number of cue batches played on a timer and their timing error in microseconds
+ */
+scheduleStatistics Player::getScheduleStatistics() const
+{
+    return m_cueEngine->getScheduleStatistics();
+}
+
 
 /**
  * @brief Player::loadPlayList
@@ -86,6 +217,7 @@ void Player::updateRandomClip()
             m_randomClip.setMidi(query.value(3).toInt());
         }
         query.finish();
+        prefetchCues(m_randomClipCues, m_randomClip);
         emit newRandomClip(m_randomClip);
     }
 }
@@ -113,6 +245,7 @@ void Player::startPlayList(int clipIndex)
         m_currentClip = m_playlistClips[index];
     }
     m_nextClip = m_currentClip;
+    prefetchCues(m_nextClipCues, m_nextClip);
     m_timecode = 100;  // By faking the present timecode, the start of the clip (follows) will trigger loadNextClip()
     m_device->playMovie(1, to_underlying(VideoLayer::DEFAULT), m_currentClip.getName(), "", 0, "", "", 0, 0, false, false);
     m_singlePlay = false;
@@ -157,10 +290,26 @@ void Player::resumeFromFrame(int frames)
 {
     m_device->callSeek(1, to_underlying(VideoLayer::DEFAULT), frames);
     m_device->resume(1, to_underlying(VideoLayer::DEFAULT));
-    midiPlayListIterator= midiPlayList.begin();
+    m_cueEngine->seek(CueLayer::PLAYLIST, m_playListTrack.frameAt(frames / m_playListTrack.getFps()));
+    m_mtcGenerator->relocate();
 //    setStatus(PlayerStatus::PLAYLIST_PLAYING);
 }
 
+/**
+ * @brief Player::mtcLocated
+ * The MIDI timecode was located, the cues have followed already; the video follows when configured
+ * @param time - clip time the timecode was located at
+ */
+void Player::mtcLocated(double time)
+{
+    if (!m_mtcSeekVideo || m_device == nullptr || time < 0.0) {
+        return;
+    }
+    double fps = (m_activeVideoLayer == VideoLayer::OVERLAY) ? m_interruptClip.getFps() : m_currentClip.getFps();
+    m_device->callSeek(1, to_underlying(m_activeVideoLayer), qRound(time * fps));
+    m_mtcGenerator->relocate();
+}
+
 
 /**
  * @brief Player::stopPlayList
@@ -168,7 +317,14 @@ void Player::resumeFromFrame(int frames)
 void Player::stopPlayList()
 {
     m_device->stop(1, to_underlying(VideoLayer::DEFAULT));
-    midiLog->closeMidiLog();
+    finishRecording();
+    m_upcomingCuesActive = false;
+    dropUpcomingCues();
+    scheduleStatistics timing = getScheduleStatistics();
+    if (timing.batches > 0) {
+        qDebug("Cue timing: %llu batches on timer, mean error %lld us, max error %lld us",
+               timing.batches, timing.totalError / qint64(timing.batches), timing.maxError);
+    }
     setStatus(PlayerStatus::READY);
     emit newActiveClip();
     stopSoundScape();
@@ -223,14 +379,14 @@ void Player::insertPlaylist(QString clipName, QString database)
     m_device->playMovie(1, to_underlying(VideoLayer::OVERLAY), m_interruptClip.getName(), "", 0, "", "", 0, 0, false, false);
 
     // Play notes if available
-    retrieveMidiPlayList(m_interruptClip.getName());
-    if (midiRead->isReady()) {
+    retrieveMidiPlayList(m_interruptClip);
+    if (!m_playListTrack.isEmpty()) {
         qDebug("MIDI file found...");
     } else {
         qDebug("No MIDI file found...");
     }
     if (m_recording) {
-        midiLog->openMidiLog(m_interruptClip.getName());
+        startRecording(m_interruptClip);
     }
 
     // Set status of player
@@ -244,20 +400,69 @@ void Player::insertPlaylist(QString clipName, QString database)
     }
 }
 
-void Player::saveMidiPlayList(QMap<QString, message> playList)
+void Player::saveMidiPlayList(CueTrack playList)
 {
-    midiPlayList = playList;
-    if (midiLog->isReady()) {
+    QString clipName = m_currentClip.getName();
+    CueTrack saved = CueCache::getInstance()->getTrack(clipName, playList.getFps());
+    setPlayListCues(playList);
+    m_cueEngine->skipTo(CueLayer::PLAYLIST, playList.frameAt(m_timecode));
+    if (m_recorder->isRecording()) {
         qDebug() << "Cannot write";
     } else {
-        qDebug() << "Writing" << m_currentClip.getName();
-        midiLog->openMidiLog(m_currentClip.getName());
-        foreach(auto it, midiPlayList) {
-            midiLog->writeNote(QString("%1,%2,%3").arg(it.timeCode).arg(it.type).arg(it.pitch));
+        qDebug() << "Writing" << clipName;
+        if (!CueFile::save(clipName, saved, playList)) {
+            qWarning() << "Cannot write" << CueFile::sidecarName(clipName);
+        }
+    }
+    cuesChanged(m_currentClip);
+    // The playlist only shows the number of notes, it is refreshed through the database when that changes
+    int notes = playList.noteCount();
+    if (notes != saved.noteCount()) {
+        DatabaseManager::getInstance()->updateMidiStatus(clipName, notes);
+    }
+}
+
+/**
+ * @brief Player::cuesChanged
+ * Cached and prefetched cues of a clip are outdated after its sidecar was written
+ * @param clip - the clip
+ */
+void Player::cuesChanged(const ClipInfo& clip)
+{
+    CueCache::getInstance()->invalidate(clip.getName());
+    if (m_nextClipCues.clipName == clip.getName()) {
+        prefetchCues(m_nextClipCues, clip);
+    }
+    if (m_randomClipCues.clipName == clip.getName()) {
+        prefetchCues(m_randomClipCues, clip);
+    }
+}
+
+/**
+ * @brief Player::startRecording
+ * Start a take of a clip, the take of the previous clip is finished first.
+ * The cues of the clip must have been retrieved.
+ * @param clip - the clip
+ */
+void Player::startRecording(const ClipInfo& clip)
+{
+    finishRecording();
+    m_recordedClip = clip;
+    m_recorder->start(clip.getName(), m_playListTrack);
+    if (m_dmxCapture) {
+        m_dmxCapture->start(clip.getName(), m_playListTrack);
+    }
+}
+
+void Player::finishRecording()
+{
+    if (m_recorder->isRecording()) {
+        CueTrack take = m_recorder->finish();
+        if (m_dmxCapture) {
+            m_dmxCapture->finish(take);
         }
-        midiLog->closeMidiLog();
+        cuesChanged(m_recordedClip);
     }
-    emit refreshPlayList();
 }
 
 
@@ -276,7 +481,8 @@ void Player::playClip(int clipIndex)
         }
     }
 
-    // Play clip once
+    // Play clip once, the next clip of the playlist no longer follows straight away
+    dropUpcomingCues();
     m_device->loadMovie(1, to_underlying(VideoLayer::DEFAULT), m_currentClip.getName(), "", 0, "", "", 0, 0, false, false, true);
     m_insertedClip = true;
     setStatus(PlayerStatus::PLAYLIST_PLAYING);
@@ -316,9 +522,10 @@ int Player::getClipIndexByName(QString clipName)
 
 void Player::startSoundScape()
 {
-    retrieveMidiSoundScape(m_soundScapeClip.getName());
+    retrieveMidiSoundScape(m_soundScapeClip);
     m_device->playMovie(1, to_underlying(VideoLayer::SOUNDSCAPE), m_soundScapeClip.getName(), "", 0, "", "", 0, 0, true, true);
     m_soundScapeActive = true;
+    updateCueSources();
     m_soundScapePlaying = true;
     emit soundScapeActive(true);
 }
@@ -341,6 +548,7 @@ void Player::stopSoundScape()
 {
     m_device->stop(1, to_underlying(VideoLayer::SOUNDSCAPE));
     m_soundScapeActive = false;
+    updateCueSources();
     m_soundScapePlaying = false;
     emit soundScapeActive(false);
 }
@@ -368,9 +576,13 @@ void Player::stopOverlay()
     qDebug() << "stopOverlay";
     m_device->stop(1, to_underlying(VideoLayer::OVERLAY));
     m_activeVideoLayer = VideoLayer::DEFAULT;
+    updateCueSources();
     if (m_soundScapePlaying) {
         pauseSoundScape();
     }
+    if (m_recorder->isRecording() && m_recordedClip.getName() == m_interruptClip.getName()) {
+        finishRecording();
+    }
     emit insertFinished();
 }
 
@@ -393,6 +605,7 @@ void Player::setStatus(PlayerStatus status)
     if (status != m_status) {
         m_status = status;
     }
+    updateCueSources();
     emit playerStatus(m_status, m_recording);
 }
 
@@ -415,8 +628,8 @@ void Player::loadNextClip()
     if (!m_singlePlay && !m_insertedClip && m_nextClip.getName() != "") {
         m_currentClip = m_nextClip;
         qDebug() << "Playing:" << m_currentClip.getName();
-        retrieveMidiPlayList(m_currentClip.getName());
-        if (midiRead->isReady()) {
+        retrievePlayingCues();
+        if (!m_playListTrack.isEmpty()) {
             qDebug("MIDI file found...");
             pauseSoundScape();
         }
@@ -425,7 +638,7 @@ void Player::loadNextClip()
             resumeSoundScape();
         }
         if (m_recording) {
-            midiLog->openMidiLog(m_currentClip.getName());
+            startRecording(m_currentClip);
         }
         if (m_random) {
             int randomNumber = QRandomGenerator::global()->bounded(m_playlistClips.size());
@@ -438,6 +651,7 @@ void Player::loadNextClip()
         } else {
             m_nextClip = m_playlistClips[m_currentClip.getPlaylistOrder() + 1];
         }
+        prefetchCues(m_nextClipCues, m_nextClip);
         loadClip(m_nextClip.getName());
         setStatus(PlayerStatus::PLAYLIST_PLAYING);
         emit newActiveClip(m_currentClip, m_nextClip);
@@ -447,8 +661,8 @@ void Player::loadNextClip()
     }
     if (m_insertedClip) {
         qDebug() << "Playing:" << m_currentClip.getName();
-        retrieveMidiPlayList(m_currentClip.getName());
-        if (midiRead->isReady()) {
+        retrievePlayingCues();
+        if (!m_playListTrack.isEmpty()) {
             qDebug("MIDI file found...");
             pauseSoundScape();
         }
@@ -457,11 +671,14 @@ void Player::loadNextClip()
             resumeSoundScape();
         }
         if (m_recording) {
-            midiLog->openMidiLog(m_currentClip.getName());
+            startRecording(m_currentClip);
         }
         loadClip(m_nextClip.getName());
         setStatus(PlayerStatus::PLAYLIST_PLAYING);
         m_insertedClip = false;
+        if (m_nextClipCues.future.isFinished()) {
+            handUpcomingCues();
+        }
         emit newActiveClip(m_currentClip, m_nextClip);
     }
 }
@@ -474,6 +691,12 @@ void Player::loadNextClip()
 void Player::timecode(double time, double duration, int videoLayer)
 {
     Q_UNUSED(duration)
+    if (m_recorder->isRecording() && videoLayer == to_underlying(m_activeVideoLayer) && time > 0.0) {
+        m_recorder->timecode(time);
+        if (m_dmxCapture) {
+            m_dmxCapture->timecode(time);
+        }
+    }
     if (videoLayer == to_underlying(VideoLayer::DEFAULT) && getStatus() != PlayerStatus::IDLE && getStatus() != PlayerStatus::READY) {
         if (time > 0.0 && m_endOfClipDetected) {
             double prev_timecode = m_timecode;
@@ -488,6 +711,7 @@ void Player::timecode(double time, double duration, int videoLayer)
             // Next clip has started automatically (Playlist)
             if (prev_timecode > m_timecode && m_timecode < 1.0) {
                 qDebug() << "NEXT CLIP HAS STARTED AUTOMATICALLY AT " << m_timecode;
+                activateUpcomingCues();
                 delayedLoadNextClip(100); //delay in ms
             }
             // Previous clip has just stopped - a hack has been added to measure the length of the freeze before taking action
@@ -498,7 +722,7 @@ void Player::timecode(double time, double duration, int videoLayer)
                     m_endOfClipDetected = true;
                     qDebug() << "m_endOfClipDetected = true";
                     delayedLoadNextClip(100); //delay in ms
-                    midiLog->closeMidiLog();
+                    finishRecording();
                     m_stopLength = 0;
                 } else {
                     m_stopLength++;
@@ -506,24 +730,6 @@ void Player::timecode(double time, double duration, int videoLayer)
             } else if (m_stopLength) {
                 m_stopLength = 0;
             }
-            if (midiPlayList.count() > 0) {
-                double fps = m_currentClip.getFps();
-                QString timecode = Timecode::fromTime(time, fps, false);
-                if (m_triggersActive && midiPlayListIterator != midiPlayList.end()) {
-                    if (midiPlayListIterator.key().length() > 0) {
-                        if (midiPlayListIterator->timeCode <= timecode) {
-                            if (midiPlayListIterator->timeCode == timecode) {
-                                if (midiPlayList[midiPlayListIterator->timeCode].type == "ON") {
-                                    playNote(midiPlayList[midiPlayListIterator->timeCode].pitch, true);
-                                } else {
-                                    playNote(midiPlayList[midiPlayListIterator->timeCode].pitch, false);
-                                }
-                            }
-                            midiPlayListIterator++;
-                        }
-                    }
-                }
-            }
         }
     } else if (videoLayer == to_underlying(VideoLayer::OVERLAY)) {
         if (time > 0.0 && m_activeVideoLayer == VideoLayer::OVERLAY) {
@@ -534,53 +740,37 @@ void Player::timecode(double time, double duration, int videoLayer)
                 qDebug() << "INSERTED CLIP HAS STOPPED";
                 stopOverlay();
                 resumePlayList();
-            } else if (midiPlayList.count() > 0) {
-                double fps = m_currentClip.getFps();
-                QString timecode = Timecode::fromTime(time, fps, false);
-                if (m_triggersActive && midiPlayListIterator != midiPlayList.end()) {
-                    if (midiPlayListIterator.key().length() > 0) {
-                        if (midiPlayListIterator->timeCode <= timecode) {
-                            if (midiPlayListIterator->timeCode == timecode) {
-                                if (midiPlayList[midiPlayListIterator->timeCode].type == "ON") {
-                                    playNote(midiPlayList[midiPlayListIterator->timeCode].pitch, true);
-                                } else {
-                                    playNote(midiPlayList[midiPlayListIterator->timeCode].pitch, false);
-                                }
-                            }
-                            midiPlayListIterator++;
-                        }
-                    }
-                }
             }
         }
     } else if (videoLayer == to_underlying(VideoLayer::SOUNDSCAPE)) {
-        if (m_soundScapeActive && midiSoundScape.count() > 0) {
-            double fps = m_soundScapeClip.getFps();
+        if (m_soundScapeActive && !m_soundScapeTrack.isEmpty()) {
             double prev_timecode = m_timecodeSoundScapeLayer;
             m_timecodeSoundScapeLayer = time;
             if (prev_timecode > m_timecodeSoundScapeLayer) {
-                midiSoundScapeIterator = midiSoundScape.begin();
                 qDebug() << "Soundscape restarted";
             }
-            QString timecode = Timecode::fromTime(time, fps, false);
-            if (m_triggersActive && midiSoundScapeIterator != midiSoundScape.end()) {
-                if (midiSoundScapeIterator.key().length() > 0) {
-                    if (midiSoundScapeIterator->timeCode <= timecode) {
-                        if (midiSoundScapeIterator->timeCode == timecode) {
-                            if (midiSoundScape[midiSoundScapeIterator->timeCode].type == "ON") {
-                                playNote(midiSoundScape[midiSoundScapeIterator->timeCode].pitch, true);
-                            } else {
-                                playNote(midiSoundScape[midiSoundScapeIterator->timeCode].pitch, false);
-                            }
-                        }
-                        midiSoundScapeIterator++;
-                    }
-                }
-            }
         }
     }
 }
 
+/**
+ * @brief Player::cuesPlayed
+ * Take care of the cues the cue engine has played: Raspberry PI actions, the editor,
+ * the MIDI log and the buttons. The MIDI notes themselves have already been sent.
+ */
+void Player::cuesPlayed()
+{
+    cueNotice notice;
+    while (m_cueEngine->takeNotice(notice)) {
+        noteSent(notice.pitch, notice.noteOn);
+    }
+    quint64 dropped = m_cueEngine->getDroppedNotices();
+    if (dropped != m_droppedNotices) {
+        qWarning("Cue engine: %llu played cues dropped, the GUI cannot keep up", dropped - m_droppedNotices);
+        m_droppedNotices = dropped;
+    }
+}
+
 void Player::currentFrame(int frame, int lastFrame)
 {
     m_currentFrame = frame;
@@ -590,10 +780,12 @@ void Player::currentFrame(int frame, int lastFrame)
 
 /**
  * @brief Player::playNote
- * Process and play notes. Emit notices for the editor (for example)
+ * Process and play notes pushed by the user or received from MIDI input
  * @param pitch
+ * @param noteOn - note on or note off
+ * @param velocity - MIDI velocity
  */
-void Player::playNote(unsigned int pitch, bool noteOn)
+void Player::playNote(unsigned int pitch, bool noteOn, unsigned int velocity)
 {
     // Retrieve keys pushed by user and raspberry Pi commands
     if (pitch == 128) {
@@ -604,7 +796,36 @@ void Player::playNote(unsigned int pitch, bool noteOn)
         else {
             pitch = 60;
         }
-    } else if (pitch > 128) {
+    }
+    sendNote(pitch, noteOn, velocity);
+}
+
+
+/**
+ * @brief Player::sendNote
+ * Send a note that did not come from a cue track. The MIDI note goes out through the cue
+ * engine, such that it knows which note is sounding. During a take the note is recorded.
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param noteOn - note on or note off
+ * @param velocity - MIDI velocity
+ */
+void Player::sendNote(unsigned int pitch, bool noteOn, unsigned int velocity)
+{
+    m_cueEngine->playNote(pitch, noteOn, true, velocity);
+    m_recorder->record(noteOn ? CueType::NOTE_ON : CueType::NOTE_OFF, pitch, noteOn ? velocity : 0);
+    noteSent(pitch, noteOn);
+}
+
+
+/**
+ * @brief Player::noteSent
+ * Send a note to the Raspberry PI outputs. Emit notices for the editor (for example)
+ * @param pitch - MIDI pitch or Raspberry PI action
+ * @param noteOn - note on or note off
+ */
+void Player::noteSent(unsigned int pitch, bool noteOn)
+{
+    if (pitch > 128) {
         switch(pitch) {
         case 129:
             RaspberryPI::getInstance()->setButtonActive(noteOn);
@@ -641,21 +862,13 @@ void Player::playNote(unsigned int pitch, bool noteOn)
 
     // Play notes
     QString onOff = (noteOn ? "ON" : "OFF");
-    if (midiLog->isReady() /*&& pitch != previousPitch*/ && noteOn) {
-        midiLog->writeNote(QString("%1,%2,%3").arg(timecode, onOff, QString::number(pitch)));
-    }
     if (pitch < 128) {
         if(noteOn/* && pitch != previousPitch*/) {
-            MidiConnection::getInstance()->killNote(previousPitch);
-            MidiConnection::getInstance()->playNote(pitch);
             emit activateButton(pitch);
-        } else {
-            MidiConnection::getInstance()->killNote(pitch);
         }
     } else {
         emit activateButton(pitch, noteOn);
     }
-    previousPitch = pitch;
 
     qDebug() << QString("%1 %2: pitch %3").arg(timecode, onOff, m_midiNotes->getNoteNameByPitch(pitch));
 }
@@ -680,6 +893,7 @@ void Player::setRecording()
 {
     if (m_recording) {
         m_singlePlay = true;
+        dropUpcomingCues();
     }
     m_recording = !m_recording;
     setStatus(m_status);
@@ -688,23 +902,156 @@ void Player::setRecording()
 void Player::setTriggersActive(bool value)
 {
     m_triggersActive = value;
+    m_cueEngine->setTriggersActive(value);
 }
 
-void Player::retrieveMidiPlayList(QString clipName)
+/**
+ * @brief Player::setPlayListCues
+ * Hand a new cue track for the playlist layers to the cue engine
+ * @param track - the cue track
+ */
+void Player::setPlayListCues(const CueTrack& track)
 {
-    midiPlayList = midiRead->openLog(clipName);
-    midiPlayListIterator = midiPlayList.begin();
+    m_playListTrack = track;
+    m_cueEngine->setTrack(CueLayer::PLAYLIST, track);
+}
+
+/**
+ * @brief Player::updateCueSources
+ * Tell the cue engine which video layers drive the cues, following the state of the player
+ */
+void Player::updateCueSources()
+{
+    int playList = 0;
+    if (m_status == PlayerStatus::PLAYLIST_INSERT) {
+        playList = to_underlying(VideoLayer::OVERLAY);
+    } else if (m_status == PlayerStatus::PLAYLIST_PLAYING) {
+        playList = to_underlying(m_activeVideoLayer);
+    }
+    m_cueEngine->follow(CueLayer::PLAYLIST, playList);
+    m_cueEngine->setDmxSource(CueLayer::PLAYLIST, m_status == PlayerStatus::PLAYLIST_INSERT ? DmxSource::OVERLAY : DmxSource::PLAYLIST);
+    m_cueEngine->follow(CueLayer::SOUNDSCAPE, m_soundScapeActive ? to_underlying(VideoLayer::SOUNDSCAPE) : 0);
+    // The timecode relocates by itself when the playhead jumps, for instance to a new clip
+    m_mtcGenerator->follow(playList, m_status == PlayerStatus::PLAYLIST_INSERT ? m_interruptClip.getFps() : m_currentClip.getFps());
+}
+
+void Player::retrieveMidiPlayList(ClipInfo clip)
+{
+    setPlayListCues(takeCues(clip));
     double currentTimecode = 0.0;
     if (m_activeVideoLayer == VideoLayer::DEFAULT) {
         currentTimecode = m_timecode;
     }
-    emit newMidiPlaylist(midiPlayList, currentTimecode);
+    emit newMidiPlaylist(m_playListTrack, currentTimecode);
+}
+
+void Player::retrieveMidiSoundScape(ClipInfo clip)
+{
+    m_soundScapeTrack = midiRead->openLog(clip.getName(), clip.getFps());
+    m_cueEngine->setTrack(CueLayer::SOUNDSCAPE, m_soundScapeTrack);
+}
+
+/**
+ * @brief Player::prefetchCues
+ * Start loading the cue track of a clip in the background as soon as the clip has been chosen
+ * @param prefetch - prefetch slot to be used
+ * @param clip - the clip that will be played
+ */
+void Player::prefetchCues(cuePrefetch& prefetch, ClipInfo clip)
+{
+    QString clipName = clip.getName();
+    double fps = clip.getFps();
+    prefetch.clipName = clipName;
+    prefetch.future = QtConcurrent::run([clipName, fps]() {
+        MidiReader reader;
+        return reader.openLog(clipName, fps);
+    });
+    if (&prefetch == &m_nextClipCues) {
+        dropUpcomingCues();
+        m_upcomingWatcher.setFuture(prefetch.future);
+    }
+}
+
+/**
+ * @brief Player::handUpcomingCues
+ * Hand the prefetched cues of the next clip to the cue engine, which switches to them on
+ * the first time report of that clip. Not while a single clip plays.
+ */
+void Player::handUpcomingCues()
+{
+    if (m_singlePlay || m_insertedClip || m_nextClip.getName() != m_nextClipCues.clipName ||
+            !m_nextClipCues.future.isFinished()) {
+        return;
+    }
+    m_cueEngine->setUpcomingTrack(CueLayer::PLAYLIST, m_nextClipCues.future.result());
+    m_upcomingClipName = m_nextClipCues.clipName;
+}
+
+void Player::dropUpcomingCues()
+{
+    if (!m_upcomingClipName.isEmpty()) {
+        m_cueEngine->dropUpcomingTrack(CueLayer::PLAYLIST);
+        m_upcomingClipName.clear();
+    }
+}
+
+/**
+ * @brief Player::takeCues
+ * Collect the cue track of a clip, from a prefetch when one is available
+ * @param clip - the clip
+ * @return the cue track of the clip
+ */
+CueTrack Player::takeCues(ClipInfo clip)
+{
+    if (m_nextClipCues.future.isValid() && m_nextClipCues.clipName == clip.getName()) {
+        return m_nextClipCues.future.result();
+    }
+    if (m_randomClipCues.future.isValid() && m_randomClipCues.clipName == clip.getName()) {
+        return m_randomClipCues.future.result();
+    }
+    return midiRead->openLog(clip.getName(), clip.getFps());
 }
 
-void Player::retrieveMidiSoundScape(QString clipName)
+/**
+ * @brief Player::activateUpcomingCues
+ * Swap in the cue track of the clip that has just started. When the track was handed to the
+ * cue engine ahead, the engine has switched to it on the first time report of the clip
+ * already; otherwise it is swapped in now.
+ */
+void Player::activateUpcomingCues()
 {
-    midiSoundScape = midiRead->openLog(clipName);
-    midiSoundScapeIterator = midiSoundScape.begin();
+    ClipInfo startingClip;
+    if (m_insertedClip) {
+        startingClip = m_currentClip;
+    } else if (!m_singlePlay && m_nextClip.getName() != "") {
+        startingClip = m_nextClip;
+    } else {
+        return;
+    }
+    if (!m_insertedClip && startingClip.getName() == m_upcomingClipName) {
+        m_playListTrack = takeCues(startingClip);
+        m_cueEngine->startUpcomingTrack(CueLayer::PLAYLIST);
+        m_upcomingClipName.clear();
+    } else {
+        dropUpcomingCues();
+        setPlayListCues(takeCues(startingClip));
+    }
+    m_upcomingCuesActive = true;
+}
+
+/**
+ * @brief Player::retrievePlayingCues
+ * Make sure the cues of the current clip are active, unless they were already swapped in
+ * when the clip started
+ */
+void Player::retrievePlayingCues()
+{
+    if (m_upcomingCuesActive) {
+        m_upcomingCuesActive = false;
+        emit newMidiPlaylist(m_playListTrack, m_timecode);
+    } else {
+        retrieveMidiPlayList(m_currentClip);
+    }
 }
 
 void Player::delayedLoadNextClip(int timeout)
@@ -1,10 +1,18 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
+#include <QFuture>
+#include <QFutureWatcher>
+
 #include "CasparDevice.h"
+#include "CueEngine.h"
+#include "CueRecorder.h"
 #include "MidiReader.h"
-#include "MidiLogger.h"
 #include "MidiNotes.h"
+#include "DmxCapture.h"
+#include "DmxOutput.h"
+#include "MtcChase.h"
+#include "MtcGenerator.h"
 #include "Models/ClipInfo.h"
 
 enum class PlayerStatus
@@ -24,6 +32,11 @@ enum class VideoLayer
     EDIT = 4
 };
 
+struct cuePrefetch {
+    QString clipName;
+    QFuture<CueTrack> future;
+};
+
 template <typename E>
 constexpr typename std::underlying_type<E>::type to_underlying(E e) {
     return static_cast<typename std::underlying_type<E>::type>(e);
@@ -49,13 +62,15 @@ public:
     void resumeFromFrame(int frames);
     void stopPlayList();
     PlayerStatus getStatus() const;
-    void retrieveMidiPlayList(QString clipName);
-    void saveMidiPlayList(QMap<QString, message> midiPlayList);
+    void retrieveMidiPlayList(ClipInfo clip);
+    void saveMidiPlayList(CueTrack midiPlayList);
     void playClip(QString clipName);
     void nextClip();
     void setTriggersActive(bool value);
     VideoLayer getActiveVideoLayer() {return m_activeVideoLayer;};
     void updateRandomClip();
+    dispatchStatistics getCueStatistics() const;
+    scheduleStatistics getScheduleStatistics() const;
 
     // SoundScape Calls
     void startSoundScape();
@@ -70,12 +85,17 @@ public slots:
     void loadNextClip();
     void timecode(double time, double duration, int videoLayer);
     void currentFrame(int frame, int lastFrame);
-    void playNote(unsigned int pitch = 128, bool noteOne = true);
+    void playNote(unsigned int pitch = 128, bool noteOne = true, unsigned int velocity = 60);
     void killNote();
     void setRecording();
     void insertPlaylist(QString clipName = "random", QString database = "scares");
     void onTimer_LoadNextClip();
 
+private slots:
+    void cuesPlayed();
+    void mtcLocated(double time);
+    void handUpcomingCues();
+
 private:
     CasparDevice* m_device;
     QList<ClipInfo> m_playlistClips;
@@ -90,16 +110,38 @@ private:
     double m_timecodeSoundScapeLayer;
     PlayerStatus m_status;
     MidiReader* midiRead;
-    MidiLogger* midiLog;
-    QMap<QString, message> midiPlayList;
-    QMap<QString, message> midiSoundScape;
-    QMap<QString, message>::iterator midiPlayListIterator;
-    QMap<QString, message>::iterator midiSoundScapeIterator;
+    CueRecorder* m_recorder;
+    ClipInfo m_recordedClip;
+    void startRecording(const ClipInfo& clip);
+    void finishRecording();
+    void cuesChanged(const ClipInfo& clip);
+    CueEngine* m_cueEngine;
+    quint64 m_droppedNotices = 0;
+    MtcGenerator* m_mtcGenerator;
+    MtcChase* m_mtcChase;
+    bool m_mtcSeekVideo = false;
+    DmxOutput* m_dmxOutput;
+    DmxCapture* m_dmxCapture;
+    CueTrack m_playListTrack;
+    CueTrack m_soundScapeTrack;
+    void setPlayListCues(const CueTrack& track);
+    void updateCueSources();
+    cuePrefetch m_nextClipCues;
+    cuePrefetch m_randomClipCues;
+    QFutureWatcher<CueTrack> m_upcomingWatcher;
+    QString m_upcomingClipName;
+    bool m_upcomingCuesActive = false;
+    void dropUpcomingCues();
+    void prefetchCues(cuePrefetch& prefetch, ClipInfo clip);
+    CueTrack takeCues(ClipInfo clip);
+    void activateUpcomingCues();
+    void retrievePlayingCues();
+    void sendNote(unsigned int pitch, bool noteOn, unsigned int velocity = 60);
+    void noteSent(unsigned int pitch, bool noteOn);
     bool m_singlePlay = false;
     bool m_recording = false;
     bool m_triggersActive = true;
     void setStatus(PlayerStatus status);
-    unsigned int previousPitch;
     bool m_insertedClip = false;
     bool m_endOfClipDetected = false;
     int m_currentFrame;
@@ -107,7 +149,7 @@ private:
     int getClipIndexByName(QString ClipName);
     bool m_soundScapeActive = false;
     bool m_soundScapePlaying = false;
-    void retrieveMidiSoundScape(QString clipName);
+    void retrieveMidiSoundScape(ClipInfo clip);
     bool m_random = true;
     MidiNotes* m_midiNotes = MidiNotes::getInstance();
     int m_stopLength = 0;
@@ -117,10 +159,9 @@ signals:
     void activateButton(unsigned int pitch, bool active = true);
     void playerStatus(PlayerStatus status, bool recording);
     void insertFinished();
-    void newMidiPlaylist(QMap<QString, message> midiPlayList, double timecode);
+    void newMidiPlaylist(CueTrack midiPlayList, double timecode);
     void newRandomClip(ClipInfo randomClip);
     void currentNote(QString timecode, bool noteOn, unsigned int pitch);
-    void refreshPlayList();
     void soundScapeActive(bool active);
 };
 
@@ -0,0 +1,101 @@
+#include "PlayheadClock.h"
+
+#include <QtMath>
+
+// Reports further off the prediction than this (in seconds) are a seek, not jitter
+static const double MAX_DEVIATION = 0.25;
+
+// Video is played at its own rate, the fit only absorbs clock drift
+static const double MIN_RATE = 0.95;
+static const double MAX_RATE = 1.05;
+
+PlayheadClock::PlayheadClock()
+{
+    m_timer.start();
+}
+
+/**
+ * @brief PlayheadClock::update
+ * Add a time report of the layer, received just now
+ * @param time - playhead position in seconds as reported by the server
+ */
+void PlayheadClock::update(double time)
+{
+    qint64 now = m_timer.nsecsElapsed();
+    if (m_count > 0) {
+        int last = (m_next + MAX_SAMPLES - 1) % MAX_SAMPLES;
+        // A paused, looped or repositioned layer starts a new fit
+        if (time <= m_time[last] || (isRunning() && qFabs(time - timeAt(now)) > MAX_DEVIATION)) {
+            reset();
+        }
+    }
+    m_wall[m_next] = now;
+    m_time[m_next] = time;
+    m_next = (m_next + 1) % MAX_SAMPLES;
+    if (m_count < MAX_SAMPLES) {
+        m_count++;
+    }
+    if (isRunning()) {
+        fit();
+    }
+}
+
+void PlayheadClock::reset()
+{
+    m_next = 0;
+    m_count = 0;
+    m_rate = 1.0;
+}
+
+/**
+ * @brief PlayheadClock::fit
+ * Least squares fit of the play rate, offset through the least delayed report
+ */
+void PlayheadClock::fit()
+{
+    int newest = (m_next + MAX_SAMPLES - 1) % MAX_SAMPLES;
+    m_origin = m_wall[newest];
+
+    double meanX = 0.0;
+    double meanY = 0.0;
+    for (int i = 0; i < m_count; i++) {
+        meanX += (m_wall[i] - m_origin) / 1e9;
+        meanY += m_time[i];
+    }
+    meanX /= m_count;
+    meanY /= m_count;
+
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (int i = 0; i < m_count; i++) {
+        double dx = (m_wall[i] - m_origin) / 1e9 - meanX;
+        covariance += dx * (m_time[i] - meanY);
+        variance += dx * dx;
+    }
+    m_rate = (variance > 0.0) ? qBound(MIN_RATE, covariance / variance, MAX_RATE) : 1.0;
+
+    m_offset = m_time[newest];
+    for (int i = 0; i < m_count; i++) {
+        m_offset = qMax(m_offset, m_time[i] - m_rate * (m_wall[i] - m_origin) / 1e9);
+    }
+}
+
+/**
+ * @brief PlayheadClock::timeAt
+ * @param nsecs - wall clock instant, as returned by now()
+ * @return predicted playhead position in seconds
+ */
+double PlayheadClock::timeAt(qint64 nsecs) const
+{
+    return m_offset + m_rate * (nsecs - m_origin) / 1e9;
+}
+
+/**
+ * @brief PlayheadClock::nsecsAt
+ * @param time - playhead position in seconds
+ * @return predicted wall clock instant at which the playhead reaches the position
+ */
+qint64 PlayheadClock::nsecsAt(double time) const
+{
+    return m_origin + static_cast<qint64>((time - m_offset) / m_rate * 1e9);
+}
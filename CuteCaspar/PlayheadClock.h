@@ -0,0 +1,38 @@
+#ifndef PLAYHEADCLOCK_H
+#define PLAYHEADCLOCK_H
+
+#include <QElapsedTimer>
+
+/**
+ * @brief The PlayheadClock class
+ * Estimates the playhead position of a video layer between two OSC time reports.
+ * The play rate is fitted over the most recent reports; the offset follows the report
+ * that arrived with the least delay, because network and event loop latency only ever
+ * make a report arrive late, never early. Any jump in the reports restarts the fit.
+ */
+class PlayheadClock
+{
+public:
+    PlayheadClock();
+    void update(double time);
+    void reset();
+    bool isRunning() const { return m_count > 1; }
+    qint64 now() const { return m_timer.nsecsElapsed(); }
+    double timeAt(qint64 nsecs) const;
+    qint64 nsecsAt(double time) const;
+    double getRate() const { return m_rate; }
+
+private:
+    static const int MAX_SAMPLES = 16;
+    QElapsedTimer m_timer;
+    qint64 m_wall[MAX_SAMPLES];
+    double m_time[MAX_SAMPLES];
+    int m_next = 0;
+    int m_count = 0;
+    qint64 m_origin = 0;
+    double m_offset = 0.0;
+    double m_rate = 1.0;
+    void fit();
+};
+
+#endif // PLAYHEADCLOCK_H
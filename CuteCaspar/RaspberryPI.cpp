@@ -10,6 +10,14 @@
 #include <QTimer>
 #include <QEventLoop>
 #include <QRandomGenerator>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+#include "OutputLatency.h"
+
+// Number of round trips taken to measure the latency of a link
+static const int LATENCY_SAMPLES = 5;
 
 RaspberryPI *RaspberryPI::s_inst = nullptr;
 
@@ -139,6 +147,19 @@ void RaspberryPI::setup()
                              {
                                  qDebug() << "❌ Failed to subscribe to MQTT doorbell topic";
                              }
+
+                             // Subscribe to our own echo topic, used to measure the broker round trip
+                             QString echoTopic = QString("%1/echo").arg(m_mqttTopicPrefix);
+                             QMqttSubscription *echoSubscription = mqttClient->subscribe(echoTopic, 1);
+
+                             if (echoSubscription)
+                             {
+                                 QObject::connect(echoSubscription, &QMqttSubscription::messageReceived,
+                                                  [this](const QMqttMessage &)
+                                                  {
+                                                      emit mqttEcho();
+                                                  });
+                             }
                          });
 
         QObject::connect(mqttClient, &QMqttClient::disconnected, [this]()
@@ -307,29 +328,53 @@ void RaspberryPI::processPendingDatagrams()
 
 void RaspberryPI::publishMqtt(const QString& topic, const QString& payload, int qos)
 {
-    if (m_mqttEnabled && mqttClient && mqttClient->state() == QMqttClient::Connected) {
-        mqttClient->publish(QMqttTopicName(topic), payload.toUtf8(), qos);
-        qDebug() << QString("📡 Published MQTT message '%1' to topic '%2'").arg(payload).arg(topic);
-    } else {
-        qDebug() << "❌ MQTT not connected, cannot publish to" << topic;
-    }
+    OutputLatency::getInstance()->deliver(CueOutput::MQTT, [this, topic, payload, qos]() {
+        if (m_mqttEnabled && mqttClient && mqttClient->state() == QMqttClient::Connected) {
+            mqttClient->publish(QMqttTopicName(topic), payload.toUtf8(), qos);
+            qDebug() << QString("📡 Published MQTT message '%1' to topic '%2'").arg(payload).arg(topic);
+        } else {
+            qDebug() << "❌ MQTT not connected, cannot publish to" << topic;
+        }
+    });
 }
 
 /**
  * @brief RaspberryPI::sendMessage
+ * Send a command over UDP and MQTT, each link delayed such that both land at the same time
  * @param msg
  */
 void RaspberryPI::sendMessage(QString msg)
 {
     qDebug() << QString("🔄 sendMessage called with: '%1'").arg(msg);
 
+    OutputLatency::getInstance()->deliver(CueOutput::UDP, [this, msg]() {
+        sendUdp(msg);
+    });
+    OutputLatency::getInstance()->deliver(CueOutput::MQTT, [this, msg]() {
+        sendMqtt(msg);
+    });
+}
+
+/**
+ * @brief RaspberryPI::sendUdp
+ * @param msg
+ */
+void RaspberryPI::sendUdp(const QString& msg)
+{
     // Always send via UDP (keep existing functionality)
     QByteArray Data;
     Data.append("raspi/");
     Data.append(msg.toUtf8());
     udpSocketOut->writeDatagram(Data, Data.size(), m_address, m_portOut);
     qDebug() << QString("📤 Sending UDP Message '%1' to %2:%3").arg(msg).arg(m_address.toString()).arg(m_portOut);
+}
 
+/**
+ * @brief RaspberryPI::sendMqtt
+ * @param msg
+ */
+void RaspberryPI::sendMqtt(const QString& msg)
+{
     // Step 3: Send ALL commands via MQTT (not just "start" and "alive")
     if (m_mqttEnabled && mqttClient && mqttClient->state() == QMqttClient::Connected)
     {
@@ -348,6 +393,75 @@ void RaspberryPI::sendMessage(QString msg)
     }
 }
 
+/**
+ * @brief RaspberryPI::measureRoundTrip
+ * Time a number of request/reply round trips, waiting at most 250 ms for every reply
+ * @param reply - signal emitted when the reply has been received
+ * @param request - sends the request
+ * @return median round trip in nanoseconds, -1 when no reply has been received
+ */
+qint64 RaspberryPI::measureRoundTrip(const char* reply, std::function<void()> request)
+{
+    QList<qint64> samples;
+    for (int i = 0; i < LATENCY_SAMPLES; i++) {
+        QTimer timer;
+        timer.setSingleShot(true);
+        QEventLoop loop;
+        connect(this, reply, &loop, SLOT(quit()));
+        connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+        QElapsedTimer elapsed;
+        elapsed.start();
+        request();
+        timer.start(250);
+        loop.exec();
+        if (timer.isActive()) {
+            samples.append(elapsed.nsecsElapsed());
+        }
+    }
+    if (samples.isEmpty()) {
+        return -1;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples.at(samples.size() / 2);
+}
+
+/**
+ * @brief RaspberryPI::measureUdpLatency
+ * The PI answers "alive" with "ok", the latency is half of that round trip
+ * @return latency in milliseconds, -1 when the PI does not answer
+ */
+int RaspberryPI::measureUdpLatency()
+{
+    qint64 roundTrip = measureRoundTrip(SIGNAL(heartBeat()), [this]() {
+        sendUdp("alive");
+    });
+    if (roundTrip < 0) {
+        return -1;
+    }
+    return static_cast<int>((roundTrip / 2 + 500000) / 1000000);
+}
+
+/**
+ * @brief RaspberryPI::measureMqttLatency
+ * A message published to our own echo topic travels to the broker and back, which takes
+ * about as long as travelling to the broker and on to the PI
+ * @return latency in milliseconds, -1 when the broker does not answer
+ */
+int RaspberryPI::measureMqttLatency()
+{
+    if (!isMqttConnected()) {
+        return -1;
+    }
+    QString topic = QString("%1/echo").arg(m_mqttTopicPrefix);
+    qint64 roundTrip = measureRoundTrip(SIGNAL(mqttEcho()), [this, topic]() {
+        mqttClient->publish(QMqttTopicName(topic), QByteArray("echo"), 1);
+    });
+    if (roundTrip < 0) {
+        return -1;
+    }
+    return static_cast<int>((roundTrip + 500000) / 1000000);
+}
+
 void RaspberryPI::parseMessage(QString msg)
 {
     if (msg == "high" && isButtonActive())
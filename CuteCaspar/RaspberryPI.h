@@ -5,6 +5,8 @@
 #include <QUdpSocket>
 #include <QMqttClient>
 
+#include <functional>
+
 struct status {
     bool connected = false;
     bool buttonActive = false;
@@ -58,11 +60,16 @@ public:
     // Helper to publish arbitrary MQTT messages
     void publishMqtt(const QString& topic, const QString& payload, int qos = 1);
 
+    // Latency of the links, in milliseconds, -1 when the link does not respond
+    int measureUdpLatency();
+    int measureMqttLatency();
+
 signals:
     void statusButton(QString msg);
     void statusUpdate(status stat);
     void insertPlaylist(QString clipName = "random", QString database = "scares");
     void heartBeat();
+    void mqttEcho();
 
 public slots:
     void sendMessage(QString msg);
@@ -89,6 +96,9 @@ private:
     QString m_mqttTopicPrefix = "cutecaspar/raspi";
     status m_status;
     void sendStatus();    
+    void sendUdp(const QString& msg);
+    void sendMqtt(const QString& msg);
+    qint64 measureRoundTrip(const char* reply, std::function<void()> request);
 };
 
 #endif // RASPBERRYPI_H
@@ -1,6 +1,7 @@
 #include "RaspberryPIDialog.h"
 #include "ui_RaspberryPIDialog.h"
 
+#include "OutputLatency.h"
 #include "RaspberryPI.h"
 #include "SettingsDialog.h"
 
@@ -100,6 +101,9 @@ void RaspberryPIDialog::on_btnConnect_clicked()
             ui->btnSmoke->setEnabled(true);
             // Initialize button status
             RaspberryPI::getInstance()->setButtonActive(true);
+            if (OutputLatency::getInstance()->isAutoMeasure()) {
+                OutputLatency::getInstance()->measure();
+            }
         } else {
             QMessageBox msgBox;
             msgBox.setText("Cannot connect to RaspberryPI.");
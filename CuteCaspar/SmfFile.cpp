@@ -0,0 +1,442 @@
+#include "SmfFile.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CueFile.h"
+
+namespace {
+
+struct smfNote {
+    quint32 tick;
+    CueType type;
+    quint8 pitch;
+    quint8 velocity;
+    quint8 channel;
+};
+
+struct smfTempo {
+    quint32 tick;
+    quint32 microseconds;
+};
+
+struct libraryClip {
+    QString name;
+    double fps;
+};
+
+/**
+ * @brief smfReader
+ * Steps through the bytes of a MIDI file, every read fails safely past the end
+ */
+struct smfReader {
+    const uchar* pos;
+    const uchar* end;
+    bool failed = false;
+
+    bool available(qint64 count) const
+    {
+        return !failed && end - pos >= count;
+    }
+
+    quint32 readFixed(int bytes)
+    {
+        if (!available(bytes)) {
+            failed = true;
+            return 0;
+        }
+        quint32 value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value = (value << 8) | *pos++;
+        }
+        return value;
+    }
+
+    quint32 readVariable()
+    {
+        quint32 value = 0;
+        for (int i = 0; i < 4; i++) {
+            if (!available(1)) {
+                failed = true;
+                return 0;
+            }
+            uchar byte = *pos++;
+            value = (value << 7) | (byte & 0x7F);
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    void skip(quint32 count)
+    {
+        if (!available(count)) {
+            failed = true;
+            return;
+        }
+        pos += count;
+    }
+};
+
+void writeFixed(QByteArray& out, quint32 value, int bytes)
+{
+    for (int i = bytes - 1; i >= 0; i--) {
+        out.append(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void writeVariable(QByteArray& out, quint32 value)
+{
+    char bytes[4];
+    int count = 0;
+    do {
+        bytes[count++] = static_cast<char>(value & 0x7F);
+        value >>= 7;
+    } while (value && count < 4);
+    while (count > 1) {
+        out.append(static_cast<char>(bytes[--count] | 0x80));
+    }
+    out.append(bytes[0]);
+}
+
+/**
+ * @brief readTrack
+ * Collect the notes and tempo changes of one MTrk chunk
+ * @return false when the chunk is malformed
+ */
+bool readTrack(smfReader reader, QVector<smfNote>& notes, QVector<smfTempo>& tempos)
+{
+    quint32 tick = 0;
+    uchar status = 0;
+    while (reader.available(1)) {
+        tick += reader.readVariable();
+        if (!reader.available(1)) {
+            return false;
+        }
+        if (*reader.pos & 0x80) {
+            status = *reader.pos++;
+        } else if (status == 0) {
+            return false;
+        }
+
+        if (status == 0xFF) {
+            uchar type = static_cast<uchar>(reader.readFixed(1));
+            quint32 length = reader.readVariable();
+            if (type == 0x51 && length == 3) {
+                smfTempo tempo;
+                tempo.tick = tick;
+                tempo.microseconds = reader.readFixed(3);
+                tempos.append(tempo);
+            } else if (type == 0x2F) {
+                return !reader.failed;
+            } else {
+                reader.skip(length);
+            }
+            status = 0;
+        } else if (status == 0xF0 || status == 0xF7) {
+            reader.skip(reader.readVariable());
+            status = 0;
+        } else {
+            uchar kind = status & 0xF0;
+            uchar first = static_cast<uchar>(reader.readFixed(1));
+            uchar second = (kind == 0xC0 || kind == 0xD0) ? 0 : static_cast<uchar>(reader.readFixed(1));
+            if (kind == 0x80 || kind == 0x90) {
+                smfNote note;
+                note.tick = tick;
+                note.type = (kind == 0x90 && second > 0) ? CueType::NOTE_ON : CueType::NOTE_OFF;
+                note.pitch = first & 0x7F;
+                note.velocity = second & 0x7F;
+                note.channel = static_cast<quint8>((status & 0x0F) + 1);
+                if (note.channel == SmfFile::PI_CHANNEL) {
+                    note.pitch = static_cast<quint8>(note.pitch + 128);
+                    note.channel = 1;
+                }
+                notes.append(note);
+            }
+        }
+        if (reader.failed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief queryLibrary
+ * @return name and frame rate of all clips in the library
+ */
+QVector<libraryClip> queryLibrary()
+{
+    QVector<libraryClip> clips;
+    QSqlQuery query;
+    if (!query.exec("SELECT Name, Fps FROM Library ORDER BY Name")) {
+        qCritical("Failed to execute sql query: %s, Error: %s", qPrintable(query.lastQuery()), qPrintable(query.lastError().text()));
+        return clips;
+    }
+    while (query.next()) {
+        libraryClip clip;
+        clip.name = query.value(0).toString();
+        clip.fps = query.value(1).toDouble();
+        if (clip.fps < 1.0) {
+            clip.fps = 29.97;
+        }
+        clips.append(clip);
+    }
+    return clips;
+}
+
+}
+
+/**
+ * @brief SmfFile::read
+ * Convert the notes of a Standard MIDI File into the cues of a clip. All tracks of a
+ * type 1 file are merged; notes on the same tick keep the order of their tracks.
+ * @param fileName - the MIDI file
+ * @param fps - frame rate of the clip
+ * @return the cue track, empty when the file cannot be read
+ */
+CueTrack SmfFile::read(const QString& fileName, double fps)
+{
+    CueTrack track(fps);
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return track;
+    }
+    QByteArray content = file.readAll();
+    file.close();
+
+    smfReader reader;
+    reader.pos = reinterpret_cast<const uchar*>(content.constData());
+    reader.end = reader.pos + content.size();
+    if (!reader.available(14) || memcmp(reader.pos, "MThd", 4) != 0) {
+        qWarning() << fileName << "is not a Standard MIDI File";
+        return track;
+    }
+    reader.skip(4);
+    quint32 headerLength = reader.readFixed(4);
+    quint32 format = reader.readFixed(2);
+    reader.readFixed(2);
+    quint32 division = reader.readFixed(2);
+    reader.skip(headerLength - 6);
+    if (reader.failed || format > 1 || division == 0) {
+        qWarning() << fileName << "has an unsupported MIDI file format" << format;
+        return track;
+    }
+
+    QVector<smfNote> notes;
+    QVector<smfTempo> tempos;
+    while (reader.available(8)) {
+        bool isTrack = (memcmp(reader.pos, "MTrk", 4) == 0);
+        reader.skip(4);
+        quint32 length = reader.readFixed(4);
+        if (!reader.available(length)) {
+            qWarning() << fileName << "is truncated";
+            break;
+        }
+        if (isTrack) {
+            smfReader chunk;
+            chunk.pos = reader.pos;
+            chunk.end = reader.pos + length;
+            if (!readTrack(chunk, notes, tempos)) {
+                qWarning() << fileName << "has a malformed track";
+            }
+        }
+        reader.skip(length);
+    }
+
+    std::stable_sort(notes.begin(), notes.end(), [](const smfNote& a, const smfNote& b) {
+        return a.tick < b.tick;
+    });
+    std::stable_sort(tempos.begin(), tempos.end(), [](const smfTempo& a, const smfTempo& b) {
+        return a.tick < b.tick;
+    });
+
+    // Walk the tempo map along with the notes, summing the time of every tempo segment
+    double secondsPerTick;
+    if (division & 0x8000) {
+        int smpte = -static_cast<qint8>(division >> 8);
+        secondsPerTick = 1.0 / ((smpte == 29 ? 29.97 : smpte) * (division & 0xFF));
+    } else {
+        secondsPerTick = MICROSECONDS_PER_QUARTER / 1e6 / division;
+    }
+    double segmentTime = 0.0;
+    quint32 segmentTick = 0;
+    int tempo = 0;
+    for (const smfNote& note : notes) {
+        if (!(division & 0x8000)) {
+            while (tempo < tempos.size() && tempos[tempo].tick <= note.tick) {
+                segmentTime += (tempos[tempo].tick - segmentTick) * secondsPerTick;
+                segmentTick = tempos[tempo].tick;
+                secondsPerTick = tempos[tempo].microseconds / 1e6 / division;
+                tempo++;
+            }
+        }
+        double time = segmentTime + (note.tick - segmentTick) * secondsPerTick;
+        // Notes come in tick order, so the frames are appended in order as well
+        track.append(track.frameAt(time), note.type, note.pitch, note.velocity, note.channel);
+    }
+    return track;
+}
+
+/**
+ * @brief SmfFile::write
+ * Write the cues of a clip as a type 0 MIDI file at a fixed tempo. Every cue lands on the
+ * first tick inside its frame, so reading the file back gives the same frames.
+ * @param fileName - the MIDI file
+ * @param track - the cues to be written
+ * @return true on success
+ */
+bool SmfFile::write(const QString& fileName, const CueTrack& track)
+{
+    const double ticksPerSecond = TICKS_PER_QUARTER * 1e6 / MICROSECONDS_PER_QUARTER;
+
+    QByteArray events;
+    events.reserve(16 + track.count() * 4);
+    writeVariable(events, 0);
+    events.append("\xFF\x51\x03", 3);
+    writeFixed(events, MICROSECONDS_PER_QUARTER, 3);
+
+    quint32 previousTick = 0;
+    uchar runningStatus = 0;
+    for (int i = 0; i < track.count(); i++) {
+        const cue& it = track.at(i);
+        if (isDmx(it)) {
+            // DMX levels have no place in a MIDI file, they stay in the sidecar
+            continue;
+        }
+        quint32 tick = static_cast<quint32>(qMax(0.0, std::ceil(track.timeAt(it.frame) * ticksPerSecond - 1e-6)));
+        int channel = qBound(1, static_cast<int>(it.channel), 16);
+        int pitch = it.pitch;
+        if (pitch > 127) {
+            channel = PI_CHANNEL;
+            pitch -= 128;
+        }
+        uchar status = static_cast<uchar>((it.type == CueType::NOTE_ON ? 0x90 : 0x80) | (channel - 1));
+        writeVariable(events, tick - previousTick);
+        if (status != runningStatus) {
+            events.append(static_cast<char>(status));
+            runningStatus = status;
+        }
+        events.append(static_cast<char>(pitch & 0x7F));
+        // A note on with velocity 0 would read back as a note off
+        int velocity = it.velocity & 0x7F;
+        if (it.type == CueType::NOTE_ON && velocity == 0) {
+            velocity = 1;
+        }
+        events.append(static_cast<char>(velocity));
+        previousTick = tick;
+    }
+    writeVariable(events, 0);
+    events.append("\xFF\x2F\x00", 3);
+
+    QByteArray header;
+    header.append("MThd", 4);
+    writeFixed(header, 6, 4);
+    writeFixed(header, 0, 2);
+    writeFixed(header, 1, 2);
+    writeFixed(header, TICKS_PER_QUARTER, 2);
+    header.append("MTrk", 4);
+    writeFixed(header, static_cast<quint32>(events.size()), 4);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(header);
+    file.write(events);
+    return file.commit();
+}
+
+/**
+ * @brief SmfFile::importLibrary
+ * Compile the MIDI file sidecars of all clips in the library, in parallel
+ * @return number of compiled MIDI files
+ */
+int SmfFile::importLibrary()
+{
+    QVector<libraryClip> clips;
+    for (const libraryClip& clip : queryLibrary()) {
+        if (QFileInfo::exists(CueFile::smfName(clip.name))) {
+            clips.append(clip);
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> counts = QtConcurrent::blockingMapped<QVector<int>>(clips, [](const libraryClip& clip) {
+        QString source = CueFile::smfName(clip.name);
+        CueTrack track = SmfFile::read(source, clip.fps);
+        if (!CueFile::write(CueFile::compiledName(clip.name), track, source)) {
+            qWarning() << "Failed to compile" << source;
+            return -1;
+        }
+        return track.count();
+    });
+
+    int files = 0;
+    qint64 cues = 0;
+    for (int i = 0; i < clips.size(); i++) {
+        if (counts[i] >= 0) {
+            qInfo("%s: %d cues", qPrintable(CueFile::smfName(clips[i].name)), counts[i]);
+            files++;
+            cues += counts[i];
+        }
+    }
+    qInfo("Imported %d MIDI files with %lld cues in %.3f ms", files, cues, timer.nsecsElapsed() / 1e6);
+    return files;
+}
+
+/**
+ * @brief SmfFile::exportLibrary
+ * Write the cues of all clips in the library as MIDI files into a folder, in parallel.
+ * The files go to a folder of their own, otherwise they would become the sidecars of the clips.
+ * @param folder - destination folder
+ * @return number of written MIDI files
+ */
+int SmfFile::exportLibrary(const QString& folder)
+{
+    QDir destination(folder);
+    if (!destination.exists() && !QDir().mkpath(folder)) {
+        qCritical("Cannot create folder %s", qPrintable(folder));
+        return -1;
+    }
+
+    QVector<libraryClip> clips;
+    for (const libraryClip& clip : queryLibrary()) {
+        if (QFileInfo::exists(CueFile::sourceName(clip.name))) {
+            clips.append(clip);
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> counts = QtConcurrent::blockingMapped<QVector<int>>(clips, [destination](const libraryClip& clip) {
+        CueTrack track = CueFile::open(clip.name, clip.fps);
+        if (!SmfFile::write(destination.filePath(CueFile::smfName(clip.name)), track)) {
+            qWarning() << "Failed to export" << clip.name;
+            return -1;
+        }
+        return track.count();
+    });
+
+    int files = 0;
+    for (int count : counts) {
+        if (count >= 0) {
+            files++;
+        }
+    }
+    qInfo("Exported %d MIDI files to %s in %.3f ms", files, qPrintable(destination.absolutePath()), timer.nsecsElapsed() / 1e6);
+    return files;
+}
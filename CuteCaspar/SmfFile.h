@@ -0,0 +1,30 @@
+#ifndef SMFFILE_H
+#define SMFFILE_H
+
+#include <QString>
+
+#include "CueTrack.h"
+
+/**
+ * @brief The SmfFile class
+ * Reads and writes the cues of a clip as a Standard MIDI File (type 0 or 1), such that
+ * they can be programmed in a DAW. Ticks are converted to clip frames through the tempo
+ * map of the file. Raspberry PI actions (pitch 128 and up) do not fit a MIDI note and
+ * travel on their own MIDI channel instead.
+ */
+class SmfFile
+{
+public:
+    static const int PI_CHANNEL = 16;
+    static const int TICKS_PER_QUARTER = 960;
+    static const int MICROSECONDS_PER_QUARTER = 500000;
+    static CueTrack read(const QString& fileName, double fps);
+    static bool write(const QString& fileName, const CueTrack& track);
+    static int importLibrary();
+    static int exportLibrary(const QString& folder);
+
+private:
+    SmfFile() {}
+};
+
+#endif // SMFFILE_H
@@ -23,8 +23,19 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# RtMidi backend of the platform: WinMM, the ALSA sequencer or CoreMIDI
+win32 {
     DEFINES += __WINDOWS_MM__=1
-        LIBS += -lwinmm
+    LIBS += -lwinmm
+}
+unix:!macx {
+    DEFINES += __LINUX_ALSA__=1
+    LIBS += -lasound -lpthread
+}
+macx {
+    DEFINES += __MACOSX_CORE__=1
+    LIBS += -framework CoreMIDI -framework CoreAudio -framework CoreFoundation
+}
 
 SOURCES += \
     qmidiin.cpp \
@@ -50,3 +61,6 @@ unix {
 
 RESOURCES += \
     profiles.qrc
+
+# Lock-free queue shared with the other libraries, header only
+INCLUDEPATH += $$PWD/../Common
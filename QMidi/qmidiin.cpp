@@ -1,8 +1,15 @@
 #include "qmidiin.h"
 #include <QDebug>
 QMidiIn::QMidiIn(QObject *parent) : QObject(parent),
-    _midiIn(new RtMidiIn())
+    _midiIn(new RtMidiIn()),
+    _dropped(0),
+    _reported(0)
 {
+    for(unsigned int i = 0; i < POOL_SIZE; i++)
+    {
+        _pool[i]._sysExData.reserve(SYSEX_SIZE);
+        _free.push(static_cast<int>(i));
+    }
     _midiIn->setCallback(&QMidiIn::callback, this);
 }
 
@@ -48,16 +55,58 @@ void QMidiIn::setIgnoreTypes(bool sysex, bool time, bool sense)
 {
     _midiIn->ignoreTypes(sysex, time, sense);
 }
-void QMidiIn::onMidiMessageReceive(QMidiMessage *msg)
+quint64 QMidiIn::getDropped()
 {
-    msg->moveToThread(thread());
-    emit midiMessageReceived(msg);
+    return _dropped.loadRelaxed();
+}
+
+void QMidiIn::onMidiMessageReceive(int index)
+{
+    // Cannot fail, the ring holds the whole pool
+    _received.push(index);
+    // One wake of the event loop for all messages that arrive until it runs
+    if(_notified.testAndSetOrdered(0, 1))
+    {
+        QMetaObject::invokeMethod(this, "deliver", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief QMidiIn::deliver
+ * Emit all messages that were received since the last wake and return them to the pool
+ */
+void QMidiIn::deliver()
+{
+    _notified.storeRelease(0);
+    int index;
+    while(_received.pop(index))
+    {
+        emit midiMessageReceived(&_pool[index]);
+        _free.push(index);
+    }
+    quint64 dropped = _dropped.loadRelaxed();
+    if(dropped != _reported)
+    {
+        qWarning() << "MIDI input overloaded," << dropped - _reported << "messages dropped";
+        _reported = dropped;
+    }
 }
 
 void QMidiIn::callback(double deltatime, std::vector<unsigned char> *message, void *userData)
 {
     QMidiIn* midiIn = (QMidiIn*) userData;
-    QMidiMessage *midiMessage = new QMidiMessage();
+    if(message->empty())
+    {
+        return;
+    }
+    int index;
+    if(!midiIn->_free.pop(index))
+    {
+        midiIn->_dropped.fetchAndAddRelaxed(1);
+        return;
+    }
+    QMidiMessage *midiMessage = midiIn->_pool[index].clear();
+    unsigned int size = message->size();
 
         if((message->at(0)) >= MIDI_SYSEX) {
             midiMessage->setStatus((QMidiStatus)(message->at(0) & 0xFF));
@@ -74,39 +123,42 @@ void QMidiIn::callback(double deltatime, std::vector<unsigned char> *message, vo
         switch(midiMessage->getStatus()) {
             case MIDI_NOTE_ON :
             case MIDI_NOTE_OFF:
+                if(size < 3) break;
                 midiMessage->setPitch((unsigned int) message->at(1));
                 midiMessage->setVelocity((unsigned int) message->at(2));
                 break;
             case MIDI_CONTROL_CHANGE:
+                if(size < 3) break;
                 midiMessage->setControl((unsigned int) message->at(1));
                 midiMessage->setValue((unsigned int) message->at(2));
                 break;
             case MIDI_PROGRAM_CHANGE:
             case MIDI_AFTERTOUCH:
+                if(size < 2) break;
                 midiMessage->setValue((unsigned int) message->at(1));
                 break;
             case MIDI_PITCH_BEND:
+                if(size < 3) break;
                 midiMessage->setValue((unsigned int) (message->at(2) << 7) +
                                     (unsigned int) message->at(1)); // msb + lsb
                 break;
             case MIDI_POLY_AFTERTOUCH:
+                if(size < 3) break;
                 midiMessage->setPitch((unsigned int) message->at(1));
                 midiMessage->setValue((unsigned int) message->at(2));
                 break;
+            case MIDI_TIME_CODE:
+                if(size < 2) break;
+                midiMessage->setValue((unsigned int) message->at(1));
+                break;
             case MIDI_SYSEX:
-                midiMessage->setSysExData(*message);
+                // Copied into the reserved buffer, only a long SysEx allocates
+                midiMessage->_sysExData.assign(message->begin(), message->end());
                 break;
             default:
                 break;
         }
-//    unsigned int nBytes = message->size();
-//    qDebug()<<"channel"<<(int)(message->at(0))-144;
-//    for ( unsigned int i=0; i<nBytes; i++ )
-//      std::cout << "Byte " << i << " = " << (int)message->at(i) << ", ";
-//    if ( nBytes > 0 )
-//      std::cout << "stamp = " << deltatime << std::endl;
 
-    midiIn->onMidiMessageReceive(midiMessage);
+    midiIn->onMidiMessageReceive(index);
 
 }
-
@@ -1,13 +1,23 @@
 #ifndef QMIDIIN_H
 #define QMIDIIN_H
 
+#include <QAtomicInt>
 #include <QStringList>
 #include <QObject>
 #include "rtmidi/RtMidi.h"
 #include "qmidimessage.h"
 
 #include "Share.h"
+#include "SpscQueue.h"
 
+/**
+ * @brief The QMidiIn class
+ * Incoming messages are decoded on the RtMidi thread into a fixed pool of messages and
+ * passed on through a lock-free ring, nothing is allocated per message. The messages
+ * that arrived are delivered together, once per wake of the event loop, with the
+ * midiMessageReceived signal. A message only lives until the slot returns; it goes back
+ * to the pool afterwards. When the pool runs out the message is dropped and counted.
+ */
 
 class QMIDISHARED_EXPORT QMidiIn : public QObject
 {
@@ -21,12 +31,25 @@ public:
     void closePort();
     bool isPortOpen();
     void setIgnoreTypes(bool sysex = true, bool time = true, bool sense = true);
+    quint64 getDropped();
 private:
-    void onMidiMessageReceive(QMidiMessage *msg);
+    static const unsigned int POOL_SIZE = 256;
+    static const unsigned int SYSEX_SIZE = 256;
+    void onMidiMessageReceive(int index);
     static void callback( double deltatime, std::vector< unsigned char > *message, void *userData );
 
+private slots:
+    void deliver();
+
 private:
     RtMidiIn *_midiIn;
+    QMidiMessage _pool[POOL_SIZE];
+    // Filled messages towards the event loop, and emptied ones back to the RtMidi thread
+    SpscQueue<int, POOL_SIZE> _received;
+    SpscQueue<int, POOL_SIZE> _free;
+    QAtomicInt _notified;
+    QAtomicInteger<quint64> _dropped;
+    quint64 _reported;
 
 signals:
     void midiMessageReceived(QMidiMessage *message);
@@ -1,9 +1,11 @@
 #include "qmidiout.h"
 #include <QDebug>
 QMidiOut::QMidiOut(QObject *parent) : QObject(parent),
-    _midiOut(new RtMidiOut())
+    _midiOut(new RtMidiOut()),
+    _runningStatus(false),
+    _lastStatus(0)
 {
-
+    _message.reserve(3);
 }
 QStringList QMidiOut::getPorts()
 {
@@ -17,15 +19,18 @@ QStringList QMidiOut::getPorts()
 }
 void QMidiOut::openPort(unsigned int index)
 {
+    _lastStatus = 0;
     _midiOut->openPort(index);
 }
 
 void QMidiOut::openVirtualPort(QString name)
 {
+    _lastStatus = 0;
     _midiOut->openVirtualPort(name.toStdString());
 }
 void QMidiOut::closePort()
 {
+    _lastStatus = 0;
     _midiOut->closePort();
 }
 bool QMidiOut::isPortOpen()
@@ -34,30 +39,121 @@ bool QMidiOut::isPortOpen()
 }
 void QMidiOut::sendNoteOn(unsigned int channel, unsigned int pitch, unsigned int velocity)
 {
-    std::vector<unsigned char> message;
-    message.push_back(MIDI_NOTE_ON+channel-1);
-    message.push_back(pitch);
-    message.push_back(velocity);
-    sendRawMessage(message);
+    sendShortMessage(MIDI_NOTE_ON+(channel-1), pitch, velocity);
 }
 void QMidiOut::sendNoteOff(unsigned int channel, unsigned int pitch, unsigned int velocity)
 {
-    std::vector<unsigned char> message;
-    message.push_back(MIDI_NOTE_OFF+(channel-1));
-    message.push_back(pitch);
-    message.push_back(velocity);
-    sendRawMessage(message);
+    sendShortMessage(MIDI_NOTE_OFF+(channel-1), pitch, velocity);
 }
 void QMidiOut::sendMessage(QMidiMessage *message)
 {
-    std::vector<unsigned char> rawMessage = message->getRawMessage();
-//    qDebug()<<"send message"<<rawMessage.front();
-    sendRawMessage(rawMessage);
+    switch(message->getStatus())
+    {
+    case MIDI_NOTE_ON:
+    case MIDI_NOTE_OFF:
+        sendShortMessage(message->getStatus()+message->getChannel()-1, message->getPitch(), message->getVelocity());
+        break;
+    case MIDI_CONTROL_CHANGE:
+        sendShortMessage(message->getStatus()+message->getChannel()-1, message->getControl(), message->getValue());
+        break;
+    default:{
+        std::vector<unsigned char> rawMessage = message->getRawMessage();
+        sendRawMessage(rawMessage);
+        break;
+    }
+    }
 }
 
 void QMidiOut::sendRawMessage(std::vector<unsigned char> &message)
 {
+    // The receiver has to see the status of the next channel message again
+    _lastStatus = 0;
     _midiOut->sendMessage(&message);
 }
 
+/**
+ * @brief QMidiOut::sendBatch
+ * Send the channel messages that are due at the same time, one after the other without
+ * allocating. With running status, a message that repeats the status of the previous
+ * one is sent without its status byte.
+ * @param messages - the messages
+ * @param count - number of messages
+ */
+void QMidiOut::sendBatch(const QMidiShortMessage *messages, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        sendShortMessage(messages[i].status, messages[i].data1, messages[i].data2);
+    }
+}
 
+/**
+ * @brief QMidiOut::canSchedule
+ * @return true when the output has a queue that delivers messages at a time of its own
+ * clock, only the ALSA sequencer has one
+ */
+bool QMidiOut::canSchedule()
+{
+    return _midiOut->canSchedule();
+}
+
+/**
+ * @brief QMidiOut::getQueueTime
+ * @return the current time of the output queue in seconds, -1 when there is none
+ */
+double QMidiOut::getQueueTime()
+{
+    return _midiOut->getQueueTime();
+}
+
+/**
+ * @brief QMidiOut::scheduleBatch
+ * Hand a batch of channel messages to the output queue now, the kernel delivers them at
+ * the given time with sub-millisecond accuracy. Outputs without a queue send them immediately.
+ * @param messages - the messages
+ * @param count - number of messages
+ * @param time - time of the output queue in seconds, see getQueueTime()
+ */
+void QMidiOut::scheduleBatch(const QMidiShortMessage *messages, int count, double time)
+{
+    for(int i = 0; i < count; i++)
+    {
+        sendShortMessage(messages[i].status, messages[i].data1, messages[i].data2, time);
+    }
+}
+
+/**
+ * @brief QMidiOut::setRunningStatus
+ * Leave out repeated status bytes. Off by default: the RtMidi backends take every message
+ * as a whole event, only an output that reads the messages as a raw byte stream may opt in.
+ */
+void QMidiOut::setRunningStatus(bool enabled)
+{
+    _runningStatus = enabled;
+    _lastStatus = 0;
+}
+
+bool QMidiOut::isRunningStatus()
+{
+    return _runningStatus;
+}
+
+void QMidiOut::sendShortMessage(unsigned char status, unsigned char data1, unsigned char data2, double time)
+{
+    _message.clear();
+    if(!_runningStatus || status != _lastStatus)
+    {
+        _message.push_back(status);
+    }
+    _message.push_back(data1 & 0x7F);
+    _message.push_back(data2 & 0x7F);
+    _lastStatus = status;
+    if(time < 0.0)
+    {
+        _midiOut->sendMessage(&_message);
+    }
+    else
+    {
+        _midiOut->scheduleMessage(&_message, time);
+    }
+}
@@ -3,9 +3,17 @@
 
 #include <QStringList>
 #include <QObject>
-#include "rtmidi\RtMidi.h"
+#include "rtmidi/RtMidi.h"
 #include "qmidimessage.h"
 
+// A channel message of three bytes, as sent in a batch
+struct QMidiShortMessage
+{
+    unsigned char status;
+    unsigned char data1;
+    unsigned char data2;
+};
+
 class QMIDISHARED_EXPORT QMidiOut : public QObject
 {
     Q_OBJECT
@@ -17,12 +25,23 @@ public:
     void sendNoteOff(unsigned int channel, unsigned int pitch, unsigned int velocity);
     void sendMessage(QMidiMessage *message);
     void sendRawMessage(std::vector<unsigned char> &message);
+    void sendBatch(const QMidiShortMessage *messages, int count);
+    bool canSchedule();
+    double getQueueTime();
+    void scheduleBatch(const QMidiShortMessage *messages, int count, double time);
+    void setRunningStatus(bool enabled);
+    bool isRunningStatus();
     void openPort(unsigned int index);
     void openVirtualPort(QString name);
     void closePort();
     bool isPortOpen();
 private:
     RtMidiOut *_midiOut;
+    // Reused for every short message, sending one does not allocate
+    std::vector<unsigned char> _message;
+    bool _runningStatus;
+    unsigned char _lastStatus;
+    void sendShortMessage(unsigned char status, unsigned char data1, unsigned char data2, double time = -1.0);
 
 
 signals:
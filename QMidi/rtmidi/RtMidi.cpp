@@ -1653,6 +1653,7 @@ MidiOutAlsa :: ~MidiOutAlsa()
   // Cleanup.
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
   if ( data->vport >= 0 ) snd_seq_delete_port( data->seq, data->vport );
+  if ( data->queue_id >= 0 ) snd_seq_free_queue( data->seq, data->queue_id );
   if ( data->coder ) snd_midi_event_free( data->coder );
   if ( data->buffer ) free( data->buffer );
   snd_seq_close( data->seq );
@@ -1678,6 +1679,7 @@ void MidiOutAlsa :: initialize( const std::string& clientName )
   data->seq = seq;
   data->portNum = -1;
   data->vport = -1;
+  data->queue_id = -1; // the output queue is created by the first scheduled message
   data->bufferSize = 32;
   data->coder = 0;
   data->buffer = 0;
@@ -1827,6 +1829,50 @@ void MidiOutAlsa :: openVirtualPort( std::string portName )
 }
 
 void MidiOutAlsa :: sendMessage( std::vector<unsigned char> *message )
+{
+  outputMessage( message, -1.0 );
+}
+
+int MidiOutAlsa :: outputQueue( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( data->queue_id < 0 ) {
+    // The queue runs on the default sequencer timer, which is a high resolution timer
+    // on current kernels.
+    data->queue_id = snd_seq_alloc_named_queue( data->seq, "RtMidi Output Queue" );
+    if ( data->queue_id < 0 ) {
+      errorString_ = "MidiOutAlsa::outputQueue: error creating ALSA output queue.";
+      error( RtMidiError::WARNING, errorString_ );
+      return -1;
+    }
+    snd_seq_start_queue( data->seq, data->queue_id, NULL );
+    snd_seq_drain_output( data->seq );
+  }
+  return data->queue_id;
+}
+
+double MidiOutAlsa :: getQueueTime( void )
+{
+  AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
+  if ( outputQueue() < 0 ) return -1.0;
+
+  snd_seq_queue_status_t *status;
+  snd_seq_queue_status_alloca( &status );
+  if ( snd_seq_get_queue_status( data->seq, data->queue_id, status ) < 0 ) {
+    errorString_ = "MidiOutAlsa::getQueueTime: error reading ALSA output queue status.";
+    error( RtMidiError::WARNING, errorString_ );
+    return -1.0;
+  }
+  const snd_seq_real_time_t *time = snd_seq_queue_status_get_real_time( status );
+  return time->tv_sec + time->tv_nsec * 1e-9;
+}
+
+void MidiOutAlsa :: scheduleMessage( std::vector<unsigned char> *message, double time )
+{
+  outputMessage( message, outputQueue() < 0 ? -1.0 : time );
+}
+
+void MidiOutAlsa :: outputMessage( std::vector<unsigned char> *message, double time )
 {
   int result;
   AlsaMidiData *data = static_cast<AlsaMidiData *> (apiData_);
@@ -1852,7 +1898,16 @@ void MidiOutAlsa :: sendMessage( std::vector<unsigned char> *message )
   snd_seq_ev_clear(&ev);
   snd_seq_ev_set_source(&ev, data->vport);
   snd_seq_ev_set_subs(&ev);
-  snd_seq_ev_set_direct(&ev);
+  if ( time < 0.0 ) {
+    snd_seq_ev_set_direct(&ev);
+  }
+  else {
+    // Delivered by the kernel when the output queue reaches the time
+    snd_seq_real_time_t due;
+    due.tv_sec = (unsigned int) time;
+    due.tv_nsec = (unsigned int) ( ( time - due.tv_sec ) * 1e9 );
+    snd_seq_ev_schedule_real( &ev, data->queue_id, 0, &due );
+  }
   for ( unsigned int i=0; i<nBytes; ++i ) data->buffer[i] = message->at(i);
   result = snd_midi_event_encode( data->coder, data->buffer, (long)nBytes, &ev );
   if ( result < (int)nBytes ) {
@@ -409,6 +409,23 @@ class RtMidiOut : public RtMidi
   */
   void sendMessage( std::vector<unsigned char> *message );
 
+  //! Returns true if messages can be scheduled on an output queue (Linux ALSA only).
+  bool canSchedule( void );
+
+  //! Returns the current time of the output queue in seconds, or -1.0 if there is none.
+  /*!
+      The queue is created and started the first time it is needed.
+  */
+  double getQueueTime( void );
+
+  //! Send a single message at a time on the output queue.
+  /*!
+      The message is handed to the sequencer right away and delivered by
+      the kernel when the queue reaches \e time (in seconds, see
+      getQueueTime()).  APIs without an output queue send it immediately.
+  */
+  void scheduleMessage( std::vector<unsigned char> *message, double time );
+
   //! Set an error callback function to be invoked when an error has occured.
   /*!
     The callback function will be called whenever an error has occured. It is best
@@ -531,6 +548,9 @@ class MidiOutApi : public MidiApi
   MidiOutApi( void );
   virtual ~MidiOutApi( void );
   virtual void sendMessage( std::vector<unsigned char> *message ) = 0;
+  virtual bool canSchedule( void ) { return false; };
+  virtual double getQueueTime( void ) { return -1.0; };
+  virtual void scheduleMessage( std::vector<unsigned char> *message, double ) { sendMessage( message ); };
 };
 
 // **************************************************************** //
@@ -560,6 +580,9 @@ inline bool RtMidiOut :: isPortOpen() const { return rtapi_->isPortOpen(); }
 inline unsigned int RtMidiOut :: getPortCount( void ) { return rtapi_->getPortCount(); }
 inline std::string RtMidiOut :: getPortName( unsigned int portNumber ) { return rtapi_->getPortName( portNumber ); }
 inline void RtMidiOut :: sendMessage( std::vector<unsigned char> *message ) { ((MidiOutApi *)rtapi_)->sendMessage( message ); }
+inline bool RtMidiOut :: canSchedule( void ) { return ((MidiOutApi *)rtapi_)->canSchedule(); }
+inline double RtMidiOut :: getQueueTime( void ) { return ((MidiOutApi *)rtapi_)->getQueueTime(); }
+inline void RtMidiOut :: scheduleMessage( std::vector<unsigned char> *message, double time ) { ((MidiOutApi *)rtapi_)->scheduleMessage( message, time ); }
 inline void RtMidiOut :: setErrorCallback( RtMidiErrorCallback errorCallback, void *userData ) { rtapi_->setErrorCallback(errorCallback, userData); }
 
 // **************************************************************** //
@@ -682,9 +705,14 @@ class MidiOutAlsa: public MidiOutApi
   unsigned int getPortCount( void );
   std::string getPortName( unsigned int portNumber );
   void sendMessage( std::vector<unsigned char> *message );
+  bool canSchedule( void ) { return true; };
+  double getQueueTime( void );
+  void scheduleMessage( std::vector<unsigned char> *message, double time );
 
  protected:
   void initialize( const std::string& clientName );
+  int outputQueue( void );
+  void outputMessage( std::vector<unsigned char> *message, double time );
 };
 
 #endif